@@ -48,6 +48,7 @@ struct audio_volume
 
     vlc_fourcc_t format; /**< Audio samples format */
     void (*amplify)(audio_volume_t *, block_t *, float); /**< Amplifier */
+    void *sys; /**< Private data of the amplifier module */
 };
 
 /** @} */
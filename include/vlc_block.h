@@ -146,6 +146,26 @@ VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
 block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
+/**
+ * Block allocator cache statistics.
+ */
+typedef struct block_cache_stats_t
+{
+    uint64_t hits; /**< Allocations served from a thread cache */
+    uint64_t misses; /**< Cacheable allocations served from the heap */
+    uint64_t remote_frees; /**< Cached blocks released by another thread */
+} block_cache_stats_t;
+
+/**
+ * Gets block allocator cache statistics.
+ *
+ * block_Alloc() recycles small and medium blocks through per-thread caches.
+ * This function returns cumulative counters over all threads of the process.
+ *
+ * @param stats structure to fill with the statistics [OUT]
+ */
+VLC_API void block_GetCacheStats(block_cache_stats_t *stats);
+
 /**
  * Reallocates a block.
  *
@@ -432,6 +452,21 @@ static inline block_t *block_ChainGather( block_t *p_list )
  */
 VLC_API block_fifo_t *block_FifoNew(void) VLC_USED VLC_MALLOC;
 
+/**
+ * Creates a lock-free single producer single consumer FIFO queue of blocks.
+ *
+ * The queue works like one created with block_FifoNew(), but only one thread
+ * may queue blocks with block_FifoPut() and only one (other) thread may
+ * dequeue blocks with block_FifoGet(), block_FifoTryGet(), block_FifoShow()
+ * or block_FifoEmpty(). The consumer only locks when it has to wait.
+ *
+ * @warning The vlc_fifo_Lock() family of functions cannot be used with such
+ * a queue.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_fifo_t *block_FifoNewSPSC(void) VLC_USED VLC_MALLOC;
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  *
@@ -462,6 +497,13 @@ VLC_API void block_FifoPut(block_fifo_t *fifo, block_t *block);
  */
 VLC_API block_t *block_FifoGet(block_fifo_t *) VLC_USED;
 
+/**
+ * Dequeue the first block from the FIFO if there is one, without waiting.
+ *
+ * @return a block, or NULL if the FIFO is empty
+ */
+VLC_API block_t *block_FifoTryGet(block_fifo_t *) VLC_USED;
+
 /**
  * Peeks the first block in the FIFO.
  *
@@ -610,6 +652,25 @@ VLC_API size_t vlc_fifo_GetCount(const vlc_fifo_t *) VLC_USED;
  */
 VLC_API size_t vlc_fifo_GetBytes(const vlc_fifo_t *) VLC_USED;
 
+/**
+ * Measures the duration of a FIFO.
+ *
+ * Checks the time span between the oldest and the newest timestamped blocks
+ * queued in a locked FIFO. The decoding timestamp is used if set, otherwise
+ * the presentation timestamp. Only the blocks queued since the last one
+ * flagged with BLOCK_FLAG_DISCONTINUITY are considered, and timestamps
+ * going backward do not reduce the span.
+ *
+ * @note This function is not cancellation point.
+ *
+ * @warning The FIFO must be locked by the calling thread using
+ * vlc_fifo_Lock(). Otherwise behaviour is undefined.
+ *
+ * @return the duration in microseconds, or zero if fewer than two blocks
+ * carry a timestamp
+ */
+VLC_API mtime_t vlc_fifo_GetDuration(const vlc_fifo_t *) VLC_USED;
+
 VLC_USED static inline bool vlc_fifo_IsEmpty(const vlc_fifo_t *fifo)
 {
     return vlc_fifo_GetCount(fifo) == 0;
@@ -212,6 +212,37 @@ static inline int filter_GetInputAttachments( filter_t *p_filter,
                                          ppp_attachment, pi_attachment );
 }
 
+/**
+ * Video filter slice callback.
+ *
+ * It processes the lines [i_start, i_end) of the plane i_plane.
+ */
+typedef void (*filter_slice_cb)( filter_t *, void *opaque, unsigned i_plane,
+                                 unsigned i_start, unsigned i_end );
+
+/**
+ * It runs a slice callback on the visible lines of the first i_planes planes
+ * of a picture.
+ *
+ * The planes are cut in horizontal slices which are processed concurrently
+ * by the calling thread and the slice threads shared by all the filters of
+ * the instance (see the "filter-threads" option). Slices start on even lines.
+ * The callback may be called concurrently, so it must only write the lines
+ * of its own slice and must not read lines written by other slices.
+ *
+ * This function returns once all the slices have been processed. It is not
+ * a cancellation point.
+ */
+VLC_API void filter_ExecuteSlices( filter_t *, filter_slice_cb, void *opaque,
+                                   const picture_t *, unsigned i_planes );
+
+/**
+ * It returns the maximum number of concurrent calls of a slice callback
+ * during filter_ExecuteSlices(), for instance to allocate scratch memory for
+ * each of them beforehand.
+ */
+VLC_API unsigned filter_GetSliceThreads( filter_t * );
+
 /**
  * It creates a blend filter.
  *
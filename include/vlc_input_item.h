@@ -418,9 +418,19 @@ struct input_stats_t
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
 
+    /* Stream cache */
+    int64_t i_cache_hits; /**< Seeks served from the cache */
+    int64_t i_cache_misses; /**< Seeks forwarded to the access */
+    int64_t i_cache_refills; /**< Reads from the access */
+
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    mtime_t i_audio_fifo; /**< Duration queued for the audio decoders */
+    mtime_t i_video_fifo; /**< Duration queued for the video decoders */
+    int64_t i_fifo_dropped; /**< Blocks dropped from the decoder queues */
+    mtime_t i_video_decode_p50; /**< Median video decoding time per block */
+    mtime_t i_video_decode_p99; /**< 99th percentile of the same */
 
     /* Vout */
     int64_t i_displayed_pictures;
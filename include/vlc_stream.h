@@ -433,6 +433,18 @@ do { \
     (stream)->pf_readdir = vlc_stream_FilterDefaultReadDir; \
 } while (0)
 
+/**
+ * Reports cache statistics of a stream filter to the input statistics.
+ *
+ * This is a no-op if the stream does not belong to an input.
+ *
+ * @param hits seeks served from the cache since the last report
+ * @param misses seeks that required seeking the source since the last report
+ * @param refills reads from the source since the last report
+ */
+VLC_API void vlc_stream_FilterReportCache(stream_t *s, unsigned hits,
+                                          unsigned misses, unsigned refills);
+
 /**
  * @}
  */
@@ -52,6 +52,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -70,8 +73,16 @@ struct access_sys_t
     int fd;
 
     bool b_pace_control;
+
+    /* Memory-mapped reading */
+    uint64_t offset; /**< Current reading offset */
+    uint64_t ahead; /**< End of the range already hinted to the kernel */
 };
 
+/* Bytes mapped per block, and hinted ahead of the reading offset */
+#define MMAP_WINDOW     (1 << 20)
+#define MMAP_READAHEAD  (8 << 20)
+
 #if !defined (_WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -127,8 +138,14 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (access_t *, void *, size_t);
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (access_t *, bool *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static int NoSeek (access_t *, uint64_t);
 static int FileControl (access_t *, int, va_list);
@@ -219,12 +236,27 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+    p_sys->offset = 0;
+    p_sys->ahead = 0;
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
         p_access->pf_seek = FileSeek;
         p_sys->b_pace_control = true;
 
+#ifdef HAVE_MMAP
+        /* Hand out blocks mapping the page cache rather than copies of it.
+         * Remote file systems are left alone: a truncated file would get
+         * us killed by SIGBUS, and this is more likely over the network. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "using memory-mapped reading");
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+        }
+#endif
+
         /* Demuxers will need the beginning of the file for probing. */
         posix_fadvise (fd, 0, 4096, POSIX_FADV_WILLNEED);
         /* In most cases, we only read the file once. */
@@ -259,7 +291,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -297,6 +329,77 @@ static ssize_t Read (access_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (access_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->fd;
+    struct stat st;
+
+    /* The file may still be growing */
+    if (fstat (fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    if (p_sys->offset >= (uint64_t)st.st_size)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    const uint64_t page_mask = sysconf (_SC_PAGESIZE) - 1;
+    const uint64_t start = p_sys->offset & ~page_mask;
+    const size_t skip = p_sys->offset - start;
+    const size_t length = __MIN((uint64_t)st.st_size - p_sys->offset,
+                                MMAP_WINDOW);
+    block_t *block;
+
+    /* Blocks are writable: private mappings are copied on write */
+    void *addr = mmap (NULL, skip + length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       fd, start);
+    if (addr != MAP_FAILED)
+    {
+        posix_madvise (addr, skip + length, POSIX_MADV_SEQUENTIAL);
+        block = block_mmap_Alloc ((char *)addr + skip, length);
+        if (unlikely(block == NULL))
+            return NULL;
+    }
+    else
+    {   /* Some files cannot be mapped, fall back to copying */
+        block = block_Alloc (length);
+        if (unlikely(block == NULL))
+            return NULL;
+
+        ssize_t val = pread (fd, block->p_buffer, length, p_sys->offset);
+        if (val <= 0)
+        {
+            if (val < 0)
+                msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+            block_Release (block);
+            *eof = val == 0;
+            return NULL;
+        }
+        block->i_buffer = val;
+    }
+
+    p_sys->offset += block->i_buffer;
+
+    /* Keep the kernel reading ahead of us, by a few windows at a time */
+    if (p_sys->ahead < p_sys->offset + MMAP_READAHEAD / 2)
+    {
+        uint64_t from = __MAX(p_sys->ahead, p_sys->offset);
+
+        posix_fadvise (fd, from, p_sys->offset + MMAP_READAHEAD - from,
+                       POSIX_FADV_WILLNEED);
+        p_sys->ahead = p_sys->offset + MMAP_READAHEAD;
+    }
+    return block;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -304,6 +407,12 @@ static int FileSeek (access_t *p_access, uint64_t i_pos)
 {
     access_sys_t *sys = p_access->p_sys;
 
+    if (p_access->pf_block != NULL)
+    {
+        sys->offset = sys->ahead = i_pos;
+        return VLC_SUCCESS;
+    }
+
     if (lseek(sys->fd, i_pos, SEEK_SET) == (off_t)-1)
         return VLC_EGENERIC;
     return VLC_SUCCESS;
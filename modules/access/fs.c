@@ -39,6 +39,12 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, N_("Memory-mapped reading"),
+              N_("Read local files through memory mappings rather than "
+                 "copies. This saves CPU time on large files, but the "
+                 "file must not be truncated while it is being read."), true )
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -56,6 +56,11 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Receive batch size")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams received per system call.")
+
+#define UDP_BATCH_MAX 64
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -66,6 +71,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range( "udp-batch", 32, 1, UDP_BATCH_MAX,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -78,12 +87,25 @@ struct access_sys_t
     int fd;
     int timeout;
     size_t mtu;
+#ifdef HAVE_RECVMMSG
+    /* Datagrams [next, count) are received and pending, the other non-NULL
+     * blocks are preallocated for the next system call. */
+    unsigned batch;
+    unsigned next;
+    unsigned count;
+    block_t *blocks[UDP_BATCH_MAX];
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    struct iovec iovecs[UDP_BATCH_MAX];
+#endif
 };
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( access_t *, bool * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( access_t *, bool * );
+#endif
 static int Control( access_t *, int, va_list );
 
 /*****************************************************************************
@@ -173,6 +195,21 @@ error:
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->next = sys->count = 0;
+    memset( sys->msgs, 0, sizeof( sys->msgs ) );
+    for( unsigned i = 0; i < UDP_BATCH_MAX; i++ )
+    {
+        sys->blocks[i] = NULL;
+        sys->msgs[i].msg_hdr.msg_iov = &sys->iovecs[i];
+        sys->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if( sys->batch > 1 )
+        p_access->pf_block = BlockUDPBatch;
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -185,6 +222,11 @@ static void Close( vlc_object_t *p_this )
     access_sys_t *sys = p_access->p_sys;
 
     net_Close( sys->fd );
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH_MAX; i++ )
+        if( sys->blocks[i] != NULL )
+            block_Release( sys->blocks[i] );
+#endif
     free( sys );
 }
 
@@ -282,3 +324,95 @@ skip:
 
     return pkt;
 }
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockUDPBatch: drains up to udp-batch datagrams per wake-up
+ *****************************************************************************/
+static block_t *BlockUDPBatch(access_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+    block_t *pkt;
+
+    if (sys->next < sys->count)
+        goto dequeue;
+
+    /* Refill the receive ring */
+    unsigned vlen = 0;
+
+    while (vlen < sys->batch)
+    {
+        pkt = sys->blocks[vlen];
+        if (pkt != NULL && pkt->i_buffer < sys->mtu)
+        {   /* MTU was raised after truncation */
+            block_Release(pkt);
+            pkt = NULL;
+        }
+        if (pkt == NULL)
+        {
+            pkt = block_Alloc(sys->mtu);
+            sys->blocks[vlen] = pkt;
+            if (unlikely(pkt == NULL))
+                break;
+        }
+
+        sys->iovecs[vlen].iov_base = pkt->p_buffer;
+        sys->iovecs[vlen].iov_len = sys->mtu;
+        vlen++;
+    }
+
+    if (unlikely(vlen == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return NULL;
+    }
+
+    int flags = MSG_DONTWAIT;
+#ifdef __linux__
+    flags |= MSG_TRUNC; /* report the real length of truncated datagrams */
+#endif
+    int val = recvmmsg(sys->fd, sys->msgs, vlen, flags, NULL);
+    if (val <= 0)
+        return NULL;
+
+    for (int i = 0; i < val; i++)
+    {
+        size_t len = sys->msgs[i].msg_len;
+
+        pkt = sys->blocks[i];
+        if (sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, sys->mtu);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            if (len > sys->mtu)
+                sys->mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+    }
+
+    sys->next = 0;
+    sys->count = val;
+dequeue:
+    pkt = sys->blocks[sys->next];
+    sys->blocks[sys->next++] = NULL;
+    return pkt;
+}
+#endif
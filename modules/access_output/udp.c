@@ -45,12 +45,19 @@
 #   include <ws2tcpip.h>
 #else
 #   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
 #endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Maximum number of datagrams sent per system call */
+#define UDP_BATCH_MAX 64
+/* Packets due within this delay after a batch are sent along with it */
+#define UDP_BATCH_WINDOW (CLOCK_FREQ / 1000)
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -71,6 +78,15 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batch packets")
+#define BATCH_LONGTEXT N_("Packets that are due at the same time are sent " \
+                          "with a single system call. This sets the " \
+                          "maximum number of packets per call." )
+
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split batches of packets " \
+                        "into datagrams (requires Linux 4.18 or later)." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +95,11 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 16, 1, UDP_BATCH_MAX,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+#ifdef UDP_SEGMENT
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +113,10 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
+#ifdef UDP_SEGMENT
+    "gso",
+#endif
     NULL
 };
 
@@ -121,6 +146,9 @@ struct sout_access_out_sys_t
     block_fifo_t *p_empty_blocks;
     block_t      *p_buffer;
 
+    unsigned      i_batch;
+    bool          b_gso;
+
     vlc_thread_t  thread;
 };
 
@@ -210,9 +238,16 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    /* Both queues are only ever used between Write() and ThreadWrite() */
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+    p_sys->i_batch = var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+#else
+    p_sys->b_gso = false;
+#endif
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -392,6 +427,129 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+#ifdef UDP_SEGMENT
+/*****************************************************************************
+ * SendSegmented: send equally-sized packets as one GSO super-datagram
+ *****************************************************************************
+ * Returns the number of packets sent, or -1 on error.
+ *****************************************************************************/
+static int SendSegmented( int fd, block_t *const *pp_pk, unsigned i_count )
+{
+    struct iovec iov[UDP_BATCH_MAX];
+    const size_t i_segment = pp_pk[0]->i_buffer;
+    size_t i_total = 0;
+    unsigned n = 0;
+
+    /* All segments but the last one must have the same size */
+    while( n < i_count && pp_pk[n]->i_buffer <= i_segment
+        && i_total + pp_pk[n]->i_buffer <= 65507 )
+    {
+        iov[n].iov_base = pp_pk[n]->p_buffer;
+        iov[n].iov_len = pp_pk[n]->i_buffer;
+        i_total += pp_pk[n++]->i_buffer;
+        if( iov[n - 1].iov_len < i_segment )
+            break;
+    }
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = n,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+    *(uint16_t *)CMSG_DATA(cmsg) = i_segment;
+
+    if( sendmsg( fd, &msg, 0 ) == -1 )
+        return -1;
+    return n;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send a batch of packets with as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, block_t *const *pp_pk,
+                       unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->i_handle;
+
+#ifdef UDP_SEGMENT
+    while( p_sys->b_gso && i_count > 1 )
+    {
+        int val = SendSegmented( fd, pp_pk, i_count );
+        if( val == -1 )
+        {
+            msg_Warn( p_access, "segmentation offload error: %s",
+                      vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+            break;
+        }
+        pp_pk += val;
+        i_count -= val;
+    }
+#endif
+#ifdef HAVE_SENDMMSG
+    if( i_count > 1 )
+    {
+        struct mmsghdr msgs[UDP_BATCH_MAX];
+        struct iovec iov[UDP_BATCH_MAX];
+
+        memset( msgs, 0, i_count * sizeof (msgs[0]) );
+        for( unsigned i = 0; i < i_count; i++ )
+        {
+            iov[i].iov_base = pp_pk[i]->p_buffer;
+            iov[i].iov_len = pp_pk[i]->i_buffer;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        for( unsigned i = 0; i < i_count; )
+        {
+            int val = sendmmsg( fd, msgs + i, i_count - i, 0 );
+            if( val == -1 )
+            {
+                msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+                i++; /* skip the failed packet */
+                continue;
+            }
+            i += val;
+        }
+        return;
+    }
+#endif
+    for( unsigned i = 0; i < i_count; i++ )
+        if( send( fd, pp_pk[i]->p_buffer, pp_pk[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+}
+
+typedef struct
+{
+    block_t  *pp_pk[UDP_BATCH_MAX];
+    unsigned  i_count;
+    block_t  *p_pending; /**< Dequeued packet for the next batch */
+} udp_batch_t;
+
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->pp_pk[i] );
+    if( p_batch->p_pending != NULL )
+        block_Release( p_batch->p_pending );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -404,45 +562,79 @@ static void* ThreadWrite( void *data )
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    udp_batch_t batch = { .i_count = 0, .p_pending = NULL };
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        block_t *p_pk = batch.p_pending;
         mtime_t       i_date, i_sent;
 
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
+        batch.p_pending = NULL;
+
         i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        if( i_date_last > 0 && i_date - i_date_last > 2000000 )
         {
-            if( i_date - i_date_last > 2000000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+            /* Recycle before any cancellation point */
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            if( !i_dropped_packets )
+                msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                         i_date - i_date_last );
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
-            }
-            else if( i_date - i_date_last < -1000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
-            }
+            i_date_last = i_date;
+            i_dropped_packets++;
+            continue;
         }
 
-        block_cleanup_push( p_pk );
+        batch.pp_pk[0] = p_pk;
+        batch.i_count = 1;
+
+        /* The batch owns every dequeued packet, including the pending one,
+         * until they are recycled */
+        vlc_cleanup_push( BatchCleanup, &batch );
+
+        if( i_date_last > 0 && i_date - i_date_last < -1000 )
+        {
+            if( !i_dropped_packets )
+                msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                         i_date_last - i_date );
+        }
+        i_date_last = i_date;
+
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        /* Append the queued packets that would be sent right after this one
+         * anyway: those within the same group, or due within the window. */
+        while( batch.i_count < p_sys->i_batch )
+        {
+            block_t *p_next = block_FifoTryGet( p_sys->p_fifo );
+            if( p_next == NULL )
+                break;
+
+            mtime_t i_next_date = p_sys->i_caching + p_next->i_dts;
+            bool b_wait = i_to_send <= 1
+                       || (p_next->i_flags & BLOCK_FLAG_CLOCK);
+
+            if( i_next_date - i_date_last > 2000000
+             || (b_wait && i_next_date > i_date + UDP_BATCH_WINDOW) )
+            {
+                batch.p_pending = p_next;
+                break;
+            }
+
+            i_to_send = b_wait ? i_group : i_to_send - 1;
+            i_date_last = i_next_date;
+            batch.pp_pk[batch.i_count++] = p_next;
+        }
+
+        SendBatch( p_access, batch.pp_pk, batch.i_count );
 
         if( i_dropped_packets )
         {
@@ -459,9 +651,10 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
-        i_date_last = i_date;
+        for( unsigned i = 0; i < batch.i_count; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, batch.pp_pk[i] );
+        batch.i_count = 0;
+        vlc_cleanup_pop();
     }
     return NULL;
 }
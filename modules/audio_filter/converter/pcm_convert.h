@@ -0,0 +1,513 @@
+/*****************************************************************************
+ * pcm_convert.h : PCM sample format conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2002-2005 VLC authors and VideoLAN
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_PCM_CONVERT_H
+#define VLC_AUDIO_FILTER_PCM_CONVERT_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define PCM_CONVERT_NEON 1
+#endif
+
+/* Each kernel converts n samples from src to dst. The conversions to a
+ * narrower or same size format may be done in place (dst == src): every
+ * vector is loaded before anything is stored over it.
+ * The SIMD versions give the same results as the C ones. */
+
+static inline void s16_fl32_C(float *dst, const int16_t *src, size_t n)
+{
+    for (size_t i = n; i--;)
+#if 0
+        /* Slow version */
+        *dst++ = (float)*src++ / 32768.f;
+#else
+    {   /* This is Walken's trick based on IEEE float format. On my PIII
+         * this takes 16 seconds to perform one billion conversions, instead
+         * of 19 seconds for the above division. */
+        union { float f; int32_t i; } u;
+        u.i = *src++ + 0x43c00000;
+        *dst++ = u.f - 384.f;
+    }
+#endif
+}
+
+static inline void s16_s32_C(int32_t *dst, const int16_t *src, size_t n)
+{
+    for (size_t i = n; i--;)
+        *dst++ = (uint32_t)*src++ << 16;
+}
+
+static inline void fl32_s16_C(int16_t *dst, const float *src, size_t n)
+{
+    for (size_t i = n; i--;) {
+#if 0
+        /* Slow version. */
+        if (*src >= 1.0) *dst = 32767;
+        else if (*src < -1.0) *dst = -32768;
+        else *dst = lroundf(*src * 32768.f);
+        src++; dst++;
+#else
+        /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.f = *src++ + 384.f;
+        if (u.i > 0x43c07fff)
+            *dst++ = 32767;
+        else if (u.i < 0x43bf8000)
+            *dst++ = -32768;
+        else
+            *dst++ = u.i - 0x43c00000;
+#endif
+    }
+}
+
+static inline void fl32_s32_C(int32_t *dst, const float *src, size_t n)
+{
+    for (size_t i = n; i--;)
+    {
+        float s = *(src++) * 2147483648.f;
+        if (s >= 2147483647.f)
+            *(dst++) = 2147483647;
+        else
+        if (s <= -2147483648.f)
+            *(dst++) = -2147483648;
+        else
+            *(dst++) = lroundf(s);
+    }
+}
+
+static inline void s32_s16_C(int16_t *dst, const int32_t *src, size_t n)
+{
+    for (size_t i = n; i--;)
+        *dst++ = (*src++) >> 16;
+}
+
+static inline void s32_fl32_C(float *dst, const int32_t *src, size_t n)
+{
+    for (size_t i = n; i--;)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Walken's trick rounds to nearest even, like the default MXCSR mode. */
+__attribute__ ((__target__ ("sse2")))
+static void s16_fl32_SSE2(float *dst, const int16_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(&dst[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    s16_fl32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void s16_s32_SSE2(int32_t *dst, const int16_t *src, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_unpacklo_epi16(zero, v));
+        _mm_storeu_si128((__m128i *)&dst[i + 4], _mm_unpackhi_epi16(zero, v));
+    }
+    s16_s32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void fl32_s16_SSE2(int16_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(&src[i]), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(&src[i + 4]), scale);
+
+        a = _mm_min_ps(_mm_max_ps(a, min), max);
+        b = _mm_min_ps(_mm_max_ps(b, min), max);
+        _mm_storeu_si128((__m128i *)&dst[i],
+                         _mm_packs_epi32(_mm_cvtps_epi32(a),
+                                         _mm_cvtps_epi32(b)));
+    }
+    fl32_s16_C(&dst[i], &src[i], n - i);
+}
+
+/* lroundf() rounds halfway cases away from zero: round the magnitude by
+ * truncation and compare the dropped fraction with one half, which is exact
+ * below 2^23 and zero above. Out of range values saturate. */
+__attribute__ ((__target__ ("sse2")))
+static void fl32_s32_SSE2(int32_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 half = _mm_set1_ps(.5f);
+    const __m128 mag = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 lim = _mm_set1_ps(2147483648.f);
+    const __m128 nlim = _mm_set1_ps(-2147483648.f);
+    const __m128i imax = _mm_set1_epi32(0x7fffffff);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(&src[i]), scale);
+        __m128 a = _mm_and_ps(s, mag);
+        __m128i r = _mm_cvttps_epi32(a);
+        __m128i up = _mm_castps_si128(
+            _mm_cmpge_ps(_mm_sub_ps(a, _mm_cvtepi32_ps(r)), half));
+        __m128i sign = _mm_srai_epi32(_mm_castps_si128(s), 31);
+
+        r = _mm_sub_epi32(r, up);
+        r = _mm_sub_epi32(_mm_xor_si128(r, sign), sign);
+
+        __m128i hi = _mm_castps_si128(_mm_cmpge_ps(s, lim));
+        __m128i lo = _mm_castps_si128(_mm_cmple_ps(s, nlim));
+        r = _mm_andnot_si128(_mm_or_si128(hi, lo), r);
+        r = _mm_or_si128(r, _mm_and_si128(hi, imax));
+        r = _mm_or_si128(r, _mm_andnot_si128(imax, lo));
+        _mm_storeu_si128((__m128i *)&dst[i], r);
+    }
+    fl32_s32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void s32_s16_SSE2(int16_t *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i b = _mm_loadu_si128((const __m128i *)&src[i + 4]);
+
+        _mm_storeu_si128((__m128i *)&dst[i],
+                         _mm_packs_epi32(_mm_srai_epi32(a, 16),
+                                         _mm_srai_epi32(b, 16)));
+    }
+    s32_s16_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void s32_fl32_SSE2(float *dst, const int32_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    s32_fl32_C(&dst[i], &src[i], n - i);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static void s16_fl32_AVX2(float *dst, const int16_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128((const __m128i *)&src[i]));
+        __m256i hi = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128((const __m128i *)&src[i + 8]));
+
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(lo),
+                                                scale));
+        _mm256_storeu_ps(&dst[i + 8], _mm256_mul_ps(_mm256_cvtepi32_ps(hi),
+                                                    scale));
+    }
+    s16_fl32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void s16_s32_AVX2(int32_t *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128((const __m128i *)&src[i]));
+        __m256i hi = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128((const __m128i *)&src[i + 8]));
+
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_slli_epi32(lo, 16));
+        _mm256_storeu_si256((__m256i *)&dst[i + 8],
+                            _mm256_slli_epi32(hi, 16));
+    }
+    s16_s32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void fl32_s16_AVX2(int16_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(&src[i]), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(&src[i + 8]), scale);
+
+        a = _mm256_min_ps(_mm256_max_ps(a, min), max);
+        b = _mm256_min_ps(_mm256_max_ps(b, min), max);
+
+        /* packs works within each 128-bits lane */
+        __m256i v = _mm256_packs_epi32(_mm256_cvtps_epi32(a),
+                                       _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256((__m256i *)&dst[i],
+                            _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    fl32_s16_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void fl32_s32_AVX2(int32_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256 mag = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 lim = _mm256_set1_ps(2147483648.f);
+    const __m256 nlim = _mm256_set1_ps(-2147483648.f);
+    const __m256i imax = _mm256_set1_epi32(0x7fffffff);
+    const __m256i imin = _mm256_set1_epi32(INT32_MIN);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(&src[i]), scale);
+        __m256 a = _mm256_and_ps(s, mag);
+        __m256i r = _mm256_cvttps_epi32(a);
+        __m256i up = _mm256_castps_si256(
+            _mm256_cmp_ps(_mm256_sub_ps(a, _mm256_cvtepi32_ps(r)), half,
+                          _CMP_GE_OQ));
+        __m256i sign = _mm256_srai_epi32(_mm256_castps_si256(s), 31);
+
+        r = _mm256_sub_epi32(r, up);
+        r = _mm256_sub_epi32(_mm256_xor_si256(r, sign), sign);
+        r = _mm256_blendv_epi8(r, imax, _mm256_castps_si256(
+                               _mm256_cmp_ps(s, lim, _CMP_GE_OQ)));
+        r = _mm256_blendv_epi8(r, imin, _mm256_castps_si256(
+                               _mm256_cmp_ps(s, nlim, _CMP_LE_OQ)));
+        _mm256_storeu_si256((__m256i *)&dst[i], r);
+    }
+    fl32_s32_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void s32_s16_AVX2(int16_t *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&src[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&src[i + 8]);
+        __m256i v = _mm256_packs_epi32(_mm256_srai_epi32(a, 16),
+                                       _mm256_srai_epi32(b, 16));
+
+        _mm256_storeu_si256((__m256i *)&dst[i],
+                            _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    s32_s16_C(&dst[i], &src[i], n - i);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void s32_fl32_AVX2(float *dst, const int32_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&src[i]);
+
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                                scale));
+    }
+    s32_fl32_C(&dst[i], &src[i], n - i);
+}
+#endif
+
+#ifdef PCM_CONVERT_NEON
+static void s16_fl32_NEON(float *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t v = vld1q_s16(&src[i]);
+
+        vst1q_f32(&dst[i], vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+        vst1q_f32(&dst[i + 4],
+                  vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v)), 15));
+    }
+    s16_fl32_C(&dst[i], &src[i], n - i);
+}
+
+static void s16_s32_NEON(int32_t *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t v = vld1q_s16(&src[i]);
+
+        vst1q_s32(&dst[i], vshll_n_s16(vget_low_s16(v), 16));
+        vst1q_s32(&dst[i + 4], vshll_n_s16(vget_high_s16(v), 16));
+    }
+    s16_s32_C(&dst[i], &src[i], n - i);
+}
+
+static void fl32_s16_NEON(int16_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(&src[i]),
+                                                 32768.f));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(&src[i + 4]),
+                                                 32768.f));
+
+        vst1q_s16(&dst[i], vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    fl32_s16_C(&dst[i], &src[i], n - i);
+}
+
+/* vcvtaq rounds halfway cases away from zero and saturates, like the C */
+static void fl32_s32_NEON(int32_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32(&dst[i], vcvtaq_s32_f32(vmulq_n_f32(vld1q_f32(&src[i]),
+                                                      2147483648.f)));
+    fl32_s32_C(&dst[i], &src[i], n - i);
+}
+
+static void s32_s16_NEON(int16_t *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int32x4_t a = vld1q_s32(&src[i]);
+        int32x4_t b = vld1q_s32(&src[i + 4]);
+
+        vst1q_s16(&dst[i], vcombine_s16(vshrn_n_s32(a, 16),
+                                        vshrn_n_s32(b, 16)));
+    }
+    s32_s16_C(&dst[i], &src[i], n - i);
+}
+
+static void s32_fl32_NEON(float *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(&dst[i], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&src[i])),
+                                       1.f / 2147483648.f));
+    s32_fl32_C(&dst[i], &src[i], n - i);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define PCM_CONVERT_AVX2(name, dst, src, n) \
+    if (vlc_CPU_AVX2()) \
+    { \
+        name##_AVX2(dst, src, n); \
+        return; \
+    }
+#else
+# define PCM_CONVERT_AVX2(name, dst, src, n)
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+# define PCM_CONVERT_SSE2(name, dst, src, n) \
+    if (vlc_CPU_SSE2()) \
+    { \
+        name##_SSE2(dst, src, n); \
+        return; \
+    }
+#else
+# define PCM_CONVERT_SSE2(name, dst, src, n)
+#endif
+#ifdef PCM_CONVERT_NEON
+# define PCM_CONVERT_ARM64(name, dst, src, n) \
+    if (vlc_CPU_ARM64_NEON()) \
+    { \
+        name##_NEON(dst, src, n); \
+        return; \
+    }
+#else
+# define PCM_CONVERT_ARM64(name, dst, src, n)
+#endif
+
+#define PCM_CONVERT(name, dst_t, src_t) \
+static inline void pcm_convert_##name(dst_t *dst, const src_t *src, size_t n) \
+{ \
+    PCM_CONVERT_AVX2(name, dst, src, n) \
+    PCM_CONVERT_SSE2(name, dst, src, n) \
+    PCM_CONVERT_ARM64(name, dst, src, n) \
+    name##_C(dst, src, n); \
+}
+
+PCM_CONVERT(s16_fl32, float, int16_t)
+PCM_CONVERT(s16_s32, int32_t, int16_t)
+PCM_CONVERT(fl32_s16, int16_t, float)
+PCM_CONVERT(fl32_s32, int32_t, float)
+PCM_CONVERT(s32_s16, int16_t, int32_t)
+PCM_CONVERT(s32_fl32, float, int32_t)
+
+#undef PCM_CONVERT
+
+#endif
@@ -0,0 +1,204 @@
+/*****************************************************************************
+ * polyphase.c : polyphase windowed-sinc resampler
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_plugin.h>
+
+#include "polyphase.h"
+
+#define QUALITY_TEXT N_("Resampling quality")
+
+static const int quality_values[] = { 0, 1, 2, 3 };
+static const char *const quality_texts[] = {
+    N_("Low (16 taps)"),
+    N_("Medium (32 taps)"),
+    N_("High (64 taps)"),
+    N_("Very high (128 taps)"),
+};
+
+static int  OpenConverter( vlc_object_t * );
+static int  OpenResampler( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_shortname( N_("Polyphase resampler") )
+    set_description( N_("Polyphase windowed-sinc audio resampler") )
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_RESAMPLER )
+    add_integer( "polyphase-resampler-quality", 1,
+                 QUALITY_TEXT, NULL, true )
+        change_integer_list( quality_values, quality_texts )
+    set_capability( "audio converter", 10 )
+    set_callbacks( OpenConverter, Close )
+
+    add_submodule()
+    set_capability( "audio resampler", 10 )
+    set_callbacks( OpenResampler, Close )
+    add_shortcut( "polyphase" )
+vlc_module_end ()
+
+struct filter_sys_t
+{
+    polyphase_t resampler;
+    unsigned i_in_rate; /* current input rate, changed by the audio output */
+};
+
+static block_t *Resample( filter_t *, block_t * );
+static block_t *Drain( filter_t * );
+static void     Flush( filter_t * );
+
+static int Open( vlc_object_t *p_obj, bool b_variable )
+{
+    filter_t *p_filter = (filter_t *)p_obj;
+
+    /* Cannot convert format nor remix */
+    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_in.audio.i_physical_channels
+            != p_filter->fmt_out.audio.i_physical_channels
+     || p_filter->fmt_in.audio.i_original_channels
+            != p_filter->fmt_out.audio.i_original_channels )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    int64_t i_quality = var_InheritInteger( p_obj,
+                                            "polyphase-resampler-quality" );
+    i_quality = VLC_CLIP( i_quality, 0, POLYPHASE_MAX_QUALITY );
+
+    p_sys->i_in_rate = p_filter->fmt_in.audio.i_rate;
+    if( polyphase_Init( &p_sys->resampler, i_quality,
+                        aout_FormatNbChannels( &p_filter->fmt_in.audio ),
+                        p_filter->fmt_in.audio.i_rate,
+                        p_filter->fmt_out.audio.i_rate, b_variable ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    msg_Dbg( p_filter, "%uHz->%uHz, %u taps, %u phases",
+             p_filter->fmt_in.audio.i_rate, p_filter->fmt_out.audio.i_rate,
+             p_sys->resampler.i_taps, p_sys->resampler.i_phases );
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_audio_filter = Resample;
+    p_filter->pf_audio_drain = Drain;
+    p_filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+static int OpenConverter( vlc_object_t *p_obj )
+{
+    filter_t *p_filter = (filter_t *)p_obj;
+
+    /* Will change rate */
+    if( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate )
+        return VLC_EGENERIC;
+    return Open( p_obj, false );
+}
+
+static int OpenResampler( vlc_object_t *p_obj )
+{
+    return Open( p_obj, true );
+}
+
+static void Close( vlc_object_t *p_obj )
+{
+    filter_t *p_filter = (filter_t *)p_obj;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    polyphase_Clean( &p_sys->resampler );
+    free( p_sys );
+}
+
+static block_t *Resample( filter_t *p_filter, block_t *p_in )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    polyphase_t *p = &p_sys->resampler;
+
+    if( p_in->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        polyphase_Reset( p );
+
+    /* The audio output changes the input rate to compensate drifts */
+    if( p_filter->fmt_in.audio.i_rate != p_sys->i_in_rate )
+    {
+        p_sys->i_in_rate = p_filter->fmt_in.audio.i_rate;
+        polyphase_SetRate( p, p_sys->i_in_rate,
+                           p_filter->fmt_out.audio.i_rate );
+    }
+
+    const size_t i_framesize = p_filter->fmt_out.audio.i_bytes_per_frame;
+    block_t *p_out = block_Alloc( polyphase_GetMaxOutput( p,
+                                      p_in->i_nb_samples ) * i_framesize );
+    if( unlikely(p_out == NULL) )
+        goto out;
+
+    size_t i_frames = polyphase_Process( p, (float *)p_out->p_buffer,
+                                         (const float *)p_in->p_buffer,
+                                         p_in->i_nb_samples );
+    p_out->i_buffer = i_frames * i_framesize;
+    p_out->i_nb_samples = i_frames;
+    p_out->i_flags = p_in->i_flags;
+    p_out->i_pts = p_in->i_pts;
+    p_out->i_length = i_frames * CLOCK_FREQ / p_filter->fmt_out.audio.i_rate;
+out:
+    block_Release( p_in );
+    return p_out;
+}
+
+static block_t *Drain( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    polyphase_t *p = &p_sys->resampler;
+    const size_t i_framesize = p_filter->fmt_out.audio.i_bytes_per_frame;
+
+    block_t *p_out = block_Alloc( polyphase_GetMaxOutput( p, p->i_taps / 2 )
+                                  * i_framesize );
+    if( unlikely(p_out == NULL) )
+        return NULL;
+
+    size_t i_frames = polyphase_Drain( p, (float *)p_out->p_buffer );
+    if( i_frames == 0 )
+    {
+        block_Release( p_out );
+        return NULL;
+    }
+    p_out->i_buffer = i_frames * i_framesize;
+    p_out->i_nb_samples = i_frames;
+    p_out->i_length = i_frames * CLOCK_FREQ / p_filter->fmt_out.audio.i_rate;
+    return p_out;
+}
+
+static void Flush( filter_t *p_filter )
+{
+    polyphase_Reset( &p_filter->p_sys->resampler );
+}
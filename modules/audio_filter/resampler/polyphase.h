@@ -0,0 +1,461 @@
+/*****************************************************************************
+ * polyphase.h: polyphase windowed-sinc resampling
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_POLYPHASE_H
+#define VLC_AUDIO_FILTER_POLYPHASE_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define POLYPHASE_NEON 1
+#endif
+
+/* Each output sample is the dot product of i_taps consecutive input samples
+ * with one phase of a Kaiser-windowed sinc filter bank. The phase is the
+ * fractional position of the output sample between two input samples.
+ *
+ * When the ratio of the rates reduces to at most i_max_phases output
+ * samples, the bank holds one phase per output sample of the period, and
+ * the output is exact. Otherwise, and when the rate may change, the output
+ * is interpolated linearly between the two nearest phases. */
+
+typedef struct
+{
+    unsigned i_taps;        /**< Taps per phase, multiple of 16 */
+    unsigned i_max_phases;  /**< Phases of the interpolated bank */
+    double f_beta;          /**< Kaiser window parameter */
+    double f_rolloff;       /**< Cut-off, relative to the lower Nyquist */
+} polyphase_preset_t;
+
+static const polyphase_preset_t polyphase_presets[] = {
+    {  16,  256,  5., .80 },
+    {  32,  512,  7., .88 },
+    {  64, 1024,  9., .92 },
+    { 128, 1024, 11., .95 },
+};
+#define POLYPHASE_MAX_QUALITY 3
+
+/*****************************************************************************
+ * Dot products: n must be a multiple of 16, and p_coefs 16 bytes aligned.
+ *****************************************************************************/
+typedef float (*polyphase_dot_cb)( const float *, const float *, unsigned );
+
+static float polyphase_dot_C( const float *p_in, const float *p_coefs,
+                              unsigned n )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        s0 += p_in[i] * p_coefs[i];
+        s1 += p_in[i + 1] * p_coefs[i + 1];
+        s2 += p_in[i + 2] * p_coefs[i + 2];
+        s3 += p_in[i + 3] * p_coefs[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static float polyphase_dot_SSE2( const float *p_in, const float *p_coefs,
+                                 unsigned n )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_loadu_ps( &p_in[i] ),
+                                         _mm_load_ps( &p_coefs[i] ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_loadu_ps( &p_in[i + 4] ),
+                                         _mm_load_ps( &p_coefs[i + 4] ) ) );
+    }
+    s0 = _mm_add_ps( s0, s1 );
+    s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+    s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, 1 ) );
+    return _mm_cvtss_f32( s0 );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static float polyphase_dot_AVX2( const float *p_in, const float *p_coefs,
+                                 unsigned n )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+
+    for( unsigned i = 0; i < n; i += 16 )
+    {
+        __m256 a = _mm256_mul_ps( _mm256_loadu_ps( &p_in[i] ),
+                                  _mm256_loadu_ps( &p_coefs[i] ) );
+        __m256 b = _mm256_mul_ps( _mm256_loadu_ps( &p_in[i + 8] ),
+                                  _mm256_loadu_ps( &p_coefs[i + 8] ) );
+        s0 = _mm256_add_ps( s0, a );
+        s1 = _mm256_add_ps( s1, b );
+    }
+    s0 = _mm256_add_ps( s0, s1 );
+
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( s0 ),
+                           _mm256_extractf128_ps( s0, 1 ) );
+    s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s = _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) );
+    return _mm_cvtss_f32( s );
+}
+#endif
+
+#ifdef POLYPHASE_NEON
+static float polyphase_dot_NEON( const float *p_in, const float *p_coefs,
+                                 unsigned n )
+{
+    float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = vdupq_n_f32( 0.f );
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        s0 = vmlaq_f32( s0, vld1q_f32( &p_in[i] ), vld1q_f32( &p_coefs[i] ) );
+        s1 = vmlaq_f32( s1, vld1q_f32( &p_in[i + 4] ),
+                        vld1q_f32( &p_coefs[i + 4] ) );
+    }
+    return vaddvq_f32( vaddq_f32( s0, s1 ) );
+}
+#endif
+
+static inline polyphase_dot_cb polyphase_GetDot( void )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        return polyphase_dot_AVX2;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        return polyphase_dot_SSE2;
+#endif
+#ifdef POLYPHASE_NEON
+    if( vlc_CPU_ARM64_NEON() )
+        return polyphase_dot_NEON;
+#endif
+    return polyphase_dot_C;
+}
+
+/*****************************************************************************
+ * Filter bank
+ *****************************************************************************/
+static inline double polyphase_BesselI0( double x )
+{
+    double f_sum = 1., f_term = 1.;
+
+    for( unsigned k = 1; f_term > 1e-12 * f_sum; k++ )
+    {
+        f_term *= (x / (2. * k)) * (x / (2. * k));
+        f_sum += f_term;
+    }
+    return f_sum;
+}
+
+/**
+ * Computes i_phases + 1 phases of i_taps coefficients, the last one being
+ * the first one delayed by one input sample, so that interpolations between
+ * phases never wrap. Each phase is normalized to a unity gain at DC.
+ */
+static inline float *polyphase_NewBank( unsigned i_taps, unsigned i_phases,
+                                        double f_cutoff, double f_beta )
+{
+    float *p_bank = vlc_memalign( 32, sizeof(float) * i_taps
+                                      * (i_phases + 1) );
+    if( unlikely(p_bank == NULL) )
+        return NULL;
+
+    const double f_half = i_taps / 2;
+    const double f_i0beta = polyphase_BesselI0( f_beta );
+    double pf_coefs[i_taps];
+
+    for( unsigned p = 0; p <= i_phases; p++ )
+    {
+        const double d = (double)p / i_phases;
+        double f_sum = 0.;
+
+        for( unsigned t = 0; t < i_taps; t++ )
+        {
+            /* Distance to the output sample, between -f_half and f_half */
+            const double x = t - (f_half - 1.) - d;
+            const double r = x / f_half;
+            const double w = polyphase_BesselI0( f_beta
+                                 * sqrt( __MAX(1. - r * r, 0.) ) ) / f_i0beta;
+            const double a = M_PI * f_cutoff * x;
+            const double s = fabs( a ) < 1e-9 ? 1. : sin( a ) / a;
+
+            pf_coefs[t] = s * w;
+            f_sum += pf_coefs[t];
+        }
+        for( unsigned t = 0; t < i_taps; t++ )
+            p_bank[p * i_taps + t] = pf_coefs[t] / f_sum;
+    }
+    return p_bank;
+}
+
+/*****************************************************************************
+ * Resampler state
+ *****************************************************************************/
+typedef struct
+{
+    unsigned i_channels;
+    unsigned i_taps;
+    unsigned i_phases;      /**< Phases in the bank */
+    float *p_bank;
+    polyphase_dot_cb pf_dot;
+
+    unsigned i_in_rate;     /**< Reduced input rate */
+    unsigned i_out_rate;    /**< Reduced output rate */
+    unsigned i_frac;        /**< Phase of the next output, in 1/i_out_rate */
+    size_t i_pos;           /**< First input sample of the next output */
+
+    float *p_lines;         /**< One line of input samples per channel */
+    size_t i_line_size;     /**< Allocated samples per line */
+    size_t i_fill;          /**< Samples in each line */
+} polyphase_t;
+
+static inline unsigned polyphase_Gcd( unsigned a, unsigned b )
+{
+    while( b != 0 )
+    {
+        const unsigned c = a % b;
+        a = b;
+        b = c;
+    }
+    return a;
+}
+
+/* Lines start with i_taps / 2 - 1 zeros, so that the first output sample is
+ * centered on the first input sample. */
+static inline void polyphase_Reset( polyphase_t *p )
+{
+    p->i_frac = 0;
+    p->i_pos = 0;
+    p->i_fill = p->i_taps / 2 - 1;
+    for( unsigned c = 0; c < p->i_channels; c++ )
+        memset( &p->p_lines[c * p->i_line_size], 0,
+                p->i_fill * sizeof(float) );
+}
+
+/**
+ * Changes the rates without resetting the state, e.g. to compensate a drift.
+ */
+static inline void polyphase_SetRate( polyphase_t *p, unsigned i_in_rate,
+                                      unsigned i_out_rate )
+{
+    const unsigned i_gcd = polyphase_Gcd( i_in_rate, i_out_rate );
+
+    i_in_rate /= i_gcd;
+    i_out_rate /= i_gcd;
+    p->i_frac = (uint64_t)p->i_frac * i_out_rate / p->i_out_rate;
+    p->i_in_rate = i_in_rate;
+    p->i_out_rate = i_out_rate;
+}
+
+static inline void polyphase_Clean( polyphase_t *p )
+{
+    vlc_free( p->p_bank );
+    free( p->p_lines );
+}
+
+/**
+ * Initializes a resampler for the given quality preset. If b_variable is
+ * true, the rates may later be changed with polyphase_SetRate().
+ */
+static inline int polyphase_Init( polyphase_t *p, unsigned i_quality,
+                                  unsigned i_channels, unsigned i_in_rate,
+                                  unsigned i_out_rate, bool b_variable )
+{
+    const polyphase_preset_t *preset =
+        &polyphase_presets[__MIN(i_quality, POLYPHASE_MAX_QUALITY)];
+    const unsigned i_gcd = polyphase_Gcd( i_in_rate, i_out_rate );
+
+    p->i_channels = i_channels;
+    p->i_taps = preset->i_taps;
+    p->i_in_rate = i_in_rate / i_gcd;
+    p->i_out_rate = i_out_rate / i_gcd;
+    p->i_phases = preset->i_max_phases;
+    if( !b_variable && p->i_out_rate <= p->i_phases )
+        p->i_phases = p->i_out_rate;
+
+    /* Downsampling lowers the cut-off to the output Nyquist frequency */
+    double f_cutoff = preset->f_rolloff;
+    if( i_out_rate < i_in_rate )
+        f_cutoff = f_cutoff * i_out_rate / i_in_rate;
+
+    p->p_bank = polyphase_NewBank( p->i_taps, p->i_phases, f_cutoff,
+                                   preset->f_beta );
+    p->pf_dot = polyphase_GetDot();
+    p->i_line_size = 4096 + p->i_taps;
+    p->p_lines = malloc( sizeof(float) * p->i_line_size * i_channels );
+    if( unlikely(p->p_bank == NULL || p->p_lines == NULL) )
+    {
+        polyphase_Clean( p );
+        return VLC_ENOMEM;
+    }
+    polyphase_Reset( p );
+    return VLC_SUCCESS;
+}
+
+/**
+ * Returns an upper bound of the output frames for i_frames more input
+ * frames.
+ */
+static inline size_t polyphase_GetMaxOutput( const polyphase_t *p,
+                                             size_t i_frames )
+{
+    if( p->i_fill + i_frames <= p->i_pos )
+        return 1;
+
+    const uint64_t i_avail = p->i_fill + i_frames - p->i_pos;
+    return i_avail * p->i_out_rate / p->i_in_rate + 1;
+}
+
+static inline float polyphase_Sample( const polyphase_t *p, const float *p_in,
+                                      uint64_t i_phase, float f_weight )
+{
+    const float *p_coefs = &p->p_bank[i_phase * p->i_taps];
+    float f_out = p->pf_dot( p_in, p_coefs, p->i_taps );
+
+    if( f_weight != 0.f )
+        f_out += f_weight * (p->pf_dot( p_in, p_coefs + p->i_taps, p->i_taps )
+                             - f_out);
+    return f_out;
+}
+
+/**
+ * Resamples interleaved input frames, and returns the number of output
+ * frames, at most polyphase_GetMaxOutput( p, i_frames ).
+ */
+static inline size_t polyphase_Process( polyphase_t *p, float *p_out,
+                                        const float *p_in, size_t i_frames )
+{
+    const unsigned i_channels = p->i_channels;
+
+    /* Append the input frames to the lines */
+    if( p->i_fill + i_frames > p->i_line_size )
+    {
+        const size_t i_size = p->i_fill + i_frames + p->i_taps;
+        float *p_lines = malloc( sizeof(float) * i_size * i_channels );
+        if( unlikely(p_lines == NULL) )
+            return 0;
+        for( unsigned c = 0; c < i_channels; c++ )
+            memcpy( &p_lines[c * i_size], &p->p_lines[c * p->i_line_size],
+                    p->i_fill * sizeof(float) );
+        free( p->p_lines );
+        p->p_lines = p_lines;
+        p->i_line_size = i_size;
+    }
+    for( unsigned c = 0; c < i_channels; c++ )
+    {
+        float *p_line = &p->p_lines[c * p->i_line_size + p->i_fill];
+        for( size_t i = 0; i < i_frames; i++ )
+            p_line[i] = p_in[i * i_channels + c];
+    }
+    p->i_fill += i_frames;
+
+    /* Compute the output frames whose taps are all available */
+    const unsigned i_step = p->i_in_rate / p->i_out_rate;
+    const unsigned i_frac_step = p->i_in_rate % p->i_out_rate;
+    const bool b_exact = p->i_phases == p->i_out_rate;
+    size_t i_out = 0;
+
+    while( p->i_pos + p->i_taps <= p->i_fill )
+    {
+        if( p->i_in_rate == p->i_out_rate )
+        {
+            /* Same rates: the center tap is the input */
+            for( unsigned c = 0; c < i_channels; c++ )
+                *(p_out++) = p->p_lines[c * p->i_line_size + p->i_pos
+                                        + p->i_taps / 2 - 1];
+        }
+        else
+        {
+            uint64_t i_phase = p->i_frac;
+            float f_weight = 0.f;
+
+            if( !b_exact )
+            {
+                const uint64_t x = (uint64_t)p->i_frac * p->i_phases;
+                i_phase = x / p->i_out_rate;
+                f_weight = (float)(x % p->i_out_rate) / p->i_out_rate;
+            }
+            for( unsigned c = 0; c < i_channels; c++ )
+                *(p_out++) = polyphase_Sample( p,
+                    &p->p_lines[c * p->i_line_size + p->i_pos],
+                    i_phase, f_weight );
+        }
+        i_out++;
+
+        p->i_pos += i_step;
+        p->i_frac += i_frac_step;
+        if( p->i_frac >= p->i_out_rate )
+        {
+            p->i_frac -= p->i_out_rate;
+            p->i_pos++;
+        }
+    }
+
+    /* Keep the samples needed by the next output frames */
+    const size_t i_keep = p->i_pos < p->i_fill ? p->i_fill - p->i_pos : 0;
+    for( unsigned c = 0; c < i_channels; c++ )
+    {
+        float *p_line = &p->p_lines[c * p->i_line_size];
+        memmove( p_line, &p_line[p->i_fill - i_keep], i_keep * sizeof(float) );
+    }
+    p->i_pos -= p->i_fill - i_keep;
+    p->i_fill = i_keep;
+    return i_out;
+}
+
+/**
+ * Returns the output frames still held back by the filter delay, at most
+ * polyphase_GetMaxOutput( p, i_taps / 2 ), and resets the resampler.
+ */
+static inline size_t polyphase_Drain( polyphase_t *p, float *p_out )
+{
+    const unsigned i_frames = p->i_taps / 2;
+    float p_zeros[i_frames * p->i_channels];
+
+    memset( p_zeros, 0, sizeof(p_zeros) );
+
+    /* Only the outputs up to the last input sample are meaningful */
+    const size_t i_last = p->i_fill - (p->i_taps / 2 - 1);
+    size_t i_max = 0;
+    if( i_last > p->i_pos )
+        i_max = ((uint64_t)(i_last - p->i_pos) * p->i_out_rate
+                 - p->i_frac + p->i_in_rate - 1) / p->i_in_rate;
+
+    size_t i_out = polyphase_Process( p, p_out, p_zeros, i_frames );
+    polyphase_Reset( p );
+    return __MIN(i_out, i_max);
+}
+
+#endif
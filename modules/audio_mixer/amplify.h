@@ -0,0 +1,472 @@
+/*****************************************************************************
+ * amplify.h: floating point audio amplification
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_MIXER_AMPLIFY_H
+#define VLC_AUDIO_MIXER_AMPLIFY_H
+
+#include <stddef.h>
+
+#include <vlc_cpu.h>
+#include <vlc_es.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define AMPLIFY_NEON 1
+#endif
+
+/* The amplifiers multiply i_frames interleaved frames of i_channels samples
+ * by a gain. If f_from and f_to differ, the gain of frame n goes linearly
+ * from f_from to f_to: f_from + (n + 1) * (f_to - f_from) / i_frames.
+ *
+ * The SIMD versions process the ramps by blocks of as many frames as there
+ * are lanes in a vector, i.e. i_channels vectors, each with its own vector
+ * of frame indexes. They give the same results as the C ones, but for the
+ * rounding of the ramps. */
+
+static inline void amplify_fl32_ramp_C( float *p, size_t i_start,
+                                        size_t i_frames, unsigned i_channels,
+                                        float f_from, float f_step )
+{
+    p += i_start * i_channels;
+    for( size_t n = i_start; n < i_frames; n++ )
+    {
+        const float f_gain = f_from + f_step * (float)(n + 1);
+        for( unsigned c = 0; c < i_channels; c++ )
+            *(p++) *= f_gain;
+    }
+}
+
+static inline void amplify_fl32_C( float *p, size_t i_frames,
+                                   unsigned i_channels,
+                                   float f_from, float f_to )
+{
+    if( f_from == f_to )
+    {
+        for( size_t i = i_frames * i_channels; i > 0; i-- )
+            *(p++) *= f_to;
+        return;
+    }
+    amplify_fl32_ramp_C( p, 0, i_frames, i_channels, f_from,
+                         (f_to - f_from) / i_frames );
+}
+
+static inline void amplify_fl64_ramp_C( double *p, size_t i_start,
+                                        size_t i_frames, unsigned i_channels,
+                                        double f_from, double f_step )
+{
+    p += i_start * i_channels;
+    for( size_t n = i_start; n < i_frames; n++ )
+    {
+        const double f_gain = f_from + f_step * (double)(n + 1);
+        for( unsigned c = 0; c < i_channels; c++ )
+            *(p++) *= f_gain;
+    }
+}
+
+static inline void amplify_fl64_C( double *p, size_t i_frames,
+                                   unsigned i_channels,
+                                   float f_from, float f_to )
+{
+    if( f_from == f_to )
+    {
+        const double mult = f_to;
+        for( size_t i = i_frames * i_channels; i > 0; i-- )
+            *(p++) *= mult;
+        return;
+    }
+    amplify_fl64_ramp_C( p, 0, i_frames, i_channels, f_from,
+                         ((double)f_to - f_from) / i_frames );
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static void amplify_fl32_SSE2( float *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        const __m128 gain = _mm_set1_ps( f_to );
+        size_t i = 0;
+
+        for( ; i + 8 <= i_samples; i += 8 )
+        {
+            __m128 a = _mm_loadu_ps( &p[i] );
+            __m128 b = _mm_loadu_ps( &p[i + 4] );
+            _mm_storeu_ps( &p[i], _mm_mul_ps( a, gain ) );
+            _mm_storeu_ps( &p[i + 4], _mm_mul_ps( b, gain ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= f_to;
+        return;
+    }
+
+    const float f_step = (f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        const __m128 from = _mm_set1_ps( f_from );
+        const __m128 step = _mm_set1_ps( f_step );
+        __m128 index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+            index[j] = _mm_setr_ps( (4 * j + 0) / i_channels + 1,
+                                    (4 * j + 1) / i_channels + 1,
+                                    (4 * j + 2) / i_channels + 1,
+                                    (4 * j + 3) / i_channels + 1 );
+
+        for( ; n + 4 <= i_frames; n += 4 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                float *q = &p[n * i_channels + 4 * j];
+                __m128 gain = _mm_add_ps( from, _mm_mul_ps( step, index[j] ) );
+
+                _mm_storeu_ps( q, _mm_mul_ps( _mm_loadu_ps( q ), gain ) );
+                index[j] = _mm_add_ps( index[j], _mm_set1_ps( 4.f ) );
+            }
+    }
+    amplify_fl32_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void amplify_fl64_SSE2( double *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        const __m128d gain = _mm_set1_pd( f_to );
+        size_t i = 0;
+
+        for( ; i + 4 <= i_samples; i += 4 )
+        {
+            __m128d a = _mm_loadu_pd( &p[i] );
+            __m128d b = _mm_loadu_pd( &p[i + 2] );
+            _mm_storeu_pd( &p[i], _mm_mul_pd( a, gain ) );
+            _mm_storeu_pd( &p[i + 2], _mm_mul_pd( b, gain ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= (double)f_to;
+        return;
+    }
+
+    const double f_step = ((double)f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        const __m128d from = _mm_set1_pd( f_from );
+        const __m128d step = _mm_set1_pd( f_step );
+        __m128d index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+            index[j] = _mm_setr_pd( (2 * j + 0) / i_channels + 1,
+                                    (2 * j + 1) / i_channels + 1 );
+
+        for( ; n + 2 <= i_frames; n += 2 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                double *q = &p[n * i_channels + 2 * j];
+                __m128d gain = _mm_add_pd( from, _mm_mul_pd( step, index[j] ) );
+
+                _mm_storeu_pd( q, _mm_mul_pd( _mm_loadu_pd( q ), gain ) );
+                index[j] = _mm_add_pd( index[j], _mm_set1_pd( 2. ) );
+            }
+    }
+    amplify_fl64_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static void amplify_fl32_AVX2( float *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        const __m256 gain = _mm256_set1_ps( f_to );
+        size_t i = 0;
+
+        for( ; i + 16 <= i_samples; i += 16 )
+        {
+            __m256 a = _mm256_loadu_ps( &p[i] );
+            __m256 b = _mm256_loadu_ps( &p[i + 8] );
+            _mm256_storeu_ps( &p[i], _mm256_mul_ps( a, gain ) );
+            _mm256_storeu_ps( &p[i + 8], _mm256_mul_ps( b, gain ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= f_to;
+        return;
+    }
+
+    const float f_step = (f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        const __m256 from = _mm256_set1_ps( f_from );
+        const __m256 step = _mm256_set1_ps( f_step );
+        __m256 index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+        {
+            float lanes[8];
+            for( unsigned l = 0; l < 8; l++ )
+                lanes[l] = (8 * j + l) / i_channels + 1;
+            index[j] = _mm256_loadu_ps( lanes );
+        }
+
+        for( ; n + 8 <= i_frames; n += 8 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                float *q = &p[n * i_channels + 8 * j];
+                __m256 gain = _mm256_add_ps( from,
+                                             _mm256_mul_ps( step, index[j] ) );
+
+                _mm256_storeu_ps( q, _mm256_mul_ps( _mm256_loadu_ps( q ),
+                                                    gain ) );
+                index[j] = _mm256_add_ps( index[j], _mm256_set1_ps( 8.f ) );
+            }
+    }
+    amplify_fl32_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void amplify_fl64_AVX2( double *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        const __m256d gain = _mm256_set1_pd( f_to );
+        size_t i = 0;
+
+        for( ; i + 8 <= i_samples; i += 8 )
+        {
+            __m256d a = _mm256_loadu_pd( &p[i] );
+            __m256d b = _mm256_loadu_pd( &p[i + 4] );
+            _mm256_storeu_pd( &p[i], _mm256_mul_pd( a, gain ) );
+            _mm256_storeu_pd( &p[i + 4], _mm256_mul_pd( b, gain ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= (double)f_to;
+        return;
+    }
+
+    const double f_step = ((double)f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        const __m256d from = _mm256_set1_pd( f_from );
+        const __m256d step = _mm256_set1_pd( f_step );
+        __m256d index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+            index[j] = _mm256_setr_pd( (4 * j + 0) / i_channels + 1,
+                                       (4 * j + 1) / i_channels + 1,
+                                       (4 * j + 2) / i_channels + 1,
+                                       (4 * j + 3) / i_channels + 1 );
+
+        for( ; n + 4 <= i_frames; n += 4 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                double *q = &p[n * i_channels + 4 * j];
+                __m256d gain = _mm256_add_pd( from,
+                                              _mm256_mul_pd( step, index[j] ) );
+
+                _mm256_storeu_pd( q, _mm256_mul_pd( _mm256_loadu_pd( q ),
+                                                    gain ) );
+                index[j] = _mm256_add_pd( index[j], _mm256_set1_pd( 4. ) );
+            }
+    }
+    amplify_fl64_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+#endif
+
+#ifdef AMPLIFY_NEON
+static void amplify_fl32_NEON( float *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        size_t i = 0;
+
+        for( ; i + 8 <= i_samples; i += 8 )
+        {
+            vst1q_f32( &p[i], vmulq_n_f32( vld1q_f32( &p[i] ), f_to ) );
+            vst1q_f32( &p[i + 4],
+                       vmulq_n_f32( vld1q_f32( &p[i + 4] ), f_to ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= f_to;
+        return;
+    }
+
+    const float f_step = (f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        float32x4_t index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+        {
+            const float lanes[4] = {
+                (4 * j + 0) / i_channels + 1, (4 * j + 1) / i_channels + 1,
+                (4 * j + 2) / i_channels + 1, (4 * j + 3) / i_channels + 1,
+            };
+            index[j] = vld1q_f32( lanes );
+        }
+
+        /* No fused multiply-add, to round like the C version */
+        for( ; n + 4 <= i_frames; n += 4 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                float *q = &p[n * i_channels + 4 * j];
+                float32x4_t gain = vaddq_f32( vdupq_n_f32( f_from ),
+                                              vmulq_n_f32( index[j], f_step ) );
+
+                vst1q_f32( q, vmulq_f32( vld1q_f32( q ), gain ) );
+                index[j] = vaddq_f32( index[j], vdupq_n_f32( 4.f ) );
+            }
+    }
+    amplify_fl32_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+
+static void amplify_fl64_NEON( double *p, size_t i_frames, unsigned i_channels,
+                               float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+
+    if( f_from == f_to )
+    {
+        size_t i = 0;
+
+        for( ; i + 4 <= i_samples; i += 4 )
+        {
+            vst1q_f64( &p[i], vmulq_n_f64( vld1q_f64( &p[i] ), f_to ) );
+            vst1q_f64( &p[i + 2],
+                       vmulq_n_f64( vld1q_f64( &p[i + 2] ), f_to ) );
+        }
+        for( ; i < i_samples; i++ )
+            p[i] *= (double)f_to;
+        return;
+    }
+
+    const double f_step = ((double)f_to - f_from) / i_frames;
+    size_t n = 0;
+
+    if( i_channels <= AOUT_CHAN_MAX )
+    {
+        float64x2_t index[AOUT_CHAN_MAX];
+
+        for( unsigned j = 0; j < i_channels; j++ )
+        {
+            const double lanes[2] = {
+                (2 * j + 0) / i_channels + 1, (2 * j + 1) / i_channels + 1,
+            };
+            index[j] = vld1q_f64( lanes );
+        }
+
+        for( ; n + 2 <= i_frames; n += 2 )
+            for( unsigned j = 0; j < i_channels; j++ )
+            {
+                double *q = &p[n * i_channels + 2 * j];
+                float64x2_t gain = vaddq_f64( vdupq_n_f64( f_from ),
+                                              vmulq_n_f64( index[j], f_step ) );
+
+                vst1q_f64( q, vmulq_f64( vld1q_f64( q ), gain ) );
+                index[j] = vaddq_f64( index[j], vdupq_n_f64( 2. ) );
+            }
+    }
+    amplify_fl64_ramp_C( p, n, i_frames, i_channels, f_from, f_step );
+}
+#endif
+
+static inline void amplify_FL32( float *p, size_t i_frames,
+                                 unsigned i_channels, float f_from, float f_to )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        amplify_fl32_AVX2( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        amplify_fl32_SSE2( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+#ifdef AMPLIFY_NEON
+    if( vlc_CPU_ARM64_NEON() )
+    {
+        amplify_fl32_NEON( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+    amplify_fl32_C( p, i_frames, i_channels, f_from, f_to );
+}
+
+static inline void amplify_FL64( double *p, size_t i_frames,
+                                 unsigned i_channels, float f_from, float f_to )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        amplify_fl64_AVX2( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        amplify_fl64_SSE2( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+#ifdef AMPLIFY_NEON
+    if( vlc_CPU_ARM64_NEON() )
+    {
+        amplify_fl64_NEON( p, i_frames, i_channels, f_from, f_to );
+        return;
+    }
+#endif
+    amplify_fl64_C( p, i_frames, i_channels, f_from, f_to );
+}
+
+#endif
@@ -29,16 +29,20 @@
 # include "config.h"
 #endif
 
+#include <math.h>
 #include <stddef.h>
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "amplify.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-static int Create( vlc_object_t * );
+static int  Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
 
 /*****************************************************************************
  * Module descriptor
@@ -48,37 +52,77 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_AUDIO_MISC )
     set_description( N_("Single precision audio volume") )
     set_capability( "audio volume", 10 )
-    set_callbacks( Create, NULL )
+    set_callbacks( Create, Destroy )
 vlc_module_end ()
 
+/* Gain applied to the end of the previous buffer. When the gain changes, the
+ * next buffer ramps from the previous gain to the new one rather than
+ * stepping, which would click. */
+typedef struct
+{
+    float f_gain;
+} volume_sys_t;
+
+static unsigned GetChannels( const block_t *p_buffer, size_t i_sample_size )
+{
+    const size_t i_samples = p_buffer->i_buffer / i_sample_size;
+
+    if( p_buffer->i_nb_samples == 0 || i_samples % p_buffer->i_nb_samples )
+        return 0;
+    return i_samples / p_buffer->i_nb_samples;
+}
+
+/* Returns the gain at the start of the buffer, and remembers the new one */
+static float UpdateGain( audio_volume_t *p_volume, unsigned i_channels,
+                         float f_multiplier )
+{
+    volume_sys_t *p_sys = p_volume->sys;
+    float f_from = p_sys->f_gain;
+
+    /* Without the frames layout, step as before */
+    if( isnan( f_from ) || i_channels == 0 )
+        f_from = f_multiplier;
+    p_sys->f_gain = f_multiplier;
+    return f_from;
+}
+
 /**
  * Mixes a new output buffer
  */
 static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
-    if( f_multiplier == 1.f )
-        return; /* nothing to do */
+    const unsigned i_channels = GetChannels( p_buffer, sizeof(float) );
+    const float f_from = UpdateGain( p_volume, i_channels, f_multiplier );
 
-    float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
+    if( f_from == 1.f && f_multiplier == 1.f )
+        return; /* nothing to do */
 
-    (void) p_volume;
+    if( i_channels == 0 )
+        amplify_FL32( (float *)p_buffer->p_buffer,
+                      p_buffer->i_buffer / sizeof(float), 1,
+                      f_multiplier, f_multiplier );
+    else
+        amplify_FL32( (float *)p_buffer->p_buffer, p_buffer->i_nb_samples,
+                      i_channels, f_from, f_multiplier );
 }
 
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
-    double *p = (double *)p_buffer->p_buffer;
-    double mult = f_multiplier;
-    if( mult == 1. )
-        return; /* nothing to do */
+    const unsigned i_channels = GetChannels( p_buffer, sizeof(double) );
+    const float f_from = UpdateGain( p_volume, i_channels, f_multiplier );
 
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= mult;
+    if( f_from == 1.f && f_multiplier == 1.f )
+        return; /* nothing to do */
 
-    (void) p_volume;
+    if( i_channels == 0 )
+        amplify_FL64( (double *)p_buffer->p_buffer,
+                      p_buffer->i_buffer / sizeof(double), 1,
+                      f_multiplier, f_multiplier );
+    else
+        amplify_FL64( (double *)p_buffer->p_buffer, p_buffer->i_nb_samples,
+                      i_channels, f_from, f_multiplier );
 }
 
 /**
@@ -99,5 +143,18 @@ static int Create( vlc_object_t *p_this )
         default:
             return -1;
     }
+
+    volume_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+    p_sys->f_gain = NAN;
+    p_volume->sys = p_sys;
     return 0;
 }
+
+static void Destroy( vlc_object_t *p_this )
+{
+    audio_volume_t *p_volume = (audio_volume_t *)p_this;
+
+    free( p_volume->sys );
+}
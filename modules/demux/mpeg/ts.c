@@ -180,6 +180,8 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static unsigned PeekTSPackets( demux_t *p_demux, const uint8_t **pp_peek, unsigned i_max );
+static int SkipTSPackets( demux_t *p_demux, unsigned i_count );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
@@ -599,13 +601,38 @@ static int Demux( demux_t *p_demux )
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
+    /* Packets are peeked in runs of synchronized packets, copied one by one
+     * and only skipped in the stream once the run has been processed */
+    const uint8_t *p_batch = NULL;
+    unsigned i_batch = 0, i_batch_pos = 0;
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
         int          i_header = 0;
         block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+
+        if( i_batch_pos == i_batch )
+        {
+            if( SkipTSPackets( p_demux, i_batch_pos ) )
+                return VLC_DEMUXER_EOF;
+            i_batch = i_batch_pos = 0;
+            if( !p_sys->b_start_record )
+                i_batch = PeekTSPackets( p_demux, &p_batch, p_sys->i_ts_read - i_pkt );
+        }
+
+        if( i_batch_pos < i_batch )
+        {
+            p_pkt = block_Alloc( p_sys->i_packet_size );
+            if( unlikely(!p_pkt) )
+                break;
+            memcpy( p_pkt->p_buffer, &p_batch[i_batch_pos++ * p_sys->i_packet_size],
+                    p_sys->i_packet_size );
+            p_pkt->p_buffer += p_sys->i_packet_header_size;
+            p_pkt->i_buffer -= p_sys->i_packet_header_size;
+        }
+        else if( !(p_pkt = ReadTSPacket( p_demux )) )
         {
             return VLC_DEMUXER_EOF;
         }
@@ -645,6 +672,21 @@ static int Demux( demux_t *p_demux )
                 p_sys->b_valid_scrambling = true;
         }
 
+        /* PSI tables and ES creation may read, seek or replace the stream,
+         * which invalidates the peeked run: end it there and peek again */
+        if( i_batch_pos > 0 &&
+            ( p_pid->type == TYPE_PAT || p_pid->type == TYPE_PMT ||
+              p_pid->type == TYPE_SI || p_pid->type == TYPE_PSIP ||
+              ( p_pid->type == TYPE_PES && p_sys->es_creation == DELAY_ES ) ) )
+        {
+            if( SkipTSPackets( p_demux, i_batch_pos ) )
+            {
+                block_Release( p_pkt );
+                return VLC_DEMUXER_EOF;
+            }
+            i_batch = i_batch_pos = 0;
+        }
+
         /* Drop duplicates and invalid (DOES NOT drop corrupted) */
         p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
         if( !p_pkt )
@@ -734,6 +776,10 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    /* Skip what was actually processed from the current run */
+    if( SkipTSPackets( p_demux, i_batch_pos ) )
+        return VLC_DEMUXER_EOF;
+
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -1696,13 +1742,20 @@ static block_t* ReadTSPacket( demux_t *p_demux )
                 return NULL;
             }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
+            const unsigned i_max = i_peek - p_sys->i_packet_size;
+            while( i_skip < i_max )
             {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+                /* memchr() is vectorized, unlike comparing byte per byte */
+                const uint8_t *p_sync = memchr( &p_peek[i_skip + p_sys->i_packet_header_size],
+                                                0x47, i_max - i_skip );
+                if( p_sync == NULL )
                 {
+                    i_skip = i_max;
                     break;
                 }
+                i_skip = p_sync - p_peek - p_sys->i_packet_header_size;
+                if( p_sync[p_sys->i_packet_size] == 0x47 )
+                    break;
                 i_skip++;
             }
             msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
@@ -1723,6 +1776,52 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/**
+ * Peeks up to i_max packets from the stream, and returns how many of them
+ * are complete and start with a sync byte. Those can be processed without
+ * any further check, and must be skipped from the stream afterwards.
+ */
+static unsigned PeekTSPackets( demux_t *p_demux, const uint8_t **pp_peek, unsigned i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+
+    ssize_t i_peek = vlc_stream_Peek( p_sys->stream, pp_peek, i_size * i_max );
+    if( i_peek < (ssize_t)i_size )
+        return 0;
+
+    const unsigned i_count = i_peek / i_size;
+    const uint8_t *p = *pp_peek + p_sys->i_packet_header_size;
+    unsigned i_synced = 0;
+
+    /* OR the sync bytes differences, four packets at a time */
+    while( i_synced + 4 <= i_count &&
+           ((p[0] ^ 0x47) | (p[i_size] ^ 0x47) |
+            (p[2 * i_size] ^ 0x47) | (p[3 * i_size] ^ 0x47)) == 0 )
+    {
+        p += 4 * i_size;
+        i_synced += 4;
+    }
+    while( i_synced < i_count && p[0] == 0x47 )
+    {
+        p += i_size;
+        i_synced++;
+    }
+
+    return i_synced;
+}
+
+/* Consumes the packets processed from a run returned by PeekTSPackets() */
+static int SkipTSPackets( demux_t *p_demux, unsigned i_count )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const ssize_t i_skip = (ssize_t)i_count * p_sys->i_packet_size;
+
+    if( i_count > 0 && vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
 static mtime_t GetPCR( const block_t *p_pkt )
 {
     const uint8_t *p = p_pkt->p_buffer;
@@ -41,8 +41,8 @@ void ts_pid_list_Init( ts_pid_list_t *p_list )
     p_list->pp_all = NULL;
     p_list->i_all = 0;
     p_list->i_all_alloc = 0;
-    p_list->i_last_pid = 0;
-    p_list->p_last = NULL;
+    for( int i = 0; i < PID_INDEX_BLOCKS; i++ )
+        p_list->pp_index[i] = NULL;
 }
 
 void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
@@ -57,20 +57,59 @@ void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
         free( pid );
     }
     free( p_list->pp_all );
+    for( int i = 0; i < PID_INDEX_BLOCKS; i++ )
+        free( p_list->pp_index[i] );
 }
 
-struct searchkey
+static ts_pid_t * ts_pid_New( ts_pid_list_t *p_list, uint16_t i_pid )
 {
-    int16_t i_pid;
-    ts_pid_t **pp_last;
-};
+    ts_pid_t **pp_block = p_list->pp_index[i_pid >> PID_INDEX_BITS];
+    if( pp_block == NULL )
+    {
+        pp_block = calloc( PID_INDEX_SIZE, sizeof(ts_pid_t *) );
+        if( !pp_block )
+            abort();
+        p_list->pp_index[i_pid >> PID_INDEX_BITS] = pp_block;
+    }
 
-static int ts_bsearch_searchkey_Compare( void *key, void *other )
-{
-    struct searchkey *p_key = (struct searchkey *) key;
-    ts_pid_t *p_pid = *((ts_pid_t **) other);
-    p_key->pp_last = (ts_pid_t **) other;
-    return ( p_key->i_pid >= p_pid->i_pid ) ? p_key->i_pid - p_pid->i_pid : -1;
+    if( p_list->i_all >= p_list->i_all_alloc )
+    {
+        ts_pid_t **p_realloc = realloc( p_list->pp_all,
+                                        (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
+        if( !p_realloc )
+        {
+            abort();
+            //return NULL;
+        }
+        p_list->pp_all = p_realloc;
+        p_list->i_all_alloc += PID_ALLOC_CHUNK;
+    }
+
+    ts_pid_t *p_pid = calloc( 1, sizeof(*p_pid) );
+    if( !p_pid )
+    {
+        abort();
+        //return NULL;
+    }
+
+    p_pid->i_cc  = 0xff;
+    p_pid->i_pid = i_pid;
+
+    /* Keep the enumeration list sorted by PID */
+    int i_index = p_list->i_all;
+    while( i_index > 0 && p_list->pp_all[i_index - 1]->i_pid > i_pid )
+        i_index--;
+
+    memmove( &p_list->pp_all[i_index + 1],
+             &p_list->pp_all[i_index],
+             (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
+
+    p_list->pp_all[i_index] = p_pid;
+    p_list->i_all++;
+
+    pp_block[i_pid & (PID_INDEX_SIZE - 1)] = p_pid;
+
+    return p_pid;
 }
 
 ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
@@ -84,73 +123,20 @@ ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
         case 0x1FFF:
             return &p_list->dummy;
         default:
-            if( p_list->i_last_pid == i_pid )
-                return p_list->p_last;
         break;
     }
 
-    size_t i_index = 0;
-    ts_pid_t *p_pid = NULL;
+    assert( i_pid < 0x2000 );
 
-    if( p_list->pp_all )
+    ts_pid_t **pp_block = p_list->pp_index[i_pid >> PID_INDEX_BITS];
+    if( likely(pp_block) )
     {
-        struct searchkey pidkey;
-        pidkey.i_pid = i_pid;
-        pidkey.pp_last = NULL;
-
-        ts_pid_t **pp_pidk = bsearch( &pidkey, p_list->pp_all, p_list->i_all,
-                                      sizeof(ts_pid_t *), ts_bsearch_searchkey_Compare );
-        if ( pp_pidk )
-            p_pid = *pp_pidk;
-        else
-            i_index = (pidkey.pp_last - p_list->pp_all); /* Last visited index */
+        ts_pid_t *p_pid = pp_block[i_pid & (PID_INDEX_SIZE - 1)];
+        if( likely(p_pid) )
+            return p_pid;
     }
 
-    if( p_pid == NULL )
-    {
-        if( p_list->i_all >= p_list->i_all_alloc )
-        {
-            ts_pid_t **p_realloc = realloc( p_list->pp_all,
-                                            (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
-            if( !p_realloc )
-            {
-                abort();
-                //return NULL;
-            }
-            p_list->pp_all = p_realloc;
-            p_list->i_all_alloc += PID_ALLOC_CHUNK;
-        }
-
-        p_pid = calloc( 1, sizeof(*p_pid) );
-        if( !p_pid )
-        {
-            abort();
-            //return NULL;
-        }
-
-        p_pid->i_cc  = 0xff;
-        p_pid->i_pid = i_pid;
-
-        /* Do insertion based on last bsearch mid point */
-        if( p_list->i_all )
-        {
-            if( p_list->pp_all[i_index]->i_pid < i_pid )
-                i_index++;
-
-            memmove( &p_list->pp_all[i_index + 1],
-                    &p_list->pp_all[i_index],
-                    (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
-        }
-
-        p_list->pp_all[i_index] = p_pid;
-        p_list->i_all++;
-
-    }
-
-    p_list->p_last = p_pid;
-    p_list->i_last_pid = i_pid;
-
-    return p_pid;
+    return ts_pid_New( p_list, i_pid );
 }
 
 ts_pid_t * ts_pid_Next( ts_pid_list_t *p_list, ts_pid_next_context_t *p_ctx )
@@ -79,6 +79,11 @@ struct ts_pid_t
 
 };
 
+/* two levels direct lookup table over the 13 bits PID space */
+#define PID_INDEX_BITS  6
+#define PID_INDEX_SIZE  (1 << PID_INDEX_BITS)
+#define PID_INDEX_BLOCKS (0x2000 >> PID_INDEX_BITS)
+
 struct ts_pid_list_t
 {
     ts_pid_t   pat;
@@ -88,10 +93,8 @@ struct ts_pid_list_t
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
+    /* lookup table, second level allocated on demand */
+    ts_pid_t **pp_index[PID_INDEX_BLOCKS];
 };
 
 /* opacified pid list */
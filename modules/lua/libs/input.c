@@ -208,8 +208,16 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_FLOAT( average_demux_bitrate )
         STATS_INT( demux_corrupted )
         STATS_INT( demux_discontinuity )
+        STATS_INT( cache_hits )
+        STATS_INT( cache_misses )
+        STATS_INT( cache_refills )
         STATS_INT( decoded_audio )
         STATS_INT( decoded_video )
+        STATS_INT( audio_fifo )
+        STATS_INT( video_fifo )
+        STATS_INT( fifo_dropped )
+        STATS_INT( video_decode_p50 )
+        STATS_INT( video_decode_p99 )
         STATS_INT( displayed_pictures )
         STATS_INT( lost_pictures )
         STATS_INT( sent_packets )
@@ -40,16 +40,24 @@
  * Complex scheme using mutliple track to avoid seeking
  */
 
-/* How many tracks we have, currently only used for stream mode */
+/* How many tracks we have at most, currently only used for stream mode */
 #ifdef OPTIMIZE_MEMORY
 #   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
-#   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
+    /* Max size of our cache 128Ko */
+#   define STREAM_CACHE_SIZE  (1024*128)
 #else
-#   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
-#   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
+#   define STREAM_CACHE_TRACK 6
+    /* Max size of our cache 12Mo, shared by the tracks in use */
+#   define STREAM_CACHE_SIZE  (12*1024*1024)
 #endif
+/* How many tracks we start with */
+#define STREAM_CACHE_TRACK_INIT __MIN(3, STREAM_CACHE_TRACK)
+/* Tracks should hold at least that much of the stream, if we can measure its
+ * bitrate, and in any case no less than STREAM_CACHE_TRACK_MIN_SIZE */
+#define STREAM_CACHE_TRACK_DURATION (2*CLOCK_FREQ)
+#define STREAM_CACHE_TRACK_MIN_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+/* How many hard seeks we remember to detect access patterns */
+#define STREAM_CACHE_SEEK_HISTORY 8
 
 /* How many data we try to prebuffer
  * XXX it should be small to avoid useless latency but big enough for
@@ -63,14 +71,25 @@
  *      no: search the ring with i_end the closer to i_pos,
  *          if close enough, read data and use this ring
  *          else use the oldest ring, seek and use it.
+ *  - The cache buffer is split in as many rings as the demuxer seems to use
+ *    regions of the stream: hard seeks coming back close to a previous one
+ *    add a ring, long runs without hard seeks remove one.
+ *  - The read size is doubled when the source is slow to return its first
+ *    data, so that high latency accesses are called less often, and halved
+ *    when fast. Only the first partial read of a refill is timed: the time
+ *    to read a whole chunk grows with its size, and would make the read
+ *    size grow on its own.
  *
  *  TODO: - with access non seekable: use all space available for only one ring, but
  *          we have to support seekable/non-seekable switch on the fly.
- *        - compute a good value for i_read_size
  *        - ?
  */
 #define STREAM_READ_ATONCE 1024
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+#define STREAM_READ_MAX    (128*1024)
+/* Average latency of the source above which the read size is doubled,
+ * and below which it is halved */
+#define STREAM_READ_SLOW   (CLOCK_FREQ/1000)
+#define STREAM_READ_FAST   (CLOCK_FREQ/10000)
 
 typedef struct
 {
@@ -89,14 +108,22 @@ struct stream_sys_t
 
     unsigned     i_offset;   /* Buffer offset in the current track */
     int          i_tk;       /* Current track */
+    int          i_tracks;   /* Tracks in use */
+    unsigned     i_track_size;
     stream_track_t tk[STREAM_CACHE_TRACK];
 
+    /* Hard seeks history */
+    uint64_t     seeks[STREAM_CACHE_SEEK_HISTORY];
+    unsigned     i_seeks;
+    uint64_t     i_seek_pos; /* Reading offset at the last hard seek */
+
     /* Global buffer */
     uint8_t     *p_buffer;
 
     /* */
     unsigned     i_used; /* Used since last read */
     unsigned     i_read_size;
+    mtime_t      i_read_latency; /* Average latency of the source */
 
     struct
     {
@@ -104,9 +131,131 @@ struct stream_sys_t
         uint64_t i_read_count;
         uint64_t i_bytes;
         uint64_t i_read_time;
+
+        /* Stat about consuming data */
+        mtime_t  i_start;
+        uint64_t i_consumed;
+
+        /* Not yet reported to the input */
+        unsigned i_hits;
+        unsigned i_misses;
+        unsigned i_refills;
     } stat;
 };
 
+static void AStreamReportStats(stream_t *s)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (sys->stat.i_hits == 0 && sys->stat.i_misses == 0
+     && sys->stat.i_refills == 0)
+        return;
+
+    vlc_stream_FilterReportCache(s, sys->stat.i_hits, sys->stat.i_misses,
+                                 sys->stat.i_refills);
+    sys->stat.i_hits = sys->stat.i_misses = sys->stat.i_refills = 0;
+}
+
+static void AStreamUpdateReadSize(stream_t *s, mtime_t i_latency)
+{
+    stream_sys_t *sys = s->p_sys;
+    const unsigned i_max = __MIN(STREAM_READ_MAX, sys->i_track_size / 4);
+
+    sys->i_read_latency = (7 * sys->i_read_latency + i_latency) / 8;
+
+    if (sys->i_read_latency > STREAM_READ_SLOW && 2 * sys->i_read_size <= i_max)
+        sys->i_read_size *= 2;
+    else
+    if (sys->i_read_latency < STREAM_READ_FAST
+     && sys->i_read_size / 2 >= STREAM_READ_ATONCE)
+        sys->i_read_size /= 2;
+    else
+        return;
+
+    sys->i_read_latency = 0;
+#ifdef STREAM_DEBUG
+    msg_Dbg(s, "read size now %u bytes", sys->i_read_size);
+#endif
+}
+
+static void AStreamSetupTracks(stream_t *s, int i_tracks, uint64_t i_pos)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    sys->i_tracks = i_tracks;
+    sys->i_track_size = STREAM_CACHE_SIZE / i_tracks;
+    sys->i_offset = 0;
+    sys->i_tk = 0;
+    sys->i_seeks = 0;
+
+    for (int i = 0; i < STREAM_CACHE_TRACK; i++)
+    {
+        sys->tk[i].date  = 0;
+        sys->tk[i].i_start = i_pos;
+        sys->tk[i].i_end   = i_pos;
+        sys->tk[i].p_buffer = (i < i_tracks)
+            ? &sys->p_buffer[i * sys->i_track_size] : NULL;
+    }
+
+    if (sys->i_read_size > sys->i_track_size / 4)
+        sys->i_read_size = __MAX(sys->i_track_size / 4, STREAM_READ_ATONCE);
+}
+
+/**
+ * Checks the access pattern on a hard seek, and tells how many tracks should
+ * be used from now on.
+ */
+static int AStreamTuneTracks(stream_t *s, uint64_t i_pos)
+{
+    stream_sys_t *sys = s->p_sys;
+    int i_tracks = sys->i_tracks;
+
+    /* The tracks should not be smaller than a few seconds of stream */
+    mtime_t i_elapsed = mdate() - sys->stat.i_start;
+    uint64_t i_min_size = STREAM_CACHE_TRACK_MIN_SIZE;
+    if (i_elapsed > CLOCK_FREQ)
+    {
+        uint64_t i_byterate = CLOCK_FREQ * sys->stat.i_consumed / i_elapsed;
+        uint64_t i_size = i_byterate * STREAM_CACHE_TRACK_DURATION / CLOCK_FREQ;
+        i_min_size = __MAX(i_min_size, i_size);
+    }
+    int i_max = __MAX(STREAM_CACHE_SIZE / i_min_size, 1);
+    i_max = __MIN(i_max, STREAM_CACHE_TRACK);
+
+    /* Many hard seeks going back near previous ones: the demuxer reads
+     * more regions of the stream than we have tracks */
+    unsigned i_revisits = 0;
+    for (unsigned i = 0; i < sys->i_seeks; i++)
+    {
+        uint64_t i_delta = sys->seeks[i] > i_pos ? sys->seeks[i] - i_pos
+                                                 : i_pos - sys->seeks[i];
+        if (i_delta < sys->i_track_size)
+            i_revisits++;
+    }
+
+    if (i_revisits >= STREAM_CACHE_SEEK_HISTORY / 4)
+        i_tracks++;
+    /* Read a whole cache worth of data since the last hard seek: the stream
+     * is read sequentially and fewer but bigger tracks suit it better */
+    else if (sys->i_pos - __MIN(sys->i_pos, sys->i_seek_pos) >= STREAM_CACHE_SIZE)
+        i_tracks--;
+
+    i_tracks = VLC_CLIP(i_tracks, 1, i_max);
+
+    if (i_tracks == sys->i_tracks)
+    {
+        if (sys->i_seeks == STREAM_CACHE_SEEK_HISTORY)
+        {
+            memmove(sys->seeks, sys->seeks + 1,
+                    (STREAM_CACHE_SEEK_HISTORY - 1) * sizeof (sys->seeks[0]));
+            sys->i_seeks--;
+        }
+        sys->seeks[sys->i_seeks++] = i_pos;
+    }
+    sys->i_seek_pos = i_pos;
+    return i_tracks;
+}
+
 static int AStreamRefillStream(stream_t *s)
 {
     stream_sys_t *sys = s->p_sys;
@@ -114,7 +263,7 @@ static int AStreamRefillStream(stream_t *s)
 
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN(sys->i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN(sys->i_used, sys->i_track_size -
                (tk->i_end - tk->i_start - sys->i_offset));
 
     if (i_toread <= 0) return VLC_SUCCESS; /* EOF */
@@ -125,16 +274,26 @@ static int AStreamRefillStream(stream_t *s)
 #endif
 
     mtime_t start = mdate();
+    bool b_first = true;
+    sys->stat.i_refills++;
     while (i_toread > 0)
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % sys->i_track_size;
         int i_read;
 
         if (vlc_killed())
             return VLC_EGENERIC;
 
-        i_read = __MIN(i_toread, STREAM_CACHE_TRACK_SIZE - i_off);
-        i_read = vlc_stream_Read(s->p_source, &tk->p_buffer[i_off], i_read);
+        i_read = __MIN(i_toread, (int)(sys->i_track_size - i_off));
+
+        mtime_t i_date = mdate();
+        i_read = vlc_stream_ReadPartial(s->p_source, &tk->p_buffer[i_off],
+                                        i_read);
+        if (b_first)
+        {
+            AStreamUpdateReadSize(s, mdate() - i_date);
+            b_first = false;
+        }
 
         /* msg_Dbg(s, "AStreamRefillStream: read=%d", i_read); */
         if (i_read <  0)
@@ -147,10 +306,10 @@ static int AStreamRefillStream(stream_t *s)
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if (tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end)
+        /* Windows of i_track_size */
+        if (tk->i_start + sys->i_track_size < tk->i_end)
         {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            unsigned i_invalid = tk->i_end - tk->i_start - sys->i_track_size;
 
             tk->i_start += i_invalid;
             sys->i_offset -= i_invalid;
@@ -164,6 +323,7 @@ static int AStreamRefillStream(stream_t *s)
     }
 
     sys->stat.i_read_time += mdate() - start;
+    AStreamReportStats(s);
     return VLC_SUCCESS;
 }
 
@@ -198,10 +358,13 @@ static void AStreamPrebufferStream(stream_t *s)
             break;
         }
 
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
+        i_read = sys->i_track_size - i_buffered;
         i_read = __MIN((int)sys->i_read_size, i_read);
-        i_read = vlc_stream_Read(s->p_source, &tk->p_buffer[i_buffered],
-                                 i_read);
+
+        mtime_t i_date = mdate();
+        i_read = vlc_stream_ReadPartial(s->p_source,
+                                        &tk->p_buffer[i_buffered], i_read);
+        AStreamUpdateReadSize(s, mdate() - i_date);
         if (i_read <  0)
             continue;
         else if (i_read == 0)
@@ -227,18 +390,11 @@ static void AStreamControlReset(stream_t *s)
     stream_sys_t *sys = s->p_sys;
 
     sys->i_pos = 0;
+    sys->i_seek_pos = 0;
 
     /* Setup our tracks */
-    sys->i_offset = 0;
-    sys->i_tk     = 0;
     sys->i_used   = 0;
-
-    for (unsigned i = 0; i < STREAM_CACHE_TRACK; i++)
-    {
-        sys->tk[i].date  = 0;
-        sys->tk[i].i_start = sys->i_pos;
-        sys->tk[i].i_end   = sys->i_pos;
-    }
+    AStreamSetupTracks(s, sys->i_tracks, sys->i_pos);
 
     /* Do the prebuffering */
     AStreamPrebufferStream(s);
@@ -258,9 +414,9 @@ static ssize_t AStreamReadNoSeekStream(stream_t *s, void *buf, size_t len)
             tk->i_start, sys->i_offset, tk->i_end);
 #endif
 
-    unsigned i_off = (tk->i_start + sys->i_offset) % STREAM_CACHE_TRACK_SIZE;
+    unsigned i_off = (tk->i_start + sys->i_offset) % sys->i_track_size;
     size_t i_current = __MIN(tk->i_end - tk->i_start - sys->i_offset,
-                             STREAM_CACHE_TRACK_SIZE - i_off);
+                             sys->i_track_size - i_off);
     ssize_t i_copy = __MIN(i_current, len);
     if (i_copy <= 0)
         return 0; /* EOF */
@@ -273,6 +429,7 @@ static ssize_t AStreamReadNoSeekStream(stream_t *s, void *buf, size_t len)
 
     /* Update pos now */
     sys->i_pos += i_copy;
+    sys->stat.i_consumed += i_copy;
 
     /* */
     sys->i_used += i_copy;
@@ -280,8 +437,8 @@ static ssize_t AStreamReadNoSeekStream(stream_t *s, void *buf, size_t len)
     if (tk->i_end + i_copy <= tk->i_start + sys->i_offset + len)
     {
         const size_t i_read_requested = VLC_CLIP(len - i_copy,
-                                                 STREAM_READ_ATONCE / 2,
-                                                 STREAM_READ_ATONCE * 10);
+                                                 sys->i_read_size / 2,
+                                                 sys->i_read_size * 10);
         if (sys->i_used < i_read_requested)
             sys->i_used = i_read_requested;
 
@@ -340,7 +497,7 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
     if (!tk)
     {
         /* Try to maximize already read data */
-        for (int i = 0; i < STREAM_CACHE_TRACK; i++)
+        for (int i = 0; i < sys->i_tracks; i++)
         {
             stream_track_t *t = &sys->tk[i];
 
@@ -357,7 +514,7 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
     if (!tk)
     {
         /* Use the oldest unused */
-        for (int i = 0; i < STREAM_CACHE_TRACK; i++)
+        for (int i = 0; i < sys->i_tracks; i++)
         {
             stream_track_t *t = &sys->tk[i];
 
@@ -368,7 +525,7 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
             }
         }
     }
-    assert(i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK);
+    assert(i_tk_idx >= 0 && i_tk_idx < sys->i_tracks);
 
     if (tk != p_current)
         i_skip_threshold = 0;
@@ -380,6 +537,7 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
                  i_tk_idx, tk->i_start, tk->i_end,
                  tk != p_current ? "seek" : i_pos > tk->i_end ? "skip" : "noseek");
 #endif
+        sys->stat.i_hits++;
         if (tk != p_current)
         {
             assert(b_aseek);
@@ -416,12 +574,24 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
         msg_Err(s, "AStreamSeekStream: hard seek");
 #endif
         /* Nothing good, seek and choose oldest segment */
+        sys->stat.i_misses++;
+        int i_tracks = AStreamTuneTracks(s, i_pos);
+
         if (vlc_stream_Seek(s->p_source, i_pos))
         {
             msg_Err(s, "AStreamSeekStream: hard seek failed");
             return VLC_EGENERIC;
         }
 
+        if (i_tracks != sys->i_tracks)
+        {
+            AStreamSetupTracks(s, i_tracks, i_pos);
+            msg_Dbg(s, "using %d tracks of %u bytes", sys->i_tracks,
+                    sys->i_track_size);
+            tk = &sys->tk[0];
+            i_tk_idx = 0;
+        }
+
         tk->i_start = i_pos;
         tk->i_end   = i_pos;
     }
@@ -436,8 +606,8 @@ static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
      */
     if (tk->i_end < tk->i_start + sys->i_offset + sys->i_read_size)
     {
-        if (sys->i_used < STREAM_READ_ATONCE / 2)
-            sys->i_used = STREAM_READ_ATONCE / 2;
+        if (sys->i_used < sys->i_read_size / 2)
+            sys->i_used = sys->i_read_size / 2;
 
         if (AStreamRefillStream(s))
             return VLC_EGENERIC;
@@ -521,12 +691,15 @@ static int Open(vlc_object_t *obj)
     sys->stat.i_bytes = 0;
     sys->stat.i_read_time = 0;
     sys->stat.i_read_count = 0;
+    sys->stat.i_start = mdate();
+    sys->stat.i_consumed = 0;
+    sys->stat.i_hits = 0;
+    sys->stat.i_misses = 0;
+    sys->stat.i_refills = 0;
 
     msg_Dbg(s, "Using stream method for AStream*");
 
     /* Allocate/Setup our tracks */
-    sys->i_offset = 0;
-    sys->i_tk     = 0;
     sys->p_buffer = malloc(STREAM_CACHE_SIZE);
     if (sys->p_buffer == NULL)
     {
@@ -536,19 +709,14 @@ static int Open(vlc_object_t *obj)
 
     sys->i_used   = 0;
     sys->i_read_size = STREAM_READ_ATONCE;
+    sys->i_read_latency = 0;
 #if STREAM_READ_ATONCE < 256
 #   error "Invalid STREAM_READ_ATONCE value"
 #endif
-
-    for (unsigned i = 0; i < STREAM_CACHE_TRACK; i++)
-    {
-        sys->tk[i].date  = 0;
-        sys->tk[i].i_start = sys->i_pos;
-        sys->tk[i].i_end   = sys->i_pos;
-        sys->tk[i].p_buffer = &sys->p_buffer[i * STREAM_CACHE_TRACK_SIZE];
-    }
+    sys->i_seek_pos = 0;
 
     s->p_sys = sys;
+    AStreamSetupTracks(s, STREAM_CACHE_TRACK_INIT, sys->i_pos);
 
     /* Do the prebuffering */
     AStreamPrebufferStream(s);
@@ -575,6 +743,7 @@ static void Close(vlc_object_t *obj)
     stream_t *s = (stream_t *)obj;
     stream_sys_t *sys = s->p_sys;
 
+    AStreamReportStats(s);
     free(sys->p_buffer);
     free(sys);
 }
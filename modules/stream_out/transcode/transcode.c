@@ -134,6 +134,10 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define PIPELINE_TEXT N_("Filter video in a separate thread")
+#define PIPELINE_LONGTEXT N_( "Runs the video filters (deinterlacing, " \
+    "scaling...) in their own thread, between the decoder and the encoder " \
+    "thread, when threads > 0." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -221,6 +225,8 @@ vlc_module_begin ()
                  THREADS_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "pool-size", 10, POOL_TEXT, POOL_LONGTEXT, true )
         change_integer_range( 1, 1000 )
+    add_bool( SOUT_CFG_PREFIX "pipeline", false, PIPELINE_TEXT,
+              PIPELINE_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
 
@@ -232,7 +238,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "pipeline", NULL
 };
 
 /*****************************************************************************
@@ -376,6 +382,12 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
+    p_sys->b_pipeline = var_GetBool( p_stream, SOUT_CFG_PREFIX "pipeline" );
+    if( p_sys->b_pipeline && p_sys->i_threads <= 0 )
+    {
+        msg_Warn( p_stream, "video filters thread requires threads > 0" );
+        p_sys->b_pipeline = false;
+    }
 
     if( p_sys->i_vcodec )
     {
@@ -26,6 +26,16 @@ struct sout_stream_sys_t
     uint32_t        pool_size;
     vlc_thread_t    thread;
 
+    /* Video filters thread, between the decoder and the encoder thread */
+    bool            b_pipeline;
+    bool            b_filter_abort;
+    unsigned        i_filter_pending;
+    picture_fifo_t *pp_filter_pics;
+    vlc_mutex_t     lock_filter;
+    vlc_cond_t      cond_filter;
+    vlc_cond_t      cond_filter_done;
+    vlc_thread_t    filter_thread;
+
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
     char            *psz_aenc;
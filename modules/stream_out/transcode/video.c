@@ -30,6 +30,7 @@
 
 #include "transcode.h"
 
+#include <assert.h>
 #include <math.h>
 #include <vlc_meta.h>
 #include <vlc_spu.h>
@@ -66,6 +67,9 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
+static void* FilterThread( void * );
+static void FilterThreadStop( sout_stream_sys_t * );
+
 static void* EncoderThread( void *obj )
 {
     sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
@@ -246,6 +250,33 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         free( id->p_decoder->p_owner );
         return VLC_EGENERIC;
     }
+
+    if( p_sys->b_pipeline )
+    {
+        p_sys->pp_filter_pics = picture_fifo_New();
+        if( p_sys->pp_filter_pics != NULL )
+        {
+            vlc_mutex_init( &p_sys->lock_filter );
+            vlc_cond_init( &p_sys->cond_filter );
+            vlc_cond_init( &p_sys->cond_filter_done );
+            p_sys->i_filter_pending = 0;
+            p_sys->b_filter_abort = false;
+            if( vlc_clone( &p_sys->filter_thread, FilterThread, p_stream,
+                           i_priority ) )
+            {
+                vlc_cond_destroy( &p_sys->cond_filter_done );
+                vlc_cond_destroy( &p_sys->cond_filter );
+                vlc_mutex_destroy( &p_sys->lock_filter );
+                picture_fifo_Delete( p_sys->pp_filter_pics );
+                p_sys->b_pipeline = false;
+            }
+        }
+        else
+            p_sys->b_pipeline = false;
+
+        if( !p_sys->b_pipeline )
+            msg_Warn( p_stream, "cannot spawn video filters thread" );
+    }
     return VLC_SUCCESS;
 }
 
@@ -610,6 +641,8 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
+    FilterThreadStop( p_stream->p_sys );
+
     if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
     {
         vlc_mutex_lock( &p_stream->p_sys->lock_out );
@@ -718,6 +751,117 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         picture_Release( p_pic );
 }
 
+/* Run the filter and output chains; first with the picture,
+ * and then with NULL as many times as we need until they
+ * stop outputting frames.
+ */
+static void FilterFrame( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                         picture_t *p_pic, block_t **out )
+{
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
+
+        for ( ;; ) {
+            picture_t *p_user_filtered_pic = p_filtered_pic;
+
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
+                break;
+
+            OutputFrame( p_stream, p_user_filtered_pic, id, out );
+
+            p_filtered_pic = NULL;
+        }
+
+        p_pic = NULL;
+    }
+}
+
+static void* FilterThread( void *obj )
+{
+    sout_stream_t *p_stream = obj;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = p_sys->id_video;
+    picture_t *p_pic;
+    int canc = vlc_savecancel ();
+
+    vlc_mutex_lock( &p_sys->lock_filter );
+    for( ;; )
+    {
+        while( !p_sys->b_filter_abort &&
+               (p_pic = picture_fifo_Pop( p_sys->pp_filter_pics )) == NULL )
+            vlc_cond_wait( &p_sys->cond_filter, &p_sys->lock_filter );
+
+        if( p_sys->b_filter_abort )
+            break;
+
+        /* The filters are only reconfigured while no pictures are pending,
+         * see FilterThreadDrain() */
+        vlc_mutex_unlock( &p_sys->lock_filter );
+        /* Encoder thread is running: nothing is returned here */
+        FilterFrame( p_stream, id, p_pic, NULL );
+        vlc_mutex_lock( &p_sys->lock_filter );
+
+        assert( p_sys->i_filter_pending > 0 );
+        p_sys->i_filter_pending--;
+        vlc_cond_signal( &p_sys->cond_filter_done );
+    }
+    vlc_mutex_unlock( &p_sys->lock_filter );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+/* Waits for room in the filters queue and queues a decoded picture */
+static void FilterThreadQueue( sout_stream_sys_t *p_sys, picture_t *p_pic )
+{
+    vlc_mutex_lock( &p_sys->lock_filter );
+    while( p_sys->i_filter_pending >= p_sys->pool_size )
+        vlc_cond_wait( &p_sys->cond_filter_done, &p_sys->lock_filter );
+    p_sys->i_filter_pending++;
+    picture_fifo_Push( p_sys->pp_filter_pics, p_pic );
+    vlc_cond_signal( &p_sys->cond_filter );
+    vlc_mutex_unlock( &p_sys->lock_filter );
+}
+
+/* Waits until all queued pictures went through the filters */
+static void FilterThreadDrain( sout_stream_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->lock_filter );
+    while( p_sys->i_filter_pending > 0 )
+        vlc_cond_wait( &p_sys->cond_filter_done, &p_sys->lock_filter );
+    vlc_mutex_unlock( &p_sys->lock_filter );
+}
+
+static void FilterThreadStop( sout_stream_sys_t *p_sys )
+{
+    if( !p_sys->b_pipeline )
+        return;
+
+    FilterThreadDrain( p_sys );
+
+    vlc_mutex_lock( &p_sys->lock_filter );
+    p_sys->b_filter_abort = true;
+    vlc_cond_signal( &p_sys->cond_filter );
+    vlc_mutex_unlock( &p_sys->lock_filter );
+    vlc_join( p_sys->filter_thread, NULL );
+
+    picture_fifo_Delete( p_sys->pp_filter_pics );
+    vlc_cond_destroy( &p_sys->cond_filter_done );
+    vlc_cond_destroy( &p_sys->cond_filter );
+    vlc_mutex_destroy( &p_sys->lock_filter );
+    p_sys->b_pipeline = false;
+}
+
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
@@ -738,6 +882,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         else
         {
             msg_Dbg( p_stream, "Flushing thread and waiting that");
+            /* Pending pictures go through the filters before the encoder
+             * thread is told to stop */
+            FilterThreadStop( p_sys );
             vlc_mutex_lock( &p_stream->p_sys->lock_out );
             p_stream->p_sys->b_abort = true;
             vlc_cond_signal( &p_stream->p_sys->cond );
@@ -757,6 +904,13 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     while( (p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in )) )
     {
+        if( unlikely( p_sys->b_pipeline &&
+             ( !id->p_encoder->p_module ||
+               !video_format_IsSimilar( &id->fmt_input_video, &id->p_decoder->fmt_out.video ) ) ) )
+        {
+            /* The filters are about to be recreated */
+            FilterThreadDrain( p_sys );
+        }
 
         if( unlikely (
              id->p_encoder->p_module &&
@@ -811,35 +965,10 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             }
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
-
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
-                break;
-
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
-            }
-
-            p_pic = NULL;
-        }
+        if( p_sys->b_pipeline )
+            FilterThreadQueue( p_sys, p_pic );
+        else
+            FilterFrame( p_stream, id, p_pic, out );
     }
 
     if( p_sys->i_threads >= 1 )
@@ -30,7 +30,20 @@
 #include <vlc_cpu.h>
 #include <assert.h>
 
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
 #include "copy.h"
+#include "yuv_pack.h"
+
+#ifdef CAN_COMPILE_SSE2
+static struct copy_threads *CopyThreadsNew(size_t size);
+static void CopyThreadsDelete(struct copy_threads *threads);
+
+/* Frames at least this wide are copied by several threads */
+#define COPY_THREADS_MIN_WIDTH 2560
+#endif
 
 int CopyInitCache(copy_cache_t *cache, unsigned width)
 {
@@ -39,6 +52,9 @@ int CopyInitCache(copy_cache_t *cache, unsigned width)
     cache->buffer = vlc_memalign(64, cache->size);
     if (!cache->buffer)
         return VLC_EGENERIC;
+    cache->threads = NULL;
+    if (width >= COPY_THREADS_MIN_WIDTH)
+        cache->threads = CopyThreadsNew(cache->size);
 #else
     (void) cache; (void) width;
 #endif
@@ -48,6 +64,9 @@ int CopyInitCache(copy_cache_t *cache, unsigned width)
 void CopyCleanCache(copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
+    if (cache->threads != NULL)
+        CopyThreadsDelete(cache->threads);
+    cache->threads = NULL;
     vlc_free(cache->buffer);
     cache->buffer = NULL;
     cache->size   = 0;
@@ -93,6 +112,11 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSE2() ((cpu & VLC_CPU_SSE2) != 0)
 #endif
 
+#ifndef __AVX2__
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() ((cpu & VLC_CPU_AVX2) != 0)
+#endif
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -261,13 +285,133 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+#ifdef HAVE_AVX2_INTRINSICS
+/* Same as CopyFromUswc() with 32-byte streaming loads */
+__attribute__ ((__target__ ("avx2")))
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height)
+{
+    assert(((intptr_t)dst & 0x1f) == 0 && (dst_pitch & 0x1f) == 0);
+
+    _mm_mfence();
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned unaligned = __MIN((-(uintptr_t)src) & 0x1f, width);
+        unsigned x = 0;
+
+        for (; x < unaligned; x++)
+            dst[x] = src[x];
+
+        for (; x+127 < width; x += 128) {
+            const __m256i *in = (const __m256i *)&src[x];
+            __m256i a = _mm256_stream_load_si256(&in[0]);
+            __m256i b = _mm256_stream_load_si256(&in[1]);
+            __m256i c = _mm256_stream_load_si256(&in[2]);
+            __m256i d = _mm256_stream_load_si256(&in[3]);
+            _mm256_storeu_si256((__m256i *)&dst[x], a);
+            _mm256_storeu_si256((__m256i *)&dst[x+32], b);
+            _mm256_storeu_si256((__m256i *)&dst[x+64], c);
+            _mm256_storeu_si256((__m256i *)&dst[x+96], d);
+        }
+        for (; x+31 < width; x += 32)
+            _mm256_storeu_si256((__m256i *)&dst[x],
+                _mm256_stream_load_si256((const __m256i *)&src[x]));
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_mfence();
+}
+
+/* Copy from our cache with non-temporal stores, so that the destination
+ * does not evict the cache (nor anything else) */
+__attribute__ ((__target__ ("avx2")))
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned unaligned = __MIN((-(uintptr_t)dst) & 0x1f, width);
+        unsigned x = 0;
+
+        for (; x < unaligned; x++)
+            dst[x] = src[x];
+
+        for (; x+63 < width; x += 64) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[x+32]);
+            _mm256_stream_si256((__m256i *)&dst[x], a);
+            _mm256_stream_si256((__m256i *)&dst[x+32], b);
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+                                             1, 3, 5, 7, 9, 11, 13, 15,
+                                             0, 2, 4, 6, 8, 10, 12, 14,
+                                             1, 3, 5, 7, 9, 11, 13, 15);
+
+    for (unsigned y = 0; y < height; y++) {
+        const bool aligned = (((uintptr_t)dstu | (uintptr_t)dstv) & 0x1f) == 0;
+        unsigned x = 0;
+
+        for (; x+31 < width; x += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[2*x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[2*x+32]);
+
+            /* U0-7 V0-7 | U8-15 V8-15 -> U0-15 | V0-15 */
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle),
+                                         _MM_SHUFFLE(3, 1, 2, 0));
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle),
+                                         _MM_SHUFFLE(3, 1, 2, 0));
+
+            __m256i u = _mm256_permute2x128_si256(a, b, 0x20);
+            __m256i v = _mm256_permute2x128_si256(a, b, 0x31);
+            if (aligned) {
+                _mm256_stream_si256((__m256i *)&dstu[x], u);
+                _mm256_stream_si256((__m256i *)&dstv[x], v);
+            } else {
+                _mm256_storeu_si256((__m256i *)&dstu[x], u);
+                _mm256_storeu_si256((__m256i *)&dstv[x], v);
+            }
+        }
+
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+#endif
+
 static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           const uint8_t *src, size_t src_pitch,
                           uint8_t *cache, size_t cache_size,
                           unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (src_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    /* Do not write past the end of the destination lines */
+    const unsigned width = __MIN(src_pitch, dst_pitch);
+    const unsigned w32 = (width+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     if (src_pitch == dst_pitch)
@@ -276,15 +420,25 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
-        /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16,
-                     src, src_pitch,
-                     src_pitch, hblock, cpu);
-
-        /* Copy from our cache to the destination */
-        Copy2d(dst, dst_pitch,
-               cache, w16,
-               src_pitch, hblock);
+#ifdef HAVE_AVX2_INTRINSICS
+        if (vlc_CPU_AVX2()) {
+            AVX2_CopyFromUswc(cache, w32, src, src_pitch,
+                              width, hblock);
+            AVX2_Copy2d(dst, dst_pitch, cache, w32,
+                        width, hblock);
+        } else
+#endif
+        {
+            /* Copy a bunch of line into our cache */
+            CopyFromUswc(cache, w32,
+                         src, src_pitch,
+                         width, hblock, cpu);
+
+            /* Copy from our cache to the destination */
+            Copy2d(dst, dst_pitch,
+                   cache, w32,
+                   width, hblock);
+        }
 
         /* */
         src += src_pitch * hblock;
@@ -298,20 +452,32 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                             uint8_t *cache, size_t cache_size,
                             unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (2*src_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    /* Do not write past the end of the destination lines */
+    const unsigned width = __MIN(src_pitch / 2, __MIN(dstu_pitch, dstv_pitch));
+    const unsigned w32 = (2*width+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
-        /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch,
-                     2*src_pitch, hblock, cpu);
+#ifdef HAVE_AVX2_INTRINSICS
+        if (vlc_CPU_AVX2()) {
+            AVX2_CopyFromUswc(cache, w32, src, src_pitch,
+                              2*width, hblock);
+            AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                         cache, w32, width, hblock);
+        } else
+#endif
+        {
+            /* Copy a bunch of line into our cache */
+            CopyFromUswc(cache, w32, src, src_pitch,
+                         2*width, hblock, cpu);
 
-        /* Copy from our cache to the destination */
-        SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, src_pitch, hblock, cpu);
+            /* Copy from our cache to the destination */
+            SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                        cache, w32, width, hblock, cpu);
+        }
 
         /* */
         src  += src_pitch  * hblock;
@@ -320,20 +486,219 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+/* A plane copy (dst[1] == NULL) or split, cut in bands of lines */
+typedef struct
+{
+    uint8_t *dst[2];
+    size_t dst_pitch[2];
+    const uint8_t *src;
+    size_t src_pitch;
+    unsigned height;
+    unsigned cpu;
+} copy_job_t;
+
+static void SSE_CopyBand(const copy_job_t *job, unsigned band, unsigned bands,
+                         uint8_t *cache, size_t cache_size)
+{
+    const unsigned start = (uint64_t)job->height * band / bands;
+    const unsigned end = (uint64_t)job->height * (band + 1) / bands;
+    const uint8_t *src = &job->src[start * job->src_pitch];
+    uint8_t *dst0 = &job->dst[0][start * job->dst_pitch[0]];
+
+    if (job->dst[1] == NULL)
+        SSE_CopyPlane(dst0, job->dst_pitch[0], src, job->src_pitch,
+                      cache, cache_size, end - start, job->cpu);
+    else
+        SSE_SplitPlanes(dst0, job->dst_pitch[0],
+                        &job->dst[1][start * job->dst_pitch[1]],
+                        job->dst_pitch[1], src, job->src_pitch,
+                        cache, cache_size, end - start, job->cpu);
+
+    /* Make the non-temporal stores visible to the other threads */
+    asm volatile ("sfence" ::: "memory");
+}
+
+/* Bands smaller than this are not worth a context switch */
+#define COPY_BAND_MIN_LINES 64
+#define COPY_THREADS_MAX 4
+
+struct copy_helper
+{
+    vlc_thread_t thread;
+    struct copy_threads *owner;
+    uint8_t *buffer;
+    unsigned band;
+};
+
+/* Helper threads of a cache, each copying one band of every job */
+struct copy_threads
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait_job;
+    vlc_cond_t wait_done;
+    const copy_job_t *job;
+    unsigned serial; /**< Incremented for each job */
+    unsigned pending; /**< Helpers still working on the job */
+    bool exit;
+
+    size_t size;
+    unsigned count;
+    struct copy_helper helpers[];
+};
+
+static void *CopyThread(void *data)
+{
+    struct copy_helper *helper = data;
+    struct copy_threads *threads = helper->owner;
+    unsigned serial = 0;
+
+    vlc_mutex_lock(&threads->lock);
+    for (;;) {
+        while (threads->serial == serial && !threads->exit)
+            vlc_cond_wait(&threads->wait_job, &threads->lock);
+        if (threads->exit)
+            break;
+
+        const copy_job_t *job = threads->job;
+        serial = threads->serial;
+        vlc_mutex_unlock(&threads->lock);
+
+        SSE_CopyBand(job, helper->band, threads->count + 1,
+                     helper->buffer, threads->size);
+
+        vlc_mutex_lock(&threads->lock);
+        if (--threads->pending == 0)
+            vlc_cond_signal(&threads->wait_done);
+    }
+    vlc_mutex_unlock(&threads->lock);
+    return NULL;
+}
+
+static struct copy_threads *CopyThreadsNew(size_t size)
+{
+    const unsigned count = __MIN(vlc_GetCPUCount(), COPY_THREADS_MAX) - 1;
+    if (count == 0)
+        return NULL;
+
+    struct copy_threads *threads =
+        malloc(sizeof(*threads) + count * sizeof(threads->helpers[0]));
+    if (unlikely(threads == NULL))
+        return NULL;
+
+    vlc_mutex_init(&threads->lock);
+    vlc_cond_init(&threads->wait_job);
+    vlc_cond_init(&threads->wait_done);
+    threads->job = NULL;
+    threads->serial = 0;
+    threads->pending = 0;
+    threads->exit = false;
+    threads->size = size;
+    threads->count = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        struct copy_helper *helper = &threads->helpers[i];
+
+        helper->owner = threads;
+        helper->band = i + 1;
+        helper->buffer = vlc_memalign(64, size);
+        if (helper->buffer == NULL)
+            break;
+        if (vlc_clone(&helper->thread, CopyThread, helper,
+                      VLC_THREAD_PRIORITY_VIDEO)) {
+            vlc_free(helper->buffer);
+            break;
+        }
+        threads->count++;
+    }
+
+    if (threads->count == 0) {
+        CopyThreadsDelete(threads);
+        return NULL;
+    }
+    return threads;
+}
+
+static void CopyThreadsDelete(struct copy_threads *threads)
+{
+    vlc_mutex_lock(&threads->lock);
+    threads->exit = true;
+    vlc_cond_broadcast(&threads->wait_job);
+    vlc_mutex_unlock(&threads->lock);
+
+    for (unsigned i = 0; i < threads->count; i++) {
+        vlc_join(threads->helpers[i].thread, NULL);
+        vlc_free(threads->helpers[i].buffer);
+    }
+
+    vlc_cond_destroy(&threads->wait_done);
+    vlc_cond_destroy(&threads->wait_job);
+    vlc_mutex_destroy(&threads->lock);
+    free(threads);
+}
+
+static void SSE_CopyRun(copy_cache_t *cache, const copy_job_t *job)
+{
+    struct copy_threads *threads = cache->threads;
+
+    if (threads == NULL || job->height < 2 * COPY_BAND_MIN_LINES) {
+        SSE_CopyBand(job, 0, 1, cache->buffer, cache->size);
+        return;
+    }
+
+    /* The job lives on the stack: do not let the caller be cancelled */
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&threads->lock);
+    threads->job = job;
+    threads->serial++;
+    threads->pending = threads->count;
+    vlc_cond_broadcast(&threads->wait_job);
+    vlc_mutex_unlock(&threads->lock);
+
+    SSE_CopyBand(job, 0, threads->count + 1, cache->buffer, cache->size);
+
+    vlc_mutex_lock(&threads->lock);
+    while (threads->pending > 0)
+        vlc_cond_wait(&threads->wait_done, &threads->lock);
+    vlc_mutex_unlock(&threads->lock);
+
+    vlc_restorecancel(canc);
+}
+
+static void SSE_CopyPlaneRun(copy_cache_t *cache,
+                             uint8_t *dst, size_t dst_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned height, unsigned cpu)
+{
+    const copy_job_t job = {
+        { dst, NULL }, { dst_pitch, 0 }, src, src_pitch, height, cpu,
+    };
+    SSE_CopyRun(cache, &job);
+}
+
+static void SSE_SplitPlanesRun(copy_cache_t *cache,
+                               uint8_t *dstu, size_t dstu_pitch,
+                               uint8_t *dstv, size_t dstv_pitch,
+                               const uint8_t *src, size_t src_pitch,
+                               unsigned height, unsigned cpu)
+{
+    const copy_job_t job = {
+        { dstu, dstv }, { dstu_pitch, dstv_pitch }, src, src_pitch, height,
+        cpu,
+    };
+    SSE_CopyRun(cache, &job);
+}
+
 static void SSE_CopyFromNv12(picture_t *dst,
                              uint8_t *src[2], size_t src_pitch[2],
                              unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  height, cpu);
-    SSE_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                    dst->p[1].p_pixels, dst->p[1].i_pitch,
-                    src[1], src_pitch[1],
-                    cache->buffer, cache->size,
-                    (height+1)/2, cpu);
+    SSE_CopyPlaneRun(cache, dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, cpu);
+    SSE_SplitPlanesRun(cache, dst->p[2].p_pixels, dst->p[2].i_pitch,
+                       dst->p[1].p_pixels, dst->p[1].i_pitch,
+                       src[1], src_pitch[1], (height+1)/2, cpu);
     asm volatile ("emms");
 }
 
@@ -344,10 +709,8 @@ static void SSE_CopyFromYv12(picture_t *dst,
 {
     for (unsigned n = 0; n < 3; n++) {
         const unsigned d = n > 0 ? 2 : 1;
-        SSE_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
-                      src[n], src_pitch[n],
-                      cache->buffer, cache->size,
-                      (height+d-1)/d, cpu);
+        SSE_CopyPlaneRun(cache, dst->p[n].p_pixels, dst->p[n].i_pitch,
+                         src[n], src_pitch[n], (height+d-1)/d, cpu);
     }
     asm volatile ("emms");
 }
@@ -358,14 +721,10 @@ static void SSE_CopyFromNv12ToNv12(picture_t *dst,
                              unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  height, cpu);
-    SSE_CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
-                  src[1], src_pitch[1],
-                  cache->buffer, cache->size,
-                  height/2, cpu);
+    SSE_CopyPlaneRun(cache, dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, cpu);
+    SSE_CopyPlaneRun(cache, dst->p[1].p_pixels, dst->p[1].i_pitch,
+                     src[1], src_pitch[1], height/2, cpu);
     asm volatile ("emms");
 }
 
@@ -374,10 +733,8 @@ static void SSE_CopyFromI420ToNv12(picture_t *dst,
                              unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  height, cpu);
+    SSE_CopyPlaneRun(cache, dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, cpu);
 
     /* TODO optimise the plane merging */
     const unsigned copy_lines = height / 2;
@@ -414,7 +771,7 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
         memcpy(dst, src, src_pitch * height);
     else
     for (unsigned y = 0; y < height; y++) {
-        memcpy(dst, src, src_pitch);
+        memcpy(dst, src, __MIN(src_pitch, dst_pitch));
         src += src_pitch;
         dst += dst_pitch;
     }
@@ -425,8 +782,10 @@ static void SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                         const uint8_t *src, size_t src_pitch,
                         unsigned height)
 {
+    const size_t width = __MIN(src_pitch / 2, __MIN(dstu_pitch, dstv_pitch));
+
     for (unsigned y = 0; y < height; y++) {
-        for (unsigned x = 0; x < src_pitch / 2; x++) {
+        for (unsigned x = 0; x < width; x++) {
             dstu[x] = src[2*x+0];
             dstv[x] = src[2*x+1];
         }
@@ -526,39 +885,27 @@ void CopyFromI420_10ToP010(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
 {
     (void) cache;
 
-    const int i_extra_pitch_dst_y = (dst->p[0].i_pitch  - src_pitch[0]) / 2;
-    const int i_extra_pitch_src_y = (src_pitch[Y_PLANE] - src_pitch[0]) / 2;
-    uint16_t *dstY = dst->p[0].p_pixels;
-    uint16_t *srcY = src[Y_PLANE];
-    for (unsigned y = 0; y < height; y++) {
-        for (unsigned x = 0; x < (src_pitch[0] / 2); x++) {
-            *dstY++ = *srcY++ << 6;
-        }
-        dstY += i_extra_pitch_dst_y;
-        srcY += i_extra_pitch_src_y;
-    }
-
-    const unsigned copy_lines = height / 2;
-    const unsigned copy_pitch = src_pitch[1] / 2;
+    yuv_pack_kernels_t kernels;
+    yuv_pack_InitKernels(&kernels);
 
-    const int i_extra_pitch_uv = dst->p[1].i_pitch / 2 - 2 * copy_pitch;
-    const int i_extra_pitch_u  = src_pitch[U_PLANE] / 2 - copy_pitch;
-    const int i_extra_pitch_v  = src_pitch[V_PLANE] / 2 - copy_pitch;
+    /* Never write nor read past the end of a line, whatever the pitches */
+    const unsigned width = __MIN(src_pitch[Y_PLANE],
+                                 (size_t)dst->p[0].i_pitch) / 2;
+    for (unsigned y = 0; y < height; y++)
+        kernels.pf_p010_luma(
+            (uint16_t *)&dst->p[0].p_pixels[y * dst->p[0].i_pitch],
+            (const uint16_t *)&src[Y_PLANE][y * src_pitch[Y_PLANE]], width);
 
-    uint16_t *dstUV = dst->p[1].p_pixels;
-    uint16_t *srcU  = src[U_PLANE];
-    uint16_t *srcV  = src[V_PLANE];
-    for ( unsigned int line = 0; line < copy_lines; line++ )
-    {
-        for ( unsigned int col = 0; col < copy_pitch; col++ )
-        {
-            *dstUV++ = *srcU++ << 6;
-            *dstUV++ = *srcV++ << 6;
-        }
-        dstUV += i_extra_pitch_uv;
-        srcU  += i_extra_pitch_u;
-        srcV  += i_extra_pitch_v;
-    }
+    const unsigned copy_lines = height / 2;
+    const unsigned copy_width = __MIN(__MIN(src_pitch[U_PLANE],
+                                            src_pitch[V_PLANE]),
+                                      (size_t)dst->p[1].i_pitch / 2) / 2;
+    for (unsigned y = 0; y < copy_lines; y++)
+        kernels.pf_p010_chroma(
+            (uint16_t *)&dst->p[1].p_pixels[y * dst->p[1].i_pitch],
+            (const uint16_t *)&src[U_PLANE][y * src_pitch[U_PLANE]],
+            (const uint16_t *)&src[V_PLANE][y * src_pitch[V_PLANE]],
+            copy_width);
 }
 
 
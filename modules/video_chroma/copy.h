@@ -28,6 +28,7 @@ typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
+    struct copy_threads *threads; /* helpers for wide frames, or NULL */
 # endif
 } copy_cache_t;
 
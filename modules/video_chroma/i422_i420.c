@@ -114,33 +114,48 @@ VIDEO_FILTER_WRAPPER( I422_I420 )
 VIDEO_FILTER_WRAPPER( I422_YV12 )
 VIDEO_FILTER_WRAPPER( I422_YUVA )
 
+/*****************************************************************************
+ * I422_Planar: planar YUV 4:2:2 to planar YUV 4:2:0
+ *****************************************************************************
+ * This only copies lines, which memcpy() already does at memory speed: the
+ * luma plane is copied at once when the pitches match, and the chroma of the
+ * odd lines is kept.
+ *****************************************************************************/
+static void I422_Planar( filter_t *p_filter, picture_t *p_source,
+                         picture_t *p_dest, plane_t *p_du, plane_t *p_dv )
+{
+    const plane_t *p_y = &p_source->p[Y_PLANE];
+    const plane_t *p_u = &p_source->p[U_PLANE];
+    const plane_t *p_v = &p_source->p[V_PLANE];
+    const size_t i_width = p_filter->fmt_in.video.i_width;
+    const unsigned i_height = p_filter->fmt_in.video.i_height;
+    plane_t *p_dy = &p_dest->p[Y_PLANE];
+
+    if( p_dy->i_pitch == p_y->i_pitch )
+        memcpy( p_dy->p_pixels, p_y->p_pixels,
+                (i_height - 1) * (size_t)p_y->i_pitch + i_width );
+    else
+        for( unsigned y = 0; y < i_height; y++ )
+            memcpy( &p_dy->p_pixels[y * p_dy->i_pitch],
+                    &p_y->p_pixels[y * p_y->i_pitch], i_width );
+
+    for( unsigned y = 0; y < i_height / 2; y++ )
+    {
+        memcpy( &p_du->p_pixels[y * p_du->i_pitch],
+                &p_u->p_pixels[(2 * y + 1) * p_u->i_pitch], i_width / 2 );
+        memcpy( &p_dv->p_pixels[y * p_dv->i_pitch],
+                &p_v->p_pixels[(2 * y + 1) * p_v->i_pitch], i_width / 2 );
+    }
+}
+
 /*****************************************************************************
  * I422_I420: planar YUV 4:2:2 to planar I420 4:2:0 Y:U:V
  *****************************************************************************/
 static void I422_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
-    uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
-    uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
-    uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
-    uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
-    uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
-    uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
-    uint8_t *p_du = p_dest->U_PIXELS + (i_y/2-1)*i_dpuv;
-    uint8_t *p_u = p_source->U_PIXELS + (i_y-1)*i_spuv;
-    uint8_t *p_dv = p_dest->V_PIXELS + (i_y/2-1)*i_dpuv;
-    uint8_t *p_v = p_source->V_PIXELS + (i_y-1)*i_spuv;
-    i_y /= 2;
-
-    for ( ; i_y--; )
-    {
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_du, p_u, i_width/2); p_du -= i_dpuv; p_u -= 2*i_spuv;
-        memcpy(p_dv, p_v, i_width/2); p_dv -= i_dpuv; p_v -= 2*i_spuv;
-    }
+    I422_Planar( p_filter, p_source, p_dest,
+                 &p_dest->p[U_PLANE], &p_dest->p[V_PLANE] );
 }
 
 /*****************************************************************************
@@ -149,27 +164,9 @@ static void I422_I420( filter_t *p_filter, picture_t *p_source,
 static void I422_YV12( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
-    uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
-    uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
-    uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
-    uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
-    uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
-    uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
-    uint8_t *p_du = p_dest->V_PIXELS + (i_y/2-1)*i_dpuv; /* U and V are swapped */
-    uint8_t *p_u = p_source->U_PIXELS + (i_y-1)*i_spuv;
-    uint8_t *p_dv = p_dest->U_PIXELS + (i_y/2-1)*i_dpuv; /* U and V are swapped */
-    uint8_t *p_v = p_source->V_PIXELS + (i_y-1)*i_spuv;
-    i_y /= 2;
-
-    for ( ; i_y--; )
-    {
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_du, p_u, i_width/2); p_du -= i_dpuv; p_u -= 2*i_spuv;
-        memcpy(p_dv, p_v, i_width/2); p_dv -= i_dpuv; p_v -= 2*i_spuv;
-    }
+    /* U and V are swapped */
+    I422_Planar( p_filter, p_source, p_dest,
+                 &p_dest->p[V_PLANE], &p_dest->p[U_PLANE] );
 }
 
 /*****************************************************************************
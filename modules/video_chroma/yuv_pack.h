@@ -0,0 +1,461 @@
+/*****************************************************************************
+ * yuv_pack.h: packing and unpacking of YUV lines
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_CHROMA_YUV_PACK_H
+#define VLC_VIDEO_CHROMA_YUV_PACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define YUV_PACK_NEON 1
+#endif
+
+/* Line kernels:
+ *  - pf_split422 splits a packed 4:2:2 line (YUYV, YVYU or UYVY) of i_width
+ *    pixels in a luma line and two chroma lines, in the order of the packed
+ *    format. b_luma_first is false for UYVY.
+ *  - pf_luma422 only extracts the luma of such a line.
+ *  - pf_p010_luma converts a 10-bit luma line of i_width samples to P010.
+ *  - pf_p010_chroma interleaves and converts two 10-bit chroma lines of
+ *    i_width samples each to P010.
+ *
+ * All the versions give the exact same results; the SIMD ones only process
+ * the multiples of their vector size, and leave the rest to the C ones. */
+typedef struct
+{
+    void (*pf_split422)( uint8_t *p_y, uint8_t *p_c0, uint8_t *p_c1,
+                         const uint8_t *p_src, unsigned i_width,
+                         bool b_luma_first );
+    void (*pf_luma422)( uint8_t *p_y, const uint8_t *p_src, unsigned i_width,
+                        bool b_luma_first );
+    void (*pf_p010_luma)( uint16_t *p_dst, const uint16_t *p_src,
+                          unsigned i_width );
+    void (*pf_p010_chroma)( uint16_t *p_dst, const uint16_t *p_u,
+                            const uint16_t *p_v, unsigned i_width );
+} yuv_pack_kernels_t;
+
+static inline void split422_C( uint8_t *p_y, uint8_t *p_c0, uint8_t *p_c1,
+                               const uint8_t *p_src, unsigned i_width,
+                               bool b_luma_first )
+{
+    const unsigned i_luma = !b_luma_first;
+
+    for( unsigned x = 0; x < i_width / 2; x++ )
+    {
+        p_y[2 * x]     = p_src[4 * x + i_luma];
+        p_y[2 * x + 1] = p_src[4 * x + i_luma + 2];
+        p_c0[x]        = p_src[4 * x + 1 - i_luma];
+        p_c1[x]        = p_src[4 * x + 3 - i_luma];
+    }
+}
+
+static inline void luma422_C( uint8_t *p_y, const uint8_t *p_src,
+                              unsigned i_width, bool b_luma_first )
+{
+    p_src += !b_luma_first;
+    for( unsigned x = 0; x < i_width; x++ )
+        p_y[x] = p_src[2 * x];
+}
+
+static inline void p010_luma_C( uint16_t *p_dst, const uint16_t *p_src,
+                                unsigned i_width )
+{
+    for( unsigned x = 0; x < i_width; x++ )
+        p_dst[x] = p_src[x] << 6;
+}
+
+static inline void p010_chroma_C( uint16_t *p_dst, const uint16_t *p_u,
+                                  const uint16_t *p_v, unsigned i_width )
+{
+    for( unsigned x = 0; x < i_width; x++ )
+    {
+        p_dst[2 * x]     = p_u[x] << 6;
+        p_dst[2 * x + 1] = p_v[x] << 6;
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* 32 pixels at a time: the even and odd bytes of the packed line are
+ * separated by masking/shifting and packing with unsigned saturation. */
+__attribute__ ((__target__ ("sse2")))
+static void split422_SSE2( uint8_t *p_y, uint8_t *p_c0, uint8_t *p_c1,
+                           const uint8_t *p_src, unsigned i_width,
+                           bool b_luma_first )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    unsigned x = 0;
+
+    for( ; x + 32 <= i_width; x += 32 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&p_src[2 * x] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&p_src[2 * x + 16] );
+        __m128i c = _mm_loadu_si128( (const __m128i *)&p_src[2 * x + 32] );
+        __m128i d = _mm_loadu_si128( (const __m128i *)&p_src[2 * x + 48] );
+        __m128i lo0 = _mm_packus_epi16( _mm_and_si128( a, mask ),
+                                        _mm_and_si128( b, mask ) );
+        __m128i lo1 = _mm_packus_epi16( _mm_and_si128( c, mask ),
+                                        _mm_and_si128( d, mask ) );
+        __m128i hi0 = _mm_packus_epi16( _mm_srli_epi16( a, 8 ),
+                                        _mm_srli_epi16( b, 8 ) );
+        __m128i hi1 = _mm_packus_epi16( _mm_srli_epi16( c, 8 ),
+                                        _mm_srli_epi16( d, 8 ) );
+        __m128i luma0 = b_luma_first ? lo0 : hi0;
+        __m128i luma1 = b_luma_first ? lo1 : hi1;
+        __m128i chroma0 = b_luma_first ? hi0 : lo0;
+        __m128i chroma1 = b_luma_first ? hi1 : lo1;
+
+        _mm_storeu_si128( (__m128i *)&p_y[x], luma0 );
+        _mm_storeu_si128( (__m128i *)&p_y[x + 16], luma1 );
+        _mm_storeu_si128( (__m128i *)&p_c0[x / 2],
+            _mm_packus_epi16( _mm_and_si128( chroma0, mask ),
+                              _mm_and_si128( chroma1, mask ) ) );
+        _mm_storeu_si128( (__m128i *)&p_c1[x / 2],
+            _mm_packus_epi16( _mm_srli_epi16( chroma0, 8 ),
+                              _mm_srli_epi16( chroma1, 8 ) ) );
+    }
+
+    if( x < i_width )
+        split422_C( &p_y[x], &p_c0[x / 2], &p_c1[x / 2], &p_src[2 * x],
+                    i_width - x, b_luma_first );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void luma422_SSE2( uint8_t *p_y, const uint8_t *p_src,
+                          unsigned i_width, bool b_luma_first )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&p_src[2 * x] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&p_src[2 * x + 16] );
+
+        if( b_luma_first )
+        {
+            a = _mm_and_si128( a, mask );
+            b = _mm_and_si128( b, mask );
+        }
+        else
+        {
+            a = _mm_srli_epi16( a, 8 );
+            b = _mm_srli_epi16( b, 8 );
+        }
+        _mm_storeu_si128( (__m128i *)&p_y[x], _mm_packus_epi16( a, b ) );
+    }
+
+    if( x < i_width )
+        luma422_C( &p_y[x], &p_src[2 * x], i_width - x, b_luma_first );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void p010_luma_SSE2( uint16_t *p_dst, const uint16_t *p_src,
+                            unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&p_src[x] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&p_src[x + 8] );
+
+        _mm_storeu_si128( (__m128i *)&p_dst[x], _mm_slli_epi16( a, 6 ) );
+        _mm_storeu_si128( (__m128i *)&p_dst[x + 8], _mm_slli_epi16( b, 6 ) );
+    }
+
+    if( x < i_width )
+        p010_luma_C( &p_dst[x], &p_src[x], i_width - x );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void p010_chroma_SSE2( uint16_t *p_dst, const uint16_t *p_u,
+                              const uint16_t *p_v, unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 8 <= i_width; x += 8 )
+    {
+        __m128i u = _mm_slli_epi16(
+            _mm_loadu_si128( (const __m128i *)&p_u[x] ), 6 );
+        __m128i v = _mm_slli_epi16(
+            _mm_loadu_si128( (const __m128i *)&p_v[x] ), 6 );
+
+        _mm_storeu_si128( (__m128i *)&p_dst[2 * x],
+                          _mm_unpacklo_epi16( u, v ) );
+        _mm_storeu_si128( (__m128i *)&p_dst[2 * x + 8],
+                          _mm_unpackhi_epi16( u, v ) );
+    }
+
+    if( x < i_width )
+        p010_chroma_C( &p_dst[2 * x], &p_u[x], &p_v[x], i_width - x );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+/* Same as SSE2 on 64 pixels; the 256-bit packs work within 128-bit lanes,
+ * hence the permutations restoring the order of the quadwords. */
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i split422_Pack( __m256i a, __m256i b )
+{
+    return _mm256_permute4x64_epi64( _mm256_packus_epi16( a, b ),
+                                     _MM_SHUFFLE(3, 1, 2, 0) );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void split422_AVX2( uint8_t *p_y, uint8_t *p_c0, uint8_t *p_c1,
+                           const uint8_t *p_src, unsigned i_width,
+                           bool b_luma_first )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff );
+    unsigned x = 0;
+
+    for( ; x + 64 <= i_width; x += 64 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x + 32] );
+        __m256i c = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x + 64] );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x + 96] );
+        __m256i lo0 = split422_Pack( _mm256_and_si256( a, mask ),
+                                     _mm256_and_si256( b, mask ) );
+        __m256i lo1 = split422_Pack( _mm256_and_si256( c, mask ),
+                                     _mm256_and_si256( d, mask ) );
+        __m256i hi0 = split422_Pack( _mm256_srli_epi16( a, 8 ),
+                                     _mm256_srli_epi16( b, 8 ) );
+        __m256i hi1 = split422_Pack( _mm256_srli_epi16( c, 8 ),
+                                     _mm256_srli_epi16( d, 8 ) );
+        __m256i luma0 = b_luma_first ? lo0 : hi0;
+        __m256i luma1 = b_luma_first ? lo1 : hi1;
+        __m256i chroma0 = b_luma_first ? hi0 : lo0;
+        __m256i chroma1 = b_luma_first ? hi1 : lo1;
+
+        _mm256_storeu_si256( (__m256i *)&p_y[x], luma0 );
+        _mm256_storeu_si256( (__m256i *)&p_y[x + 32], luma1 );
+        _mm256_storeu_si256( (__m256i *)&p_c0[x / 2],
+            split422_Pack( _mm256_and_si256( chroma0, mask ),
+                           _mm256_and_si256( chroma1, mask ) ) );
+        _mm256_storeu_si256( (__m256i *)&p_c1[x / 2],
+            split422_Pack( _mm256_srli_epi16( chroma0, 8 ),
+                           _mm256_srli_epi16( chroma1, 8 ) ) );
+    }
+
+    if( x < i_width )
+        split422_C( &p_y[x], &p_c0[x / 2], &p_c1[x / 2], &p_src[2 * x],
+                    i_width - x, b_luma_first );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void luma422_AVX2( uint8_t *p_y, const uint8_t *p_src,
+                          unsigned i_width, bool b_luma_first )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff );
+    unsigned x = 0;
+
+    for( ; x + 32 <= i_width; x += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)&p_src[2 * x + 32] );
+
+        if( b_luma_first )
+        {
+            a = _mm256_and_si256( a, mask );
+            b = _mm256_and_si256( b, mask );
+        }
+        else
+        {
+            a = _mm256_srli_epi16( a, 8 );
+            b = _mm256_srli_epi16( b, 8 );
+        }
+        _mm256_storeu_si256( (__m256i *)&p_y[x], split422_Pack( a, b ) );
+    }
+
+    if( x < i_width )
+        luma422_C( &p_y[x], &p_src[2 * x], i_width - x, b_luma_first );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void p010_luma_AVX2( uint16_t *p_dst, const uint16_t *p_src,
+                            unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 32 <= i_width; x += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)&p_src[x] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)&p_src[x + 16] );
+
+        _mm256_storeu_si256( (__m256i *)&p_dst[x],
+                             _mm256_slli_epi16( a, 6 ) );
+        _mm256_storeu_si256( (__m256i *)&p_dst[x + 16],
+                             _mm256_slli_epi16( b, 6 ) );
+    }
+
+    if( x < i_width )
+        p010_luma_C( &p_dst[x], &p_src[x], i_width - x );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void p010_chroma_AVX2( uint16_t *p_dst, const uint16_t *p_u,
+                              const uint16_t *p_v, unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        __m256i u = _mm256_slli_epi16(
+            _mm256_loadu_si256( (const __m256i *)&p_u[x] ), 6 );
+        __m256i v = _mm256_slli_epi16(
+            _mm256_loadu_si256( (const __m256i *)&p_v[x] ), 6 );
+        __m256i lo = _mm256_unpacklo_epi16( u, v );
+        __m256i hi = _mm256_unpackhi_epi16( u, v );
+
+        _mm256_storeu_si256( (__m256i *)&p_dst[2 * x],
+                             _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)&p_dst[2 * x + 16],
+                             _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+    }
+
+    if( x < i_width )
+        p010_chroma_C( &p_dst[2 * x], &p_u[x], &p_v[x], i_width - x );
+}
+#endif
+
+#ifdef YUV_PACK_NEON
+/* The structure loads and stores do the (de)interleaving */
+static void split422_NEON( uint8_t *p_y, uint8_t *p_c0, uint8_t *p_c1,
+                           const uint8_t *p_src, unsigned i_width,
+                           bool b_luma_first )
+{
+    const unsigned i_luma = !b_luma_first;
+    unsigned x = 0;
+
+    for( ; x + 32 <= i_width; x += 32 )
+    {
+        uint8x16x4_t in = vld4q_u8( &p_src[2 * x] );
+        uint8x16x2_t luma = { { in.val[i_luma], in.val[i_luma + 2] } };
+
+        vst2q_u8( &p_y[x], luma );
+        vst1q_u8( &p_c0[x / 2], in.val[1 - i_luma] );
+        vst1q_u8( &p_c1[x / 2], in.val[3 - i_luma] );
+    }
+
+    if( x < i_width )
+        split422_C( &p_y[x], &p_c0[x / 2], &p_c1[x / 2], &p_src[2 * x],
+                    i_width - x, b_luma_first );
+}
+
+static void luma422_NEON( uint8_t *p_y, const uint8_t *p_src,
+                          unsigned i_width, bool b_luma_first )
+{
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        uint8x16x2_t in = vld2q_u8( &p_src[2 * x] );
+        vst1q_u8( &p_y[x], in.val[!b_luma_first] );
+    }
+
+    if( x < i_width )
+        luma422_C( &p_y[x], &p_src[2 * x], i_width - x, b_luma_first );
+}
+
+static void p010_luma_NEON( uint16_t *p_dst, const uint16_t *p_src,
+                            unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        vst1q_u16( &p_dst[x], vshlq_n_u16( vld1q_u16( &p_src[x] ), 6 ) );
+        vst1q_u16( &p_dst[x + 8],
+                   vshlq_n_u16( vld1q_u16( &p_src[x + 8] ), 6 ) );
+    }
+
+    if( x < i_width )
+        p010_luma_C( &p_dst[x], &p_src[x], i_width - x );
+}
+
+static void p010_chroma_NEON( uint16_t *p_dst, const uint16_t *p_u,
+                              const uint16_t *p_v, unsigned i_width )
+{
+    unsigned x = 0;
+
+    for( ; x + 8 <= i_width; x += 8 )
+    {
+        uint16x8x2_t uv = { {
+            vshlq_n_u16( vld1q_u16( &p_u[x] ), 6 ),
+            vshlq_n_u16( vld1q_u16( &p_v[x] ), 6 ),
+        } };
+        vst2q_u16( &p_dst[2 * x], uv );
+    }
+
+    if( x < i_width )
+        p010_chroma_C( &p_dst[2 * x], &p_u[x], &p_v[x], i_width - x );
+}
+#endif
+
+static inline void yuv_pack_InitKernels( yuv_pack_kernels_t *k )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        k->pf_split422 = split422_AVX2;
+        k->pf_luma422 = luma422_AVX2;
+        k->pf_p010_luma = p010_luma_AVX2;
+        k->pf_p010_chroma = p010_chroma_AVX2;
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        k->pf_split422 = split422_SSE2;
+        k->pf_luma422 = luma422_SSE2;
+        k->pf_p010_luma = p010_luma_SSE2;
+        k->pf_p010_chroma = p010_chroma_SSE2;
+        return;
+    }
+#endif
+#ifdef YUV_PACK_NEON
+    if( vlc_CPU_ARM64_NEON() )
+    {
+        k->pf_split422 = split422_NEON;
+        k->pf_luma422 = luma422_NEON;
+        k->pf_p010_luma = p010_luma_NEON;
+        k->pf_p010_chroma = p010_chroma_NEON;
+        return;
+    }
+#endif
+    k->pf_split422 = split422_C;
+    k->pf_luma422 = luma422_C;
+    k->pf_p010_luma = p010_luma_C;
+    k->pf_p010_chroma = p010_chroma_C;
+}
+
+#endif
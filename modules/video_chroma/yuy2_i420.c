@@ -34,13 +34,21 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#include "yuv_pack.h"
+
 #define SRC_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #define DEST_FOURCC  "I420"
 
+struct filter_sys_t
+{
+    yuv_pack_kernels_t kernels;
+};
+
 /*****************************************************************************
  * Local and extern prototypes.
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
+static void Close    ( vlc_object_t * );
 
 static void YUY2_I420           ( filter_t *, picture_t *, picture_t * );
 static void YVYU_I420           ( filter_t *, picture_t *, picture_t * );
@@ -56,7 +64,7 @@ static picture_t *UYVY_I420_Filter    ( filter_t *, picture_t * );
 vlc_module_begin ()
     set_description( N_("Conversions from " SRC_FOURCC " to " DEST_FOURCC) )
     set_capability( "video converter", 80 )
-    set_callbacks( Activate, NULL )
+    set_callbacks( Activate, Close )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -68,11 +76,9 @@ static int Activate( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
 
-    if( p_filter->fmt_in.video.i_width & 1
-     || p_filter->fmt_in.video.i_height & 1 )
-    {
+    /* The trailing line of odd heights is converted alone */
+    if( p_filter->fmt_in.video.i_width & 1 )
         return -1;
-    }
 
     if( p_filter->fmt_in.video.i_width != (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width)
      || p_filter->fmt_in.video.i_height != (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height)
@@ -104,83 +110,80 @@ static int Activate( vlc_object_t *p_this )
         default:
             return -1;
     }
+
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+    yuv_pack_InitKernels( &p_sys->kernels );
+    p_filter->p_sys = p_sys;
     return 0;
 }
 
+/*****************************************************************************
+ * Close: free the chroma function
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
 /* Following functions are local */
 VIDEO_FILTER_WRAPPER( YUY2_I420 )
 VIDEO_FILTER_WRAPPER( YVYU_I420 )
 VIDEO_FILTER_WRAPPER( UYVY_I420 )
 
+/*****************************************************************************
+ * Packed422_I420: packed YUV 4:2:2 to planar YUV 4:2:0
+ *****************************************************************************
+ * The chroma is taken from the even lines, only the luma of the odd lines is
+ * used. b_luma_first tells whether the luma sample comes first in each pair
+ * of bytes, and p_c0/p_c1 are the planes of the chroma in packing order.
+ *****************************************************************************/
+static void Packed422_I420( filter_t *p_filter, picture_t *p_source,
+                            picture_t *p_dest, bool b_luma_first,
+                            plane_t *p_c0, plane_t *p_c1 )
+{
+    const unsigned i_width = p_filter->fmt_out.video.i_x_offset
+                           + p_filter->fmt_out.video.i_visible_width;
+    const unsigned i_height = p_filter->fmt_out.video.i_y_offset
+                            + p_filter->fmt_out.video.i_visible_height;
+    const plane_t *p_src = &p_source->p[0];
+    plane_t *p_y = &p_dest->p[Y_PLANE];
+    const yuv_pack_kernels_t *p_kernels = &p_filter->p_sys->kernels;
+    unsigned y;
+
+    for( y = 0; y + 1 < i_height; y += 2 )
+    {
+        const uint8_t *p_line = &p_src->p_pixels[y * p_src->i_pitch];
+
+        p_kernels->pf_split422( &p_y->p_pixels[y * p_y->i_pitch],
+                                &p_c0->p_pixels[y / 2 * p_c0->i_pitch],
+                                &p_c1->p_pixels[y / 2 * p_c1->i_pitch],
+                                p_line, i_width, b_luma_first );
+        p_kernels->pf_luma422( &p_y->p_pixels[(y + 1) * p_y->i_pitch],
+                               p_line + p_src->i_pitch, i_width,
+                               b_luma_first );
+    }
+
+    /* Odd height: the last line also gives the last chroma lines */
+    if( y < i_height )
+        split422_C( &p_y->p_pixels[y * p_y->i_pitch],
+                    &p_c0->p_pixels[y / 2 * p_c0->i_pitch],
+                    &p_c1->p_pixels[y / 2 * p_c1->i_pitch],
+                    &p_src->p_pixels[y * p_src->i_pitch], i_width,
+                    b_luma_first );
+}
+
 /*****************************************************************************
  * YUY2_I420: packed YUY2 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
 static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint8_t *p_line = p_source->p->p_pixels;
-
-    uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
-
-    bool b_skip = false;
-
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
-    {
-        if( b_skip )
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; p_line++; \
-                *p_y++ = *p_line++; p_line++
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-        }
-        else
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YUYV_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; *p_u++ = *p_line++; \
-                *p_y++ = *p_line++; *p_v++ = *p_line++
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_u += i_dest_margin_c;
-            p_v += i_dest_margin_c;
-        }
-        p_line += i_source_margin;
-        p_y += i_dest_margin;
-
-        b_skip = !b_skip;
-    }
+    Packed422_I420( p_filter, p_source, p_dest, true,
+                    &p_dest->p[U_PLANE], &p_dest->p[V_PLANE] );
 }
 
 /*****************************************************************************
@@ -189,69 +192,8 @@ static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
 static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint8_t *p_line = p_source->p->p_pixels;
-
-    uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
-
-    bool b_skip = false;
-
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
-    {
-        if( b_skip )
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; p_line++; \
-                *p_y++ = *p_line++; p_line++
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-        }
-        else
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YVYU_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; *p_v++ = *p_line++; \
-                *p_y++ = *p_line++; *p_u++ = *p_line++
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_u += i_dest_margin_c;
-            p_v += i_dest_margin_c;
-        }
-        p_line += i_source_margin;
-        p_y += i_dest_margin;
-
-        b_skip = !b_skip;
-    }
+    Packed422_I420( p_filter, p_source, p_dest, true,
+                    &p_dest->p[V_PLANE], &p_dest->p[U_PLANE] );
 }
 
 /*****************************************************************************
@@ -260,67 +202,6 @@ static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
 static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint8_t *p_line = p_source->p->p_pixels;
-
-    uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
-
-    bool b_skip = false;
-
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
-    {
-        if( b_skip )
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; p_line++; \
-                *p_v++ = *p_line++; p_line++
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-        }
-        else
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_UYVY_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; *p_y++ = *p_line++; \
-                *p_v++ = *p_line++; *p_y++ = *p_line++
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_y += i_dest_margin;
-        }
-        p_line += i_source_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
-
-        b_skip = !b_skip;
-    }
+    Packed422_I420( p_filter, p_source, p_dest, false,
+                    &p_dest->p[U_PLANE], &p_dest->p[V_PLANE] );
 }
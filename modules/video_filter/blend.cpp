@@ -34,6 +34,11 @@
 #include <vlc_picture.h>
 #include "filter_picture.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+# include <vlc_cpu.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -83,6 +88,18 @@ public:
     {
         return true;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
 
 protected:
     template <unsigned ry>
@@ -623,6 +640,343 @@ static const struct {
 #undef YUV
 };
 
+#ifdef HAVE_SSE2_INTRINSICS
+/*****************************************************************************
+ * SSE2 fast paths for the most common subpicture blendings. They give the
+ * exact same results as the generic code: with 8-bit components, all the
+ * intermediate values of merge() and div255() fit in 16-bit lanes.
+ *****************************************************************************/
+#define SSE2 __attribute__((__target__("sse2")))
+
+SSE2 static inline __m128i div255SSE2(__m128i v)
+{
+    v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+SSE2 static inline __m128i mergeSSE2(__m128i dst, __m128i src, __m128i a)
+{
+    const __m128i max = _mm_set1_epi16(255);
+    return div255SSE2(_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(max, a), dst),
+                                    _mm_mullo_epi16(src, a)));
+}
+
+SSE2 static inline bool isTransparentSSE2(__m128i a)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) == 0xffff;
+}
+
+/* dst[i] is merged with src[i] */
+SSE2 static void BlendLineSSE2(uint8_t *dst, const uint8_t *src,
+                               const uint8_t *src_a, unsigned count, int alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)&src_a[i]);
+        if (isTransparentSSE2(a))
+            continue;
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        __m128i lo = mergeSSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+                       div255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), valpha)));
+        __m128i hi = mergeSSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+                       div255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), valpha)));
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+    for (; i < count; i++)
+        merge(&dst[i], src[i], div255(alpha * src_a[i]));
+}
+
+/* dst_u[i] and dst_v[i] are merged with the even source pixels, or
+ * dst_uv[2 * i] and dst_uv[2 * i + 1] if dst_v is NULL */
+SSE2 static void BlendLineChromaSSE2(uint8_t *dst_u, uint8_t *dst_v,
+                                     const uint8_t *src_u, const uint8_t *src_v,
+                                     const uint8_t *src_a, unsigned count,
+                                     int alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i even = _mm_set1_epi16(0xff);
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; 2 * i + 16 <= count; i += 8) {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_a[2 * i]), even);
+        if (isTransparentSSE2(a))
+            continue;
+        a = div255SSE2(_mm_mullo_epi16(a, valpha));
+        __m128i u = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_u[2 * i]), even);
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_v[2 * i]), even);
+
+        if (dst_v != NULL) {
+            u = mergeSSE2(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)&dst_u[i]), zero), u, a);
+            v = mergeSSE2(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)&dst_v[i]), zero), v, a);
+            _mm_storel_epi64((__m128i *)&dst_u[i], _mm_packus_epi16(u, u));
+            _mm_storel_epi64((__m128i *)&dst_v[i], _mm_packus_epi16(v, v));
+        } else {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst_u[2 * i]);
+            __m128i lo = mergeSSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi16(u, v),
+                                   _mm_unpacklo_epi16(a, a));
+            __m128i hi = mergeSSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi16(u, v),
+                                   _mm_unpackhi_epi16(a, a));
+            _mm_storeu_si128((__m128i *)&dst_u[2 * i], _mm_packus_epi16(lo, hi));
+        }
+    }
+    for (; 2 * i < count; i++) {
+        const unsigned a = div255(alpha * src_a[2 * i]);
+        if (dst_v != NULL) {
+            merge(&dst_u[i], src_u[2 * i], a);
+            merge(&dst_v[i], src_v[2 * i], a);
+        } else {
+            merge(&dst_u[2 * i + 0], src_u[2 * i], a);
+            merge(&dst_u[2 * i + 1], src_v[2 * i], a);
+        }
+    }
+}
+
+/* Same as convertRgbToYuv8 */
+SSE2 static void ConvertRGBAToYUVASSE2(uint8_t *y, uint8_t *u, uint8_t *v,
+                                       uint8_t *a, const uint8_t *src,
+                                       unsigned count)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    unsigned i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        const __m128i p0 = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        const __m128i p1 = _mm_loadu_si128((const __m128i *)&src[4 * i + 16]);
+        const __m128i r = _mm_packs_epi32(_mm_and_si128(p0, mask),
+                                          _mm_and_si128(p1, mask));
+        const __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                                          _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+        const __m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                                          _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+        const __m128i al = _mm_packs_epi32(_mm_srli_epi32(p0, 24),
+                                           _mm_srli_epi32(p1, 24));
+        const __m128i round = _mm_set1_epi16(128);
+
+        /* The luma sum is unsigned, the chroma ones are signed */
+        __m128i vy = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                                                 _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+                                   _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+        vy = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(vy, round), 8), _mm_set1_epi16(16));
+        __m128i vu = _mm_sub_epi16(_mm_sub_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(112)),
+                                                 _mm_mullo_epi16(r, _mm_set1_epi16(38))),
+                                   _mm_mullo_epi16(g, _mm_set1_epi16(74)));
+        vu = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(vu, round), 8), round);
+        __m128i vv = _mm_sub_epi16(_mm_sub_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)),
+                                                 _mm_mullo_epi16(g, _mm_set1_epi16(94))),
+                                   _mm_mullo_epi16(b, _mm_set1_epi16(18)));
+        vv = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(vv, round), 8), round);
+
+        _mm_storel_epi64((__m128i *)&y[i], _mm_packus_epi16(vy, vy));
+        _mm_storel_epi64((__m128i *)&u[i], _mm_packus_epi16(vu, vu));
+        _mm_storel_epi64((__m128i *)&v[i], _mm_packus_epi16(vv, vv));
+        _mm_storel_epi64((__m128i *)&a[i], _mm_packus_epi16(al, al));
+    }
+    for (; i < count; i++) {
+        rgb_to_yuv(&y[i], &u[i], &v[i], src[4 * i], src[4 * i + 1], src[4 * i + 2]);
+        a[i] = src[4 * i + 3];
+    }
+}
+
+/* The red and blue components are swapped if swap_rb, the fourth byte of
+ * the destination is kept */
+SSE2 static void BlendLineRGB32SSE2(uint8_t *dst, const uint8_t *src,
+                                    unsigned count, int alpha, bool swap_rb)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i valpha = _mm_set1_epi16(alpha);
+    const __m128i alphas = _mm_set1_epi32(0xff000000);
+    const __m128i keep = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    unsigned i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        if (isTransparentSSE2(_mm_and_si128(s, alphas)))
+            continue;
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+        __m128i res[2];
+
+        for (unsigned k = 0; k < 2; k++) {
+            __m128i sk = k ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+            __m128i dk = k ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+            if (swap_rb)
+                sk = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sk, _MM_SHUFFLE(3, 0, 1, 2)),
+                                         _MM_SHUFFLE(3, 0, 1, 2));
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sk, _MM_SHUFFLE(3, 3, 3, 3)),
+                                            _MM_SHUFFLE(3, 3, 3, 3));
+            a = _mm_and_si128(div255SSE2(_mm_mullo_epi16(a, valpha)), keep);
+            res[k] = mergeSSE2(dk, sk, a);
+        }
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_packus_epi16(res[0], res[1]));
+    }
+    for (; i < count; i++) {
+        const uint8_t *s = &src[4 * i];
+        uint8_t *d = &dst[4 * i];
+        const unsigned a = div255(alpha * s[3]);
+
+        merge(&d[swap_rb ? 2 : 0], s[0], a);
+        merge(&d[1], s[1], a);
+        merge(&d[swap_rb ? 0 : 2], s[2], a);
+    }
+}
+
+/* The lines are blended by chunks, so that the converted source fits on
+ * the stack. The chunks start on even pixels. */
+#define BLEND_CHUNK 512
+
+class CSourceYUVA {
+public:
+    CSourceYUVA(const CPicture &cfg) : picture(cfg.getPicture()),
+                                       x(cfg.getX()), y(cfg.getY())
+    {
+    }
+    void get(const uint8_t *data[4], unsigned dx, unsigned dy, unsigned)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = &picture->p[i].p_pixels[(y + dy) * picture->p[i].i_pitch + x + dx];
+    }
+private:
+    const picture_t *picture;
+    unsigned x;
+    unsigned y;
+};
+
+class CSourceRGBA {
+public:
+    CSourceRGBA(const CPicture &cfg) : picture(cfg.getPicture()),
+                                       x(cfg.getX()), y(cfg.getY())
+    {
+    }
+    void get(const uint8_t *data[4], unsigned dx, unsigned dy, unsigned count)
+    {
+        const plane_t *p = &picture->p[0];
+        ConvertRGBAToYUVASSE2(buffer[0], buffer[1], buffer[2], buffer[3],
+                              &p->p_pixels[(y + dy) * p->i_pitch + 4 * (x + dx)],
+                              count);
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = buffer[i];
+    }
+private:
+    const picture_t *picture;
+    unsigned x;
+    unsigned y;
+    uint8_t buffer[4][BLEND_CHUNK];
+};
+
+/* 4:2:0 destinations, with planar (I420) or interleaved (NV12) chroma */
+template <bool semiplanar, bool swap_uv>
+class CDest420 {
+public:
+    CDest420(const CPicture &cfg) : picture(cfg.getPicture()),
+                                    x(cfg.getX()), y(cfg.getY())
+    {
+    }
+    void blend(const uint8_t *const data[4], unsigned dx, unsigned dy,
+               unsigned count, int alpha)
+    {
+        const plane_t *p = picture->p;
+        const unsigned line_y = y + dy;
+        const unsigned line_x = x + dx;
+
+        BlendLineSSE2(&p[0].p_pixels[line_y * p[0].i_pitch + line_x],
+                      data[0], data[3], count, alpha);
+        if ((line_y % 2) != 0)
+            return;
+
+        /* The chroma is merged with the pixels on even columns */
+        const unsigned skip = line_x % 2;
+        if (count <= skip)
+            return;
+
+        const unsigned cx = (line_x + skip) / 2;
+        const unsigned cy = line_y / 2;
+        if (semiplanar)
+            BlendLineChromaSSE2(&p[1].p_pixels[cy * p[1].i_pitch + 2 * cx], NULL,
+                                data[swap_uv ? 2 : 1] + skip,
+                                data[swap_uv ? 1 : 2] + skip,
+                                data[3] + skip, count - skip, alpha);
+        else
+            BlendLineChromaSSE2(&p[swap_uv ? 2 : 1].p_pixels[cy * p[swap_uv ? 2 : 1].i_pitch + cx],
+                                &p[swap_uv ? 1 : 2].p_pixels[cy * p[swap_uv ? 1 : 2].i_pitch + cx],
+                                data[1] + skip, data[2] + skip,
+                                data[3] + skip, count - skip, alpha);
+    }
+private:
+    const picture_t *picture;
+    unsigned x;
+    unsigned y;
+};
+
+template <class TDst, class TSrc>
+void BlendSSE2(const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    TSrc src(src_data);
+    TDst dst(dst_data);
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+            const uint8_t *data[4];
+
+            src.get(data, x, y, count);
+            dst.blend(data, x, y, count, alpha);
+        }
+    }
+}
+
+static void BlendRGBAToRGB32SSE2(const CPicture &dst_data, const CPicture &src_data,
+                                 unsigned width, unsigned height, int alpha)
+{
+    const video_format_t *fmt = dst_data.getFormat();
+#ifndef WORDS_BIGENDIAN
+    const bool rgb = fmt->i_lrshift ==  0 && fmt->i_lgshift == 8 && fmt->i_lbshift == 16;
+    const bool bgr = fmt->i_lrshift == 16 && fmt->i_lgshift == 8 && fmt->i_lbshift == 0;
+#else
+    const bool rgb = false, bgr = false;
+#endif
+
+    if (!rgb && !bgr) {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >
+            (dst_data, src_data, width, height, alpha);
+        return;
+    }
+
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    for (unsigned y = 0; y < height; y++)
+        BlendLineRGB32SSE2(&dst->p[0].p_pixels[(dst_data.getY() + y) * dst->p[0].i_pitch
+                                               + 4 * dst_data.getX()],
+                           &src->p[0].p_pixels[(src_data.getY() + y) * src->p[0].i_pitch
+                                               + 4 * src_data.getX()],
+                           width, alpha, bgr);
+}
+
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+} blends_sse2[] = {
+#define YUV420(csp, semiplanar, swap_uv) \
+    { csp, VLC_CODEC_YUVA, BlendSSE2<CDest420<semiplanar, swap_uv>, CSourceYUVA> }, \
+    { csp, VLC_CODEC_RGBA, BlendSSE2<CDest420<semiplanar, swap_uv>, CSourceRGBA> }
+
+    YUV420(VLC_CODEC_I420, false, false),
+    YUV420(VLC_CODEC_J420, false, false),
+    YUV420(VLC_CODEC_YV12, false, true),
+    YUV420(VLC_CODEC_NV12, true,  false),
+    YUV420(VLC_CODEC_NV21, true,  true),
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAToRGB32SSE2 },
+
+#undef YUV420
+};
+#undef SSE2
+#endif
+
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -675,6 +1029,14 @@ static int Open(vlc_object_t *object)
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2()) {
+        for (size_t i = 0; i < sizeof(blends_sse2) / sizeof(*blends_sse2); i++) {
+            if (blends_sse2[i].src == src && blends_sse2[i].dst == dst)
+                sys->blend = blends_sse2[i].blend;
+        }
+    }
+#endif
 
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
@@ -57,17 +57,23 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
-#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
+#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto. " \
+                               "A synthetic picture is used if none is given.")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+                                "the base image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
-#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
+#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image. " \
+                                "A synthetic picture is used if none is given.")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+                                 "the blend image will be loaded in")
+
+#define WIDTH_TEXT N_("Width of the synthetic images")
+#define HEIGHT_TEXT N_("Height of the synthetic images")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -83,6 +89,10 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "width", 1920, 16, 8192, WIDTH_TEXT,
+              WIDTH_TEXT, true )
+    add_integer_with_range( CFG_PREFIX "height", 1080, 16, 8192, HEIGHT_TEXT,
+              HEIGHT_TEXT, true )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
@@ -100,8 +110,8 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
 };
 
 /*****************************************************************************
@@ -111,39 +121,134 @@ struct filter_sys_t
 {
     bool b_done;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
-
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    char *psz_base_image;
+    char *psz_base_chromas;
+    char *psz_blend_image;
+    char *psz_blend_chromas;
 };
 
-static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
-                                 vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
+static picture_t *blendbench_LoadImage( vlc_object_t *p_this,
+                                        vlc_fourcc_t i_chroma,
+                                        const char *psz_file,
+                                        const char *psz_name )
 {
     image_handler_t *p_image;
     video_format_t fmt_in, fmt_out;
+    picture_t *p_pic;
 
     memset( &fmt_in, 0, sizeof(video_format_t) );
     memset( &fmt_out, 0, sizeof(video_format_t) );
 
     fmt_out.i_chroma = i_chroma;
     p_image = image_HandlerCreate( p_this );
-    *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
+    if( p_image == NULL )
+        return NULL;
+    p_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
     image_HandlerDelete( p_image );
 
-    if( *pp_pic == NULL )
+    if( p_pic == NULL )
     {
         msg_Err( p_this, "Unable to load %s image", psz_name );
-        return VLC_EGENERIC;
+        return NULL;
     }
 
     msg_Dbg( p_this, "%s image has dim %d x %d (Y plane)", psz_name,
-             (*pp_pic)->p[Y_PLANE].i_visible_pitch,
-             (*pp_pic)->p[Y_PLANE].i_visible_lines );
+             p_pic->p[Y_PLANE].i_visible_pitch,
+             p_pic->p[Y_PLANE].i_visible_lines );
 
-    return VLC_SUCCESS;
+    return p_pic;
+}
+
+/**
+ * Creates a deterministic picture, so that the results can be compared
+ * between runs. The blend picture has transparent, translucent and opaque
+ * areas, as subtitles and logos do.
+ */
+static picture_t *blendbench_NewImage( filter_t *p_filter,
+                                       vlc_fourcc_t i_chroma, bool b_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    fmt.i_width = fmt.i_visible_width = p_sys->i_width;
+    fmt.i_height = fmt.i_visible_height = p_sys->i_height;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+    video_format_FixRgb( &fmt );
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = x + 3 * y + 64 * i;
+    }
+    if( !b_blend )
+        return p_pic;
+
+    /* Set up the alpha channel, if any */
+    plane_t *p_alpha;
+    int i_offset, i_step;
+
+    switch( i_chroma )
+    {
+        case VLC_CODEC_YUVA:
+            p_alpha = &p_pic->p[A_PLANE], i_offset = 0, i_step = 1;
+            break;
+        case VLC_CODEC_RGBA:
+        case VLC_CODEC_BGRA:
+            p_alpha = &p_pic->p[0], i_offset = 3, i_step = 4;
+            break;
+        case VLC_CODEC_ARGB:
+            p_alpha = &p_pic->p[0], i_offset = 0, i_step = 4;
+            break;
+        default:
+            return p_pic;
+    }
+
+    for( unsigned y = 0; y < p_sys->i_height; y++ )
+        for( unsigned x = 0; x < p_sys->i_width; x++ )
+        {
+            uint8_t a;
+            switch( (x / 64 + y / 64) % 3 )
+            {
+                case 0:  a = 0; break;
+                case 1:  a = 255; break;
+                default: a = x * 255 / p_sys->i_width; break;
+            }
+            p_alpha->p_pixels[y * p_alpha->i_pitch + x * i_step + i_offset] = a;
+        }
+    return p_pic;
+}
+
+static picture_t *blendbench_GetImage( filter_t *p_filter,
+                                       vlc_fourcc_t i_chroma, bool b_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const char *psz_file = b_blend ? p_sys->psz_blend_image
+                                   : p_sys->psz_base_image;
+
+    if( psz_file != NULL && *psz_file != '\0' )
+        return blendbench_LoadImage( VLC_OBJECT(p_filter), i_chroma, psz_file,
+                                     b_blend ? "Blend" : "Base" );
+    return blendbench_NewImage( p_filter, i_chroma, b_blend );
+}
+
+static vlc_fourcc_t blendbench_ParseChroma( const char *psz )
+{
+    char psz_fourcc[4] = { ' ', ' ', ' ', ' ' };
+
+    for( unsigned i = 0; i < 4 && psz[i] != '\0'; i++ )
+        psz_fourcc[i] = psz[i];
+    return vlc_fourcc_GetCodec( VIDEO_ES,
+                                VLC_FOURCC( psz_fourcc[0], psz_fourcc[1],
+                                            psz_fourcc[2], psz_fourcc[3] ) );
 }
 
 /*****************************************************************************
@@ -153,8 +258,6 @@ static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -175,30 +278,19 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                       psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
-    {
-        free( p_sys );
-        return i_ret;
-    }
-
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                        psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                          psz_cmd, "Blend" );
-    free( psz_temp );
-    free( psz_cmd );
+    p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                   CFG_PREFIX "height" );
+
+    p_sys->psz_base_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
+    p_sys->psz_base_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
+    p_sys->psz_blend_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-chroma" );
+    p_sys->psz_blend_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
 
     return VLC_SUCCESS;
 }
@@ -211,57 +303,106 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_chromas );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_blend_chromas );
+    free( p_sys->psz_blend_image );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Bench: blends one chroma combination and reports its speed
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Bench( filter_t *p_filter, vlc_fourcc_t i_base_chroma,
+                   vlc_fourcc_t i_blend_chroma )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
+    picture_t *p_base = NULL, *p_blend_image = NULL;
+    filter_t *p_blend = NULL;
 
-    if( p_sys->b_done )
-        return p_pic;
+    p_base = blendbench_GetImage( p_filter, i_base_chroma, false );
+    p_blend_image = blendbench_GetImage( p_filter, i_blend_chroma, true );
+    if( p_base == NULL || p_blend_image == NULL )
+        goto end;
 
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        goto end;
+    p_blend->fmt_out.video = p_base->format;
+    p_blend->fmt_in.video = p_blend_image->format;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
-        vlc_object_release( p_blend );
-        return NULL;
+        msg_Err( p_filter, "cannot blend %4.4s onto %4.4s",
+                 (const char *)&i_blend_chroma, (const char *)&i_base_chroma );
+        goto end;
     }
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
+        p_blend->pf_video_blend( p_blend, p_base, p_blend_image,
                                  0, 0, p_sys->i_alpha );
     }
     time = mdate() - time;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              time / 1000000.0f );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
+    const unsigned i_pixels =
+        __MIN( p_base->format.i_visible_width,
+               p_blend_image->format.i_visible_width ) *
+        __MIN( p_base->format.i_visible_height,
+               p_blend_image->format.i_visible_height );
+
+    msg_Info( p_filter, "%4.4s onto %4.4s: blended %d images in %f sec",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
+              p_sys->i_loops, time / 1000000.0f );
+    msg_Info( p_filter, "%4.4s onto %4.4s: %f images/second, %.1f Mpix/s",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
               (float) p_sys->i_loops / time * 1000000,
-              (float) p_sys->i_loops / time * 1000000 *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+              (float) p_sys->i_loops / time * i_pixels );
 
     module_unneed( p_blend, p_blend->p_module );
+end:
+    if( p_blend )
+        vlc_object_release( p_blend );
+    if( p_blend_image )
+        picture_Release( p_blend_image );
+    if( p_base )
+        picture_Release( p_base );
+}
 
-    vlc_object_release( p_blend );
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    /* Every base chroma with every blend chroma */
+    char *psz_base_list = strdup( p_sys->psz_base_chromas );
+    char *psz_blend_list = strdup( p_sys->psz_blend_chromas );
+    char *psz_base_save, *psz_blend_save;
+
+    if( psz_base_list != NULL && psz_blend_list != NULL )
+    {
+        for( const char *psz_base = strtok_r( psz_base_list, ",",
+                                               &psz_base_save );
+             psz_base != NULL;
+             psz_base = strtok_r( NULL, ",", &psz_base_save ) )
+        {
+            strcpy( psz_blend_list, p_sys->psz_blend_chromas );
+            for( const char *psz_blend = strtok_r( psz_blend_list, ",",
+                                                    &psz_blend_save );
+                 psz_blend != NULL;
+                 psz_blend = strtok_r( NULL, ",", &psz_blend_save ) )
+                Bench( p_filter, blendbench_ParseChroma( psz_base ),
+                       blendbench_ParseChroma( psz_blend ) );
+        }
+    }
+    free( psz_base_list );
+    free( psz_blend_list );
 
     p_sys->b_done = true;
     return p_pic;
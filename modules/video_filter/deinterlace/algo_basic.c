@@ -39,85 +39,142 @@
 #include "algo_basic.h"
 
 /*****************************************************************************
- * RenderDiscard: only keep TOP or BOTTOM field, discard the other.
+ * Slices
  *****************************************************************************/
 
-void RenderDiscard( picture_t *p_outpic, picture_t *p_pic, int i_field )
+struct basic_slice
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+    int i_field;
+};
+
+static void DiscardSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                          unsigned i_start, unsigned i_end )
 {
-    int i_plane;
+    VLC_UNUSED(p_filter);
+    const struct basic_slice *p_slice = opaque;
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
 
     /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
+    for( unsigned y = i_start; y < i_end; y++ )
+        memcpy( &p_out->p_pixels[y * p_out->i_pitch],
+                &p_in->p_pixels[(2 * y + p_slice->i_field) * p_in->i_pitch],
+                p_in->i_pitch );
+}
 
-        p_in = p_pic->p[i_plane].p_pixels
-                   + i_field * p_pic->p[i_plane].i_pitch;
+static void BobSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                      unsigned i_start, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const struct basic_slice *p_slice = opaque;
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
+    const unsigned i_lines = p_out->i_visible_lines;
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+    for( unsigned y = i_start; y < i_end; y++ )
+    {
+        /* Each line of the field is doubled. The TOP field keeps the last
+           line, and the BOTTOM field the first line. */
+        unsigned i_line;
+        if( p_slice->i_field == 0 )
+            i_line = y == i_lines - 1 ? y : y & ~1;
+        else
+            i_line = y == 0 ? 0 : (y - 1) | 1;
+
+        memcpy( &p_out->p_pixels[y * p_out->i_pitch],
+                &p_in->p_pixels[i_line * p_in->i_pitch], p_in->i_pitch );
+    }
+}
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+static void LinearSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                         unsigned i_start, unsigned i_end )
+{
+    const struct basic_slice *p_slice = opaque;
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
+    const unsigned i_lines = p_out->i_visible_lines;
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
+    for( unsigned y = i_start; y < i_end; y++ )
+    {
+        uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+        const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+        /* Lines of the other field are interpolated, except on the edges
+           where there is only one neighbour */
+        if( (int)(y & 1) != p_slice->i_field && y > 0 && y + 1 < i_lines )
+            Merge( p_dst, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                   p_in->i_pitch );
+        else
+            memcpy( p_dst, p_src, p_in->i_pitch );
     }
+    EndMerge();
 }
 
-/*****************************************************************************
- * RenderBob: renders a BOB picture - simple copy
- *****************************************************************************/
-
-void RenderBob( picture_t *p_outpic, picture_t *p_pic, int i_field )
+static void MeanSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                       unsigned i_start, unsigned i_end )
 {
-    int i_plane;
+    const struct basic_slice *p_slice = opaque;
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    /* All lines: mean value */
+    for( unsigned y = i_start; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
 
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        Merge( &p_out->p_pixels[y * p_out->i_pitch],
+               p_src, p_src + p_in->i_pitch, p_in->i_pitch );
+    }
+    EndMerge();
+}
 
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
+static void BlendSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                        unsigned i_start, unsigned i_end )
+{
+    const struct basic_slice *p_slice = opaque;
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
 
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
+    for( unsigned y = i_start; y < i_end; y++ )
+    {
+        uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+        const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+        /* First line: simple copy, remaining lines: mean value */
+        if( y == 0 )
+            memcpy( p_dst, p_src, p_in->i_pitch );
+        else
+            Merge( p_dst, p_src - p_in->i_pitch, p_src, p_in->i_pitch );
+    }
+    EndMerge();
+}
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+/*****************************************************************************
+ * RenderDiscard: only keep TOP or BOTTOM field, discard the other.
+ *****************************************************************************/
 
-            p_out += p_outpic->p[i_plane].i_pitch;
+void RenderDiscard( filter_t *p_filter,
+                    picture_t *p_outpic, picture_t *p_pic, int i_field )
+{
+    struct basic_slice slice = { p_outpic, p_pic, i_field };
 
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+    filter_ExecuteSlices( p_filter, DiscardSlice, &slice, p_outpic,
+                          p_pic->i_planes );
+}
 
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
+/*****************************************************************************
+ * RenderBob: renders a BOB picture - simple copy
+ *****************************************************************************/
 
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+void RenderBob( filter_t *p_filter,
+                picture_t *p_outpic, picture_t *p_pic, int i_field )
+{
+    struct basic_slice slice = { p_outpic, p_pic, i_field };
 
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
-    }
+    filter_ExecuteSlices( p_filter, BobSlice, &slice, p_outpic,
+                          p_pic->i_planes );
 }
 
 /*****************************************************************************
@@ -127,52 +184,10 @@ void RenderBob( picture_t *p_outpic, picture_t *p_pic, int i_field )
 void RenderLinear( filter_t *p_filter,
                    picture_t *p_outpic, picture_t *p_pic, int i_field )
 {
-    int i_plane;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
+    struct basic_slice slice = { p_outpic, p_pic, i_field };
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
-    }
-    EndMerge();
+    filter_ExecuteSlices( p_filter, LinearSlice, &slice, p_outpic,
+                          p_pic->i_planes );
 }
 
 /*****************************************************************************
@@ -182,30 +197,10 @@ void RenderLinear( filter_t *p_filter,
 void RenderMean( filter_t *p_filter,
                  picture_t *p_outpic, picture_t *p_pic )
 {
-    int i_plane;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+    struct basic_slice slice = { p_outpic, p_pic, 0 };
 
-        /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
-    }
-    EndMerge();
+    filter_ExecuteSlices( p_filter, MeanSlice, &slice, p_outpic,
+                          p_pic->i_planes );
 }
 
 /*****************************************************************************
@@ -215,32 +210,8 @@ void RenderMean( filter_t *p_filter,
 void RenderBlend( filter_t *p_filter,
                   picture_t *p_outpic, picture_t *p_pic )
 {
-    int i_plane;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+    struct basic_slice slice = { p_outpic, p_pic, 0 };
 
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
-
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
-        }
-    }
-    EndMerge();
+    filter_ExecuteSlices( p_filter, BlendSlice, &slice, p_outpic,
+                          p_pic->i_planes );
 }
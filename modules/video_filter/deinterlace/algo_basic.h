@@ -29,6 +29,8 @@
 /**
  * \file
  * Basic deinterlace algorithms: Discard, Bob, Linear, Mean and Blend.
+ *
+ * The pictures are rendered in slices on the filter slice threads.
  */
 
 /* Forward declarations */
@@ -44,13 +46,15 @@ struct picture_t;
  *
  * For a 2x (framerate-doubling) near-equivalent, see RenderBob().
  *
+ * @param p_filter The filter instance. Must be non-NULL.
  * @param p_outpic Output frame. Must be allocated by caller.
  * @param p_pic Input frame. Must exist.
  * @param i_field Keep which field? 0 = top field, 1 = bottom field.
  * @see RenderBob()
  * @see Deinterlace()
  */
-void RenderDiscard( picture_t *p_outpic, picture_t *p_pic, int i_field );
+void RenderDiscard( filter_t *p_filter,
+                    picture_t *p_outpic, picture_t *p_pic, int i_field );
 
 /**
  * RenderBob: basic framerate doubler.
@@ -59,13 +63,15 @@ void RenderDiscard( picture_t *p_outpic, picture_t *p_pic, int i_field );
  *
  * For a 1x (non-doubling) near-equivalent, see RenderDiscard().
  *
+ * @param p_filter The filter instance. Must be non-NULL.
  * @param p_outpic Output frame. Must be allocated by caller.
  * @param p_pic Input frame. Must exist.
  * @param i_field Render which field? 0 = top field, 1 = bottom field.
  * @see RenderLinear()
  * @see Deinterlace()
  */
-void RenderBob( picture_t *p_outpic, picture_t *p_pic, int i_field );
+void RenderBob( filter_t *p_filter,
+                picture_t *p_outpic, picture_t *p_pic, int i_field );
 
 /**
  * RenderLinear: Bob with linear interpolation.
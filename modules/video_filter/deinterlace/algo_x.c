@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
 
@@ -357,7 +358,7 @@ static inline void XDeint8x8FieldMMXEXT( uint8_t *dst, int i_dst,
 /* NxN arbitray size (and then only use pixel in the NxN block)
  */
 static inline int XDeintNxNDetect( uint8_t *src, int i_src,
-                                   int i_height, int i_width )
+                                   int i_width, int i_height )
 {
     int y, x;
     int ff, fr;
@@ -537,47 +538,53 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-void RenderX( picture_t *p_outpic, picture_t *p_pic )
+struct x_slice
 {
-    int i_plane;
-#if defined (CAN_COMPILE_MMXEXT)
-    const bool mmxext = vlc_CPU_MMXEXT();
+    picture_t *p_outpic;
+    picture_t *p_pic;
+#ifdef CAN_COMPILE_MMXEXT
+    bool mmxext;
 #endif
+};
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
-        const int i_mbx = p_outpic->p[i_plane].i_visible_pitch/8;
+static void XSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                    unsigned i_start, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const struct x_slice *p_slice = opaque;
+    const plane_t *p_out = &p_slice->p_outpic->p[i_plane];
+    const plane_t *p_in = &p_slice->p_pic->p[i_plane];
 
-        const int i_mody = p_outpic->p[i_plane].i_visible_lines - 8*i_mby;
-        const int i_modx = p_outpic->p[i_plane].i_visible_pitch - 8*i_mbx;
+    const int i_mby = ( p_out->i_visible_lines + 7 )/8 - 1;
+    const int i_mbx = p_out->i_visible_pitch/8;
 
-        const int i_dst = p_outpic->p[i_plane].i_pitch;
-        const int i_src = p_pic->p[i_plane].i_pitch;
+    const int i_mody = p_out->i_visible_lines - 8*i_mby;
+    const int i_modx = p_out->i_visible_pitch - 8*i_mbx;
 
-        int y, x;
+    const int i_dst = p_out->i_pitch;
+    const int i_src = p_in->i_pitch;
 
-        for( y = 0; y < i_mby; y++ )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+    /* The slices do not start on band boundaries: render the bands starting
+       within this slice. A band may end in the next slice, but the bands do
+       not overlap and the source is only read, so nothing is shared. */
+    for( int y = (i_start + 7) / 8; 8 * y < (int)i_end; y++ )
+    {
+        uint8_t *dst = &p_out->p_pixels[8*y*i_dst];
+        uint8_t *src = &p_in->p_pixels[8*y*i_src];
 
+        if( y < i_mby )
+        {
 #ifdef CAN_COMPILE_MMXEXT
-            if( mmxext )
+            if( p_slice->mmxext )
                 XDeintBand8x8MMXEXT( dst, i_dst, src, i_src, i_mbx, i_modx );
             else
 #endif
                 XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
         }
-
-        /* Last line (C only)*/
-        if( i_mody )
+        else if( i_mody )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
-
-            for( x = 0; x < i_mbx; x++ )
+            /* Last line (C only)*/
+            for( int x = 0; x < i_mbx; x++ )
             {
                 XDeintNxN( dst, i_dst, src, i_src, 8, i_mody );
 
@@ -591,7 +598,21 @@ void RenderX( picture_t *p_outpic, picture_t *p_pic )
     }
 
 #ifdef CAN_COMPILE_MMXEXT
-    if( mmxext )
+    if( p_slice->mmxext )
         emms();
 #endif
 }
+
+void RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    struct x_slice slice = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+#ifdef CAN_COMPILE_MMXEXT
+        .mmxext = vlc_CPU_MMXEXT(),
+#endif
+    };
+
+    filter_ExecuteSlices( p_filter, XSlice, &slice, p_outpic,
+                          p_pic->i_planes );
+}
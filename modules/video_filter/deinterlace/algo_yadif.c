@@ -47,6 +47,81 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+struct yadif_slice
+{
+    picture_t *p_dst;
+    const picture_t *p_prev, *p_cur, *p_next;
+    int i_field;
+    int parity;
+    unsigned pixel_size;
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    void (*filter_16bit)(uint16_t *dst, uint16_t *prev, uint16_t *cur,
+                         uint16_t *next, int w, int prefs, int mrefs,
+                         int parity, int mode);
+};
+
+static void YadifSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                        unsigned i_start, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const struct yadif_slice *p_slice = opaque;
+    const plane_t *prevp = &p_slice->p_prev->p[i_plane];
+    const plane_t *curp  = &p_slice->p_cur->p[i_plane];
+    const plane_t *nextp = &p_slice->p_next->p[i_plane];
+    const plane_t *dstp  = &p_slice->p_dst->p[i_plane];
+    const int i_lines = dstp->i_visible_lines;
+
+    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+
+    for( int y_dst = i_start; y_dst < (int)i_end; y_dst++ )
+    {
+        /* We duplicate the first and last lines. They are rendered again
+           rather than copied, as the neighbouring line may belong to
+           another slice. */
+        int y = y_dst;
+        if( y == 0 )
+            y = 1;
+        else if( y == i_lines - 1 )
+            y = i_lines - 2;
+
+        uint8_t *dst = &dstp->p_pixels[y_dst * dstp->i_pitch];
+
+        if( y < 1 || y >= i_lines - 1 )
+        {
+            /* Too small to filter anything */
+            memcpy( dst, &curp->p_pixels[y_dst * curp->i_pitch],
+                    dstp->i_visible_pitch );
+        }
+        else if( (y % 2) == p_slice->i_field  ||  p_slice->parity == 2 )
+        {
+            memcpy( dst, &curp->p_pixels[y * curp->i_pitch],
+                    dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < i_lines - 2) ? 0 : 2;
+
+            uint8_t *prev = &prevp->p_pixels[y * prevp->i_pitch];
+            uint8_t *cur  = &curp->p_pixels[y * curp->i_pitch];
+            uint8_t *next = &nextp->p_pixels[y * nextp->i_pitch];
+            int prefs = y < i_lines - 2  ? curp->i_pitch : -curp->i_pitch;
+            int mrefs = y  - 1  ?  -curp->i_pitch : curp->i_pitch;
+
+            if( p_slice->pixel_size == 2 )
+                p_slice->filter_16bit( (uint16_t *)dst, (uint16_t *)prev,
+                                       (uint16_t *)cur, (uint16_t *)next,
+                                       dstp->i_visible_pitch / 2,
+                                       prefs, mrefs, p_slice->parity, mode );
+            else
+                p_slice->filter( dst, prev, cur, next, dstp->i_visible_pitch,
+                                 prefs, mrefs, p_slice->parity, mode );
+        }
+    }
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -107,7 +182,15 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         /* */
         void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
                        int w, int prefs, int mrefs, int parity, int mode);
+        void (*filter_16bit)(uint16_t *dst, uint16_t *prev, uint16_t *cur,
+                             uint16_t *next, int w, int prefs, int mrefs,
+                             int parity, int mode);
 
+#if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU_AVX2() )
+            filter = yadif_filter_line_avx2;
+        else
+#endif
 #if defined(HAVE_YADIF_SSSE3)
         if( vlc_CPU_SSSE3() )
             filter = yadif_filter_line_ssse3;
@@ -125,52 +208,34 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
 #endif
             filter = yadif_filter_line_c;
 
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+#if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU_AVX2() )
+            filter_16bit = yadif_filter_line_16bit_avx2;
+        else
+#endif
+#if defined(HAVE_YADIF_SSE4_1)
+        if( vlc_CPU_SSE4_1() )
+            filter_16bit = yadif_filter_line_16bit_sse4_1;
+        else
+#endif
+            filter_16bit = yadif_filter_line_c_16bit;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        /* The history pictures are only read: the planes are rendered
+           in slices, concurrently. */
+        struct yadif_slice slice = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .i_field = i_field,
+            .parity = yadif_parity,
+            .pixel_size = p_sys->chroma->pixel_size,
+            .filter = filter,
+            .filter_16bit = filter_16bit,
+        };
+
+        filter_ExecuteSlices( p_filter, YadifSlice, &slice, p_dst,
+                              p_dst->i_planes );
 
         p_sys->i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -182,7 +247,7 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  as set by Open() or SetFilterMethod(). It is always 0. */
 
         /* FIXME not good as it does not use i_order/i_field */
-        RenderX( p_dst, p_next );
+        RenderX( p_filter, p_dst, p_next );
         return VLC_SUCCESS;
     }
     else
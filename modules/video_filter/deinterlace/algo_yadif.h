@@ -65,6 +65,10 @@ struct picture_t;
  * Note that the generated "repeated" output picture is unique because
  * of temporal interpolation.
  *
+ * The planes are interpolated in horizontal slices on the filter slice
+ * threads. The history buffer is only read while rendering, and it is
+ * updated by the caller thread, so the field history is not affected.
+ *
  * As many output frames should be requested for each input frame as is
  * indicated by p_src->i_nb_fields. This is done by calling this function
  * several times, first with i_order = 0, and then with all other parameters
@@ -442,15 +442,15 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
     switch( p_sys->i_mode )
     {
         case DEINTERLACE_DISCARD:
-            RenderDiscard( p_dst[0], p_pic, 0 );
+            RenderDiscard( p_filter, p_dst[0], p_pic, 0 );
             break;
 
         case DEINTERLACE_BOB:
-            RenderBob( p_dst[0], p_pic, !b_top_field_first );
+            RenderBob( p_filter, p_dst[0], p_pic, !b_top_field_first );
             if( p_dst[1] )
-                RenderBob( p_dst[1], p_pic, b_top_field_first );
+                RenderBob( p_filter, p_dst[1], p_pic, b_top_field_first );
             if( p_dst[2] )
-                RenderBob( p_dst[2], p_pic, !b_top_field_first );
+                RenderBob( p_filter, p_dst[2], p_pic, !b_top_field_first );
             break;;
 
         case DEINTERLACE_LINEAR:
@@ -470,7 +470,7 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
             break;
 
         case DEINTERLACE_X:
-            RenderX( p_dst[0], p_pic );
+            RenderX( p_filter, p_dst[0], p_pic );
             break;
 
         case DEINTERLACE_YADIF:
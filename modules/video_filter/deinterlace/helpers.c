@@ -47,53 +47,6 @@
  * Internal functions
  *****************************************************************************/
 
-/**
- * This internal function converts a normal (full frame) plane_t into a
- * field plane_t.
- *
- * Field plane_t's can be used e.g. for a weaving copy operation from two
- * source frames into one destination frame.
- *
- * The pixels themselves will not be touched; only the metadata is generated.
- * The same pixel data is shared by both the original plane_t and the field
- * plane_t. Note, however, that the bottom field's data starts from the
- * second line, so for the bottom field, the actual pixel pointer value
- * does not exactly match the original plane pixel pointer value. (It points
- * one line further down.)
- *
- * The caller must allocate p_dst (creating a local variable is fine).
- *
- * @param p_dst Field plane_t is written here. Must be non-NULL.
- * @param p_src Original full-frame plane_t. Must be non-NULL.
- * @param i_field Extract which field? 0 = top field, 1 = bottom field.
- * @see plane_CopyPixels()
- * @see ComposeFrame()
- * @see RenderPhosphor()
- */
-static void FieldFromPlane( plane_t *p_dst, const plane_t *p_src, int i_field )
-{
-    assert( p_dst != NULL );
-    assert( p_src != NULL );
-    assert( i_field == 0  ||  i_field == 1 );
-
-    /* Start with a copy of the metadata, and then update it to refer
-       to one field only.
-
-       We utilize the fact that plane_CopyPixels() differentiates between
-       visible_pitch and pitch.
-
-       The other field will be defined as the "margin" by doubling the pitch.
-       The visible pitch will be left as in the original.
-    */
-    (*p_dst) = (*p_src);
-    p_dst->i_lines /= 2;
-    p_dst->i_visible_lines /= 2;
-    p_dst->i_pitch *= 2;
-    /* For the bottom field, skip the first line in the pixel data. */
-    if( i_field == 1 )
-        p_dst->p_pixels += p_src->i_pitch;
-}
-
 #define T 10
 /**
  * Internal helper function for EstimateNumBlocksWithMotion():
@@ -251,6 +204,113 @@ static int TestForMotionInBlockMMX( uint8_t *p_pix_p, uint8_t *p_pix_c,
  * Public functions
  *****************************************************************************/
 
+struct compose_slice
+{
+    picture_t *p_outpic;
+    picture_t *p_inpic_top;
+    picture_t *p_inpic_bottom;
+    compose_chroma_t i_output_chroma;
+    bool swapped_uv_conversion;
+};
+
+/**
+ * Copies a line of a plane into a line of another one. Lines out of the
+ * visible area of either plane are skipped, and only the compatible
+ * (smaller) part of the visible pitch is copied.
+ */
+static void CopyPlaneLine( const plane_t *p_dst, int i_dst_line,
+                           const plane_t *p_src, int i_src_line )
+{
+    if( i_dst_line < p_dst->i_visible_lines &&
+        i_src_line < p_src->i_visible_lines )
+        memcpy( &p_dst->p_pixels[i_dst_line * p_dst->i_pitch],
+                &p_src->p_pixels[i_src_line * p_src->i_pitch],
+                __MIN( p_dst->i_visible_pitch, p_src->i_visible_pitch ) );
+}
+
+static void ComposeSlice( filter_t *p_filter, void *opaque,
+                          unsigned i_out_plane, unsigned i_start,
+                          unsigned i_end )
+{
+    const struct compose_slice *p_slice = opaque;
+    const compose_chroma_t i_output_chroma = p_slice->i_output_chroma;
+
+    bool b_is_chroma_plane = ( i_out_plane == U_PLANE ||
+                               i_out_plane == V_PLANE );
+
+    /* The U/V swap is its own inverse */
+    int i_plane;
+    if( b_is_chroma_plane  &&  i_output_chroma == CC_UPCONVERT  &&
+        p_slice->swapped_uv_conversion )
+    {
+        if( i_out_plane == U_PLANE )
+            i_plane = V_PLANE;
+        else /* V_PLANE */
+            i_plane = U_PLANE;
+    }
+    else
+    {
+        i_plane = i_out_plane;
+    }
+
+    const plane_t *p_out = &p_slice->p_outpic->p[i_out_plane];
+    const plane_t *p_top = &p_slice->p_inpic_top->p[i_plane];
+    const plane_t *p_bottom = &p_slice->p_inpic_bottom->p[i_plane];
+
+    if( !b_is_chroma_plane  ||  i_output_chroma == CC_ALTLINE )
+    {
+        /* Do an alternating line copy. This is always done for luma,
+           and for 4:2:2 chroma. It can be requested for 4:2:0 chroma
+           using CC_ALTLINE (see function doc).
+
+           Note that when we get here, the number of lines matches
+           in input and output.
+        */
+        for( unsigned y = i_start; y < i_end; y++ )
+            CopyPlaneLine( p_out, y, (y & 1) ? p_bottom : p_top, y );
+    }
+    else if( i_output_chroma == CC_UPCONVERT )
+    {
+        /* Upconverting copy - use all data from both input fields.
+
+           This produces an output picture with independent chroma
+           for each field. It can be used for general input when
+           the two input frames are different.
+
+           The output is 4:2:2, but the input is 4:2:0. Thus the output
+           has twice the lines of the input, and each full chroma plane
+           in the input corresponds to a field chroma plane in the
+           output.
+        */
+        for( unsigned y = i_start; y < i_end; y++ )
+            CopyPlaneLine( p_out, y, (y & 1) ? p_bottom : p_top, y / 2 );
+    }
+    else if( i_output_chroma == CC_SOURCE_TOP ||
+             i_output_chroma == CC_SOURCE_BOTTOM )
+    {
+        /* Copy chroma of one input field, and ignore the chroma of the
+           other one. Input and output are both 4:2:0, so we just copy
+           the whole plane. */
+        const plane_t *p_src = i_output_chroma == CC_SOURCE_TOP ? p_top
+                                                                : p_bottom;
+        for( unsigned y = i_start; y < i_end; y++ )
+            CopyPlaneLine( p_out, y, p_src, y );
+    }
+    else /* i_output_chroma == CC_MERGE */
+    {
+        /* Average the chroma of the input fields.
+           Input and output are both 4:2:0. */
+        int w = FFMIN3( p_top->i_visible_pitch, p_bottom->i_visible_pitch,
+                        p_out->i_visible_pitch );
+
+        for( unsigned y = i_start; y < i_end; y++ )
+            Merge( &p_out->p_pixels[y * p_out->i_pitch],
+                   &p_top->p_pixels[y * p_top->i_pitch],
+                   &p_bottom->p_pixels[y * p_bottom->i_pitch], w );
+        EndMerge();
+    }
+}
+
 /* See header for function doc. */
 void ComposeFrame( filter_t *p_filter,
                    picture_t *p_outpic,
@@ -268,114 +328,17 @@ void ComposeFrame( filter_t *p_filter,
             i_output_chroma == CC_SOURCE_BOTTOM ||
             i_output_chroma == CC_MERGE );
 
-    const bool b_upconvert_chroma = i_output_chroma == CC_UPCONVERT;
-
-    for( int i_plane = 0 ; i_plane < p_inpic_top->i_planes ; i_plane++ )
-    {
-        bool b_is_chroma_plane = ( i_plane == U_PLANE || i_plane == V_PLANE );
-
-        int i_out_plane;
-        if( b_is_chroma_plane  &&  b_upconvert_chroma  && swapped_uv_conversion )
-        {
-            if( i_plane == U_PLANE )
-                i_out_plane = V_PLANE;
-            else /* V_PLANE */
-                i_out_plane = U_PLANE;
-        }
-        else
-        {
-            i_out_plane = i_plane;
-        }
-
-        /* Copy luma or chroma, alternating between input fields. */
-        if( !b_is_chroma_plane  ||  i_output_chroma == CC_ALTLINE )
-        {
-            /* Do an alternating line copy. This is always done for luma,
-               and for 4:2:2 chroma. It can be requested for 4:2:0 chroma
-               using CC_ALTLINE (see function doc).
-
-               Note that when we get here, the number of lines matches
-               in input and output.
-            */
-            plane_t dst_top;
-            plane_t dst_bottom;
-            plane_t src_top;
-            plane_t src_bottom;
-            FieldFromPlane( &dst_top,    &p_outpic->p[i_out_plane],   0 );
-            FieldFromPlane( &dst_bottom, &p_outpic->p[i_out_plane],   1 );
-            FieldFromPlane( &src_top,    &p_inpic_top->p[i_plane],    0 );
-            FieldFromPlane( &src_bottom, &p_inpic_bottom->p[i_plane], 1 );
-
-            /* Copy each field from the corresponding source. */
-            plane_CopyPixels( &dst_top,    &src_top    );
-            plane_CopyPixels( &dst_bottom, &src_bottom );
-        }
-        else /* Input 4:2:0, on a chroma plane, and not in altline mode. */
-        {
-            if( i_output_chroma == CC_UPCONVERT )
-            {
-                /* Upconverting copy - use all data from both input fields.
-
-                   This produces an output picture with independent chroma
-                   for each field. It can be used for general input when
-                   the two input frames are different.
-
-                   The output is 4:2:2, but the input is 4:2:0. Thus the output
-                   has twice the lines of the input, and each full chroma plane
-                   in the input corresponds to a field chroma plane in the
-                   output.
-                */
-                plane_t dst_top;
-                plane_t dst_bottom;
-                FieldFromPlane( &dst_top,    &p_outpic->p[i_out_plane], 0 );
-                FieldFromPlane( &dst_bottom, &p_outpic->p[i_out_plane], 1 );
-
-                /* Copy each field from the corresponding source. */
-                plane_CopyPixels( &dst_top,    &p_inpic_top->p[i_plane]    );
-                plane_CopyPixels( &dst_bottom, &p_inpic_bottom->p[i_plane] );
-            }
-            else if( i_output_chroma == CC_SOURCE_TOP )
-            {
-                /* Copy chroma of input top field. Ignore chroma of input
-                   bottom field. Input and output are both 4:2:0, so we just
-                   copy the whole plane. */
-                plane_CopyPixels( &p_outpic->p[i_out_plane],
-                                  &p_inpic_top->p[i_plane] );
-            }
-            else if( i_output_chroma == CC_SOURCE_BOTTOM )
-            {
-                /* Copy chroma of input bottom field. Ignore chroma of input
-                   top field. Input and output are both 4:2:0, so we just
-                   copy the whole plane. */
-                plane_CopyPixels( &p_outpic->p[i_out_plane],
-                                  &p_inpic_bottom->p[i_plane] );
-            }
-            else /* i_output_chroma == CC_MERGE */
-            {
-                /* Average the chroma of the input fields.
-                   Input and output are both 4:2:0. */
-                uint8_t *p_in_top, *p_in_bottom, *p_out_end, *p_out;
-                p_in_top    = p_inpic_top->p[i_plane].p_pixels;
-                p_in_bottom = p_inpic_bottom->p[i_plane].p_pixels;
-                p_out = p_outpic->p[i_out_plane].p_pixels;
-                p_out_end = p_out + p_outpic->p[i_out_plane].i_pitch
-                                  * p_outpic->p[i_out_plane].i_visible_lines;
-
-                int w = FFMIN3( p_inpic_top->p[i_plane].i_visible_pitch,
-                                p_inpic_bottom->p[i_plane].i_visible_pitch,
-                                p_outpic->p[i_plane].i_visible_pitch );
-
-                for( ; p_out < p_out_end ; )
-                {
-                    Merge( p_out, p_in_top, p_in_bottom, w );
-                    p_out       += p_outpic->p[i_out_plane].i_pitch;
-                    p_in_top    += p_inpic_top->p[i_plane].i_pitch;
-                    p_in_bottom += p_inpic_bottom->p[i_plane].i_pitch;
-                }
-                EndMerge();
-            }
-        }
-    }
+    struct compose_slice slice = {
+        .p_outpic = p_outpic,
+        .p_inpic_top = p_inpic_top,
+        .p_inpic_bottom = p_inpic_bottom,
+        .i_output_chroma = i_output_chroma,
+        .swapped_uv_conversion = swapped_uv_conversion,
+    };
+
+    /* The output lines are composed in slices, concurrently */
+    filter_ExecuteSlices( p_filter, ComposeSlice, &slice, p_outpic,
+                          p_inpic_top->i_planes );
 }
 
 /* See header for function doc. */
@@ -84,6 +84,8 @@ typedef enum { CC_ALTLINE, CC_UPCONVERT, CC_SOURCE_TOP, CC_SOURCE_BOTTOM,
  *                       (Note that this has no effect if the input fields
  *                        come from the same frame.)
  *
+ * The lines are composed concurrently on the filter slice threads.
+ *
  * @param p_filter The filter instance (determines input chroma).
  * @param p_outpic Composed picture is written here. Allocated by caller.
  * @param p_inpic_top Picture to extract the top field from.
@@ -147,3 +147,126 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+// ================ AVX2 =================
+#define HAVE_YADIF_AVX2
+#define VLC_TARGET __attribute__ ((__target__ ("avx2")))
+#define VEC __m256i
+#define SET1(v) _mm256_set1_epi16(v)
+#define ADD(a,b) _mm256_add_epi16(a,b)
+#define SUB(a,b) _mm256_sub_epi16(a,b)
+#define SRA1(a) _mm256_srai_epi16(a,1)
+#define ABS(a) _mm256_abs_epi16(a)
+#define MAX(a,b) _mm256_max_epi16(a,b)
+#define MIN(a,b) _mm256_min_epi16(a,b)
+#define CMPGT(a,b) _mm256_cmpgt_epi16(a,b)
+#define AND(a,b) _mm256_and_si256(a,b)
+#define BLEND(a,b,mask) _mm256_blendv_epi8(a,b,mask)
+
+#define pixel uint8_t
+#define STEP 16
+#define LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define STORE(p,v) _mm_storeu_si128((__m128i *)(p), \
+    _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define FILTER_TAIL yadif_filter_line_c
+#define RENAME(a) a ## _avx2
+#include "yadif_intrinsics_template.h"
+#undef RENAME
+#undef FILTER_TAIL
+#undef STORE
+#undef LOAD
+#undef STEP
+#undef pixel
+
+#undef SET1
+#undef ADD
+#undef SUB
+#undef SRA1
+#undef ABS
+#undef MAX
+#undef MIN
+#undef CMPGT
+#define SET1(v) _mm256_set1_epi32(v)
+#define ADD(a,b) _mm256_add_epi32(a,b)
+#define SUB(a,b) _mm256_sub_epi32(a,b)
+#define SRA1(a) _mm256_srai_epi32(a,1)
+#define ABS(a) _mm256_abs_epi32(a)
+#define MAX(a,b) _mm256_max_epi32(a,b)
+#define MIN(a,b) _mm256_min_epi32(a,b)
+#define CMPGT(a,b) _mm256_cmpgt_epi32(a,b)
+
+#define pixel uint16_t
+#define STEP 8
+#define LOAD(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define STORE(p,v) _mm_storeu_si128((__m128i *)(p), \
+    _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define FILTER_TAIL yadif_filter_line_c_16bit
+#define RENAME(a) a ## _16bit_avx2
+#include "yadif_intrinsics_template.h"
+#undef RENAME
+#undef FILTER_TAIL
+#undef STORE
+#undef LOAD
+#undef STEP
+#undef pixel
+
+#undef VLC_TARGET
+#undef VEC
+#undef SET1
+#undef ADD
+#undef SUB
+#undef SRA1
+#undef ABS
+#undef MAX
+#undef MIN
+#undef CMPGT
+#undef AND
+#undef BLEND
+#endif
+
+#ifdef HAVE_SSE4_1_INTRINSICS
+#include <smmintrin.h>
+// =============== SSE4.1 ================
+#define HAVE_YADIF_SSE4_1
+#define VLC_TARGET __attribute__ ((__target__ ("sse4.1")))
+#define VEC __m128i
+#define SET1(v) _mm_set1_epi32(v)
+#define ADD(a,b) _mm_add_epi32(a,b)
+#define SUB(a,b) _mm_sub_epi32(a,b)
+#define SRA1(a) _mm_srai_epi32(a,1)
+#define ABS(a) _mm_abs_epi32(a)
+#define MAX(a,b) _mm_max_epi32(a,b)
+#define MIN(a,b) _mm_min_epi32(a,b)
+#define CMPGT(a,b) _mm_cmpgt_epi32(a,b)
+#define AND(a,b) _mm_and_si128(a,b)
+#define BLEND(a,b,mask) _mm_blendv_epi8(a,b,mask)
+
+#define pixel uint16_t
+#define STEP 4
+#define LOAD(p) _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(p)))
+#define STORE(p,v) _mm_storel_epi64((__m128i *)(p), _mm_packus_epi32(v, v))
+#define FILTER_TAIL yadif_filter_line_c_16bit
+#define RENAME(a) a ## _16bit_sse4_1
+#include "yadif_intrinsics_template.h"
+#undef RENAME
+#undef FILTER_TAIL
+#undef STORE
+#undef LOAD
+#undef STEP
+#undef pixel
+
+#undef VLC_TARGET
+#undef VEC
+#undef SET1
+#undef ADD
+#undef SUB
+#undef SRA1
+#undef ABS
+#undef MAX
+#undef MIN
+#undef CMPGT
+#undef AND
+#undef BLEND
+#endif
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * yadif_intrinsics_template.h: Yadif line filter with SIMD intrinsics
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This is the FILTER macro of yadif.h computed on STEP pixels at once, and
+ * it gives the same results. The including file defines:
+ *  - VLC_TARGET, RENAME(a), pixel and STEP,
+ *  - VEC and the LOAD(p), STORE(p,v), SET1(v), ADD(a,b), SUB(a,b),
+ *    SRA1(a), ABS(a), MAX(a,b), MIN(a,b), CMPGT(a,b), AND(a,b) and
+ *    BLEND(a,b,mask) operations on signed lanes,
+ *  - FILTER_TAIL, the C function used for the remaining pixels.
+ */
+
+#define SCORE(j) \
+    ADD(ADD(ABS(SUB(LOAD(&cur[mrefs-1+(j)]), LOAD(&cur[prefs-1-(j)]))), \
+            ABS(SUB(LOAD(&cur[mrefs  +(j)]), LOAD(&cur[prefs  -(j)])))), \
+            ABS(SUB(LOAD(&cur[mrefs+1+(j)]), LOAD(&cur[prefs+1-(j)]))))
+
+#define PRED(j) SRA1(ADD(LOAD(&cur[mrefs+(j)]), LOAD(&cur[prefs-(j)])))
+
+/* The check of j=2 (or -2) only counts if the check of j=1 (or -1) did */
+#define CHECK_PAIR(j) \
+    { \
+        VEC score = SCORE(j); \
+        VEC mask = CMPGT(spatial_score, score); \
+        spatial_score = BLEND(spatial_score, score, mask); \
+        spatial_pred = BLEND(spatial_pred, PRED(j), mask); \
+        score = SCORE(2*(j)); \
+        mask = AND(mask, CMPGT(spatial_score, score)); \
+        spatial_score = BLEND(spatial_score, score, mask); \
+        spatial_pred = BLEND(spatial_pred, PRED(2*(j)), mask); \
+    }
+
+VLC_TARGET static void RENAME(yadif_filter_line)(pixel *dst, pixel *prev,
+                                                 pixel *cur, pixel *next,
+                                                 int w, int prefs, int mrefs,
+                                                 int parity, int mode)
+{
+    pixel *prev2 = parity ? prev : cur ;
+    pixel *next2 = parity ? cur  : next;
+    const int prefs_bytes = prefs, mrefs_bytes = mrefs;
+    const VEC one = SET1(1);
+    int x;
+
+    prefs /= (int)sizeof(pixel);
+    mrefs /= (int)sizeof(pixel);
+
+    for (x = 0; x + STEP <= w; x += STEP) {
+        VEC c = LOAD(&cur[mrefs]);
+        VEC e = LOAD(&cur[prefs]);
+        VEC p2 = LOAD(prev2);
+        VEC n2 = LOAD(next2);
+        VEC d = SRA1(ADD(p2, n2));
+        VEC temporal_diff0 = ABS(SUB(p2, n2));
+        VEC temporal_diff1 = SRA1(ADD(ABS(SUB(LOAD(&prev[mrefs]), c)),
+                                      ABS(SUB(LOAD(&prev[prefs]), e))));
+        VEC temporal_diff2 = SRA1(ADD(ABS(SUB(LOAD(&next[mrefs]), c)),
+                                      ABS(SUB(LOAD(&next[prefs]), e))));
+        VEC diff = MAX(MAX(SRA1(temporal_diff0), temporal_diff1),
+                       temporal_diff2);
+        VEC spatial_pred = SRA1(ADD(c, e));
+        VEC spatial_score =
+            SUB(ADD(ADD(ABS(SUB(LOAD(&cur[mrefs-1]), LOAD(&cur[prefs-1]))),
+                        ABS(SUB(c, e))),
+                    ABS(SUB(LOAD(&cur[mrefs+1]), LOAD(&cur[prefs+1])))), one);
+
+        CHECK_PAIR(-1)
+        CHECK_PAIR(1)
+
+        if (mode < 2) {
+            VEC b = SRA1(ADD(LOAD(&prev2[2*mrefs]), LOAD(&next2[2*mrefs])));
+            VEC f = SRA1(ADD(LOAD(&prev2[2*prefs]), LOAD(&next2[2*prefs])));
+            VEC dc = SUB(d, c), de = SUB(d, e);
+            VEC bc = SUB(b, c), fe = SUB(f, e);
+            VEC max = MAX(MAX(de, dc), MIN(bc, fe));
+            VEC min = MIN(MIN(de, dc), MAX(bc, fe));
+
+            diff = MAX(MAX(diff, min), SUB(SET1(0), max));
+        }
+
+        /* diff is never negative, so this is the same as the C version */
+        spatial_pred = MAX(MIN(spatial_pred, ADD(d, diff)), SUB(d, diff));
+
+        STORE(dst, spatial_pred);
+
+        dst += STEP;
+        cur += STEP;
+        prev += STEP;
+        next += STEP;
+        prev2 += STEP;
+        next2 += STEP;
+    }
+
+    if (x < w)
+        FILTER_TAIL(dst, prev, cur, next, w - x, prefs_bytes, mrefs_bytes,
+                    parity, mode);
+}
+
+#undef CHECK_PAIR
+#undef PRED
+#undef SCORE
@@ -139,7 +139,10 @@ static int Open(vlc_object_t *this)
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
     cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
+    cfg->LineCur = malloc(HQDN3D_ROWS*wmax*sizeof(unsigned int));
+    if (!cfg->Line || !cfg->LineCur) {
+        free(cfg->Line);
+        free(cfg->LineCur);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -186,6 +189,7 @@ static void Close(vlc_object_t *this)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    free(cfg->LineCur);
     free(sys);
 }
 
@@ -222,19 +226,19 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     vlc_mutex_unlock( &sys->coefs_mutex );
 
     deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
+            cfg->Line, cfg->LineCur, &cfg->Frame[0], sys->w[0], sys->h[0],
             src->p[0].i_pitch, dst->p[0].i_pitch,
             cfg->Coefs[0],
             cfg->Coefs[0],
             cfg->Coefs[1]);
     deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
+            cfg->Line, cfg->LineCur, &cfg->Frame[1], sys->w[1], sys->h[1],
             src->p[1].i_pitch, dst->p[1].i_pitch,
             cfg->Coefs[2],
             cfg->Coefs[2],
             cfg->Coefs[3]);
     deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
+            cfg->Line, cfg->LineCur, &cfg->Frame[2], sys->w[2], sys->h[2],
             src->p[2].i_pitch, dst->p[2].i_pitch,
             cfg->Coefs[2],
             cfg->Coefs[2],
@@ -30,92 +30,102 @@
 
 //===========================================================================//
 
+#define HQDN3D_ROWS 8
+
 struct vf_priv_s {
         int Coefs[4][512*16];
         unsigned int *Line;
+        unsigned int *LineCur; // HQDN3D_ROWS lines
         unsigned short *Frame[3];
 };
 
 
 /***************************************************************************/
 
-static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, int* Coef){
+static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, const int* Coef){
 //    int dMul= (PrevMul&0xFFFFFF)-(CurrMul&0xFFFFFF);
     int dMul= PrevMul-CurrMul;
     unsigned int d=((dMul+0x10007FF)>>12);
     return CurrMul + Coef[d];
 }
 
-static void deNoiseTemporal(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
-                    int *Temporal)
+/* The horizontal low-pass is recursive along the line, but the lines are
+ * independent: HQDN3D_ROWS lines are filtered at once to hide the latency of
+ * the coefficients lookups. The vertical and temporal low-passes only depend
+ * on the previous line and frame, so they are done line by line. */
+static void deNoiseHorizontal(const unsigned char *Frame,
+                              unsigned int *LineCur,
+                              long W, const int *Horizontal)
 {
-    unsigned int PixelDst;
+    /* First pixel on each line doesn't have previous pixel */
+    unsigned int PixelAnt = LineCur[0] = Frame[0]<<16;
 
-    for (long Y = 0; Y < H; Y++){
-        for (long X = 0; X < W; X++){
-            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
-            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-        }
-        Frame += sStride;
-        FrameDest += dStride;
-        FrameAnt += W;
-    }
+    for (long X = 1; X < W; X++)
+        LineCur[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
 }
 
-static void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+static void deNoiseHorizontalRows(const unsigned char *Frame, int sStride,
+                                  unsigned int *LineCur, long W,
+                                  const int *Horizontal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
+    unsigned int PixelAnt[HQDN3D_ROWS];
 
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    for (int k = 0; k < HQDN3D_ROWS; k++)
+        PixelAnt[k] = LineCur[k*W] = Frame[k*sStride]<<16;
 
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+    for (long X = 1; X < W; X++)
+        for (int k = 0; k < HQDN3D_ROWS; k++)
+            LineCur[k*W+X] = PixelAnt[k] =
+                LowPassMul(PixelAnt[k], Frame[k*sStride+X]<<16, Horizontal);
+}
+
+static void deNoiseTemporalRow(const unsigned char *Frame,
+                               unsigned char *FrameDest,
+                               unsigned short *FrameAnt,
+                               long W, const int *Temporal)
+{
+    for (long X = 0; X < W; X++){
+        unsigned int PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
         FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
+}
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
+static void deNoiseVerticalRow(const unsigned int *LineCur,
+                               unsigned int *LineAnt,
+                               unsigned char *FrameDest,
+                               long W, const int *Vertical)
+{
+    for (long X = 0; X < W; X++){
+        unsigned int PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], LineCur[X], Vertical);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+}
+
+static void deNoiseVerticalTemporalRow(const unsigned int *LineCur,
+                                       unsigned int *LineAnt,
+                                       unsigned short *FrameAnt,
+                                       unsigned char *FrameDest, long W,
+                                       const int *Vertical,
+                                       const int *Temporal)
+{
+    for (long X = 0; X < W; X++){
+        LineAnt[X] = LowPassMul(LineAnt[X], LineCur[X], Vertical);
+        unsigned int PixelDst = LowPassMul(FrameAnt[X]<<8, LineAnt[X], Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+static void deNoise(const unsigned char *Frame, // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
+                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
+                    unsigned int *LineCur,       // vf->priv->LineCur (HQDN3D_ROWS lines)
                     unsigned short **FrameAntPtr,
                     int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+                    const int *Horizontal, const int *Vertical,
+                    const int *Temporal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
     unsigned short* FrameAnt=(*FrameAntPtr);
 
     if(!FrameAnt){
@@ -124,56 +134,50 @@ static void deNoise(unsigned char *Frame,        // mpi->planes[x]
             return;
         for (long Y = 0; Y < H; Y++){
             unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
+            const unsigned char* src=Frame+Y*sStride;
             for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
         }
     }
 
     if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
+        for (long Y = 0; Y < H; Y++)
+            deNoiseTemporalRow(Frame + Y*sStride, FrameDest + Y*dStride,
+                               FrameAnt + Y*W, W, Temporal);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
+    for (long Y = 0; Y < H;){
+        long Lines = 1;
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        if (Y == 0 && !Temporal[0]){
+            /* Without temporal filtering, the pixels of the first line have
+             * always been filtered against the first pixel only. */
+            LineCur[0] = Frame[0]<<16;
+            for (long X = 1; X < W; X++)
+                LineCur[X] = LowPassMul(LineCur[0], Frame[X]<<16, Horizontal);
+        }
+        else if (Y + HQDN3D_ROWS <= H){
+            deNoiseHorizontalRows(Frame + Y*sStride, sStride, LineCur, W,
+                                  Horizontal);
+            Lines = HQDN3D_ROWS;
+        }
+        else
+            deNoiseHorizontal(Frame + Y*sStride, LineCur, W, Horizontal);
+
+        for (long k = 0; k < Lines; k++, Y++){
+            /* First line has no top neighbor: the vertical low-pass of a
+             * pixel with itself is the identity. */
+            if (Y == 0)
+                memcpy(LineAnt, LineCur, W * sizeof(*LineAnt));
+
+            if(!Temporal[0])
+                deNoiseVerticalRow(LineCur + k*W, LineAnt,
+                                   FrameDest + Y*dStride, W, Vertical);
+            else
+                deNoiseVerticalTemporalRow(LineCur + k*W, LineAnt,
+                                           FrameAnt + Y*W,
+                                           FrameDest + Y*dStride, W,
+                                           Vertical, Temporal);
         }
     }
 }
@@ -1,6 +1,7 @@
 /*****************************************************************************
  * scale.c: video scaling module for YUVP/A, I420 and RGBA pictures
- *  Uses the low quality "nearest neighbour" algorithm.
+ *  Uses bilinear or bicubic separable filters, or the low quality
+ *  "nearest neighbour" algorithm.
  *****************************************************************************
  * Copyright (C) 2003-2007 VLC authors and VideoLAN
  * $Id$
@@ -30,26 +31,171 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#include "scale.h"
+
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 
+#define MODE_TEXT N_("Scaling mode")
+#define MODE_LONGTEXT N_("Scaling mode to use. Palettized pictures are " \
+    "always scaled with the nearest neighbour.")
+
+static const int pi_mode_values[] = {
+    SCALE_NEAREST, SCALE_BILINEAR, SCALE_BICUBIC };
+static const char *const ppsz_mode_descriptions[] = {
+    N_("Nearest neighbour (bad quality)"), N_("Bilinear"),
+    N_("Bicubic (good quality)") };
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_capability( "video converter", 10 )
-    set_callbacks( OpenFilter, NULL )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_callbacks( OpenFilter, CloseFilter )
+    add_integer( "scale-mode", SCALE_BICUBIC, MODE_TEXT, MODE_LONGTEXT, true )
+        change_integer_list( pi_mode_values, ppsz_mode_descriptions )
 vlc_module_end ()
 
+struct filter_sys_t
+{
+    int i_mode;
+    unsigned i_planes;
+    unsigned i_pixel_size; /* interleaved components */
+    scale_table_t h[PICTURE_PLANE_MAX];
+    scale_table_t v[PICTURE_PLANE_MAX];
+    unsigned pi_src_width[PICTURE_PLANE_MAX];
+    unsigned pi_src_height[PICTURE_PLANE_MAX];
+    scale_kernels_t kernels;
+
+    /* Scratch memory of the slices, one per concurrent slice */
+    vlc_mutex_t scratch_lock;
+    size_t i_scratch_size;
+    uint8_t *p_scratch;
+    unsigned i_scratch_free;
+    uint8_t **pp_scratch_free;
+};
+
+static void CleanTables( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+    {
+        scale_table_Clean( &p_sys->h[i] );
+        scale_table_Clean( &p_sys->v[i] );
+    }
+}
+
+/* Ring of horizontally filtered lines, then the vertical taps, then the
+ * padded input line */
+static size_t ScratchSize( const scale_table_t *h, const scale_table_t *v,
+                           unsigned i_pixel_size, bool b_pad )
+{
+    return v->i_taps * h->i_size * i_pixel_size * sizeof(int16_t)
+         + v->i_taps * (sizeof(int16_t *) + sizeof(int) + sizeof(int16_t))
+         + (b_pad ? h->i_taps * i_pixel_size : 0);
+}
+
+static int InitScratch( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_count = filter_GetSliceThreads( p_filter );
+
+    p_sys->i_scratch_size = 0;
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+    {
+        const bool b_pad = p_sys->h[i].i_taps > p_sys->pi_src_width[i];
+        const size_t i_size = ScratchSize( &p_sys->h[i], &p_sys->v[i],
+                                           p_sys->i_pixel_size, b_pad );
+
+        p_sys->i_scratch_size = __MAX( p_sys->i_scratch_size, i_size );
+    }
+    /* Keep the ring of lines of each buffer aligned */
+    p_sys->i_scratch_size = (p_sys->i_scratch_size + 63) & ~(size_t)63;
+
+    p_sys->p_scratch = malloc( i_count * p_sys->i_scratch_size );
+    p_sys->pp_scratch_free = malloc( i_count * sizeof(uint8_t *) );
+    if( unlikely(p_sys->p_scratch == NULL || p_sys->pp_scratch_free == NULL) )
+    {
+        free( p_sys->pp_scratch_free );
+        free( p_sys->p_scratch );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+        p_sys->pp_scratch_free[i] = &p_sys->p_scratch[i * p_sys->i_scratch_size];
+    p_sys->i_scratch_free = i_count;
+    vlc_mutex_init( &p_sys->scratch_lock );
+    return VLC_SUCCESS;
+}
+
+static void CleanScratch( filter_sys_t *p_sys )
+{
+    vlc_mutex_destroy( &p_sys->scratch_lock );
+    free( p_sys->pp_scratch_free );
+    free( p_sys->p_scratch );
+}
+
+static int InitTables( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_filter->fmt_in.video.i_chroma );
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+
+    if( p_dsc == NULL )
+        return VLC_EGENERIC;
+
+    p_sys->i_planes = 0;
+    p_sys->i_pixel_size = p_dsc->pixel_size;
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+    {
+        const unsigned i_src_width = p_in->i_width * p_dsc->p[i].w.num
+                                                   / p_dsc->p[i].w.den;
+        const unsigned i_src_height = p_in->i_height * p_dsc->p[i].h.num
+                                                     / p_dsc->p[i].h.den;
+        const unsigned i_dst_width = p_out->i_width * p_dsc->p[i].w.num
+                                                    / p_dsc->p[i].w.den;
+        const unsigned i_dst_height = p_out->i_height * p_dsc->p[i].h.num
+                                                      / p_dsc->p[i].h.den;
+
+        if( i_src_width == 0 || i_src_height == 0
+         || i_dst_width == 0 || i_dst_height == 0 )
+            goto error;
+
+        if( scale_table_Init( &p_sys->h[i], p_sys->i_mode,
+                              i_src_width, i_dst_width ) )
+            goto error;
+        if( scale_table_Init( &p_sys->v[i], p_sys->i_mode,
+                              i_src_height, i_dst_height ) )
+        {
+            scale_table_Clean( &p_sys->h[i] );
+            goto error;
+        }
+        p_sys->pi_src_width[i] = i_src_width;
+        p_sys->pi_src_height[i] = i_src_height;
+        p_sys->i_planes++;
+    }
+    return VLC_SUCCESS;
+
+error:
+    CleanTables( p_sys );
+    return VLC_EGENERIC;
+}
+
 /*****************************************************************************
  * OpenFilter: probe the filter and return score
  *****************************************************************************/
@@ -72,17 +218,151 @@ static int OpenFilter( vlc_object_t *p_this )
     if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
         return VLC_EGENERIC;
 
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+    p_filter->p_sys = p_sys;
+
+    p_sys->i_mode = var_InheritInteger( p_filter, "scale-mode" );
+    p_sys->i_planes = 0;
+    if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_YUVP )
+        p_sys->i_mode = SCALE_NEAREST;
+    if( p_sys->i_mode != SCALE_BILINEAR && p_sys->i_mode != SCALE_BICUBIC )
+        p_sys->i_mode = SCALE_NEAREST;
+
+    if( p_sys->i_mode != SCALE_NEAREST )
+    {
+        if( InitTables( p_filter ) )
+        {
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+        if( InitScratch( p_filter ) )
+        {
+            CleanTables( p_sys );
+            free( p_sys );
+            return VLC_ENOMEM;
+        }
+    }
+    scale_InitKernels( &p_sys->kernels );
+
 #warning Converter cannot (really) change output format.
     video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
     p_filter->pf_video_filter = Filter;
 
-    msg_Dbg( p_filter, "%ix%i -> %ix%i", p_filter->fmt_in.video.i_width,
-             p_filter->fmt_in.video.i_height, p_filter->fmt_out.video.i_width,
-             p_filter->fmt_out.video.i_height );
+    msg_Dbg( p_filter, "%ix%i -> %ix%i (mode %d)",
+             p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
+             p_filter->fmt_out.video.i_width, p_filter->fmt_out.video.i_height,
+             p_sys->i_mode );
 
     return VLC_SUCCESS;
 }
 
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_mode != SCALE_NEAREST )
+        CleanScratch( p_sys );
+    CleanTables( p_sys );
+    free( p_sys );
+}
+
+/****************************************************************************
+ * ScaleSlice: filter the lines [i_start, i_end) of an output plane
+ ****************************************************************************/
+struct scale_job
+{
+    const picture_t *p_src;
+    picture_t *p_dst;
+};
+
+static void ScaleSlice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                        unsigned i_start, unsigned i_end )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const struct scale_job *p_job = opaque;
+    const scale_table_t *h = &p_sys->h[i_plane];
+    const scale_table_t *v = &p_sys->v[i_plane];
+    const plane_t *p_src = &p_job->p_src->p[i_plane];
+    const plane_t *p_dst = &p_job->p_dst->p[i_plane];
+    const unsigned i_pixel_size = p_sys->i_pixel_size;
+    const unsigned i_src_width = p_sys->pi_src_width[i_plane];
+    const unsigned i_src_height = p_sys->pi_src_height[i_plane];
+    const unsigned i_tmp_width = h->i_size * i_pixel_size;
+    const unsigned i_width = __MIN( i_tmp_width,
+                                    (unsigned)p_dst->i_visible_pitch );
+    const bool b_pad = h->i_taps > i_src_width;
+    const scale_h_cb pf_h = i_pixel_size == 1 ? p_sys->kernels.pf_h
+                                              : scale_h_packed_C;
+
+    i_end = __MIN( i_end, v->i_size );
+    if( i_start >= i_end )
+        return;
+
+    /* At most filter_GetSliceThreads() slices run at once */
+    vlc_mutex_lock( &p_sys->scratch_lock );
+    assert( p_sys->i_scratch_free > 0 );
+    uint8_t *p_mem = p_sys->pp_scratch_free[--p_sys->i_scratch_free];
+    vlc_mutex_unlock( &p_sys->scratch_lock );
+
+    /* Ring of horizontally filtered lines, indexed by input line modulo the
+     * number of taps, so the lines of the window of a given output line
+     * never collide */
+    size_t i_tmp_size = v->i_taps * i_tmp_width * sizeof(int16_t);
+    assert( ScratchSize( h, v, i_pixel_size, b_pad ) <= p_sys->i_scratch_size );
+
+    int16_t *p_tmp = (int16_t *)p_mem;
+    const int16_t **pp_lines = (const int16_t **)(p_mem + i_tmp_size);
+    int *pi_rows = (int *)&pp_lines[v->i_taps];
+    int16_t *pi_coefs = (int16_t *)&pi_rows[v->i_taps];
+    uint8_t *p_pad = (uint8_t *)&pi_coefs[v->i_taps];
+
+    if( b_pad )
+        memset( p_pad, 0, h->i_taps * i_pixel_size );
+    for( unsigned i = 0; i < v->i_taps; i++ )
+        pi_rows[i] = -1;
+
+    for( unsigned y = i_start; y < i_end; y++ )
+    {
+        unsigned i_taps = v->i_taps;
+
+        for( unsigned i = 0; i < v->i_taps; i++ )
+        {
+            const int i_row = __MIN( v->pi_pos[y] + i, i_src_height - 1 );
+            const unsigned i_slot = i_row % v->i_taps;
+            int16_t *p_line = &p_tmp[i_slot * i_tmp_width];
+
+            if( pi_rows[i_slot] != i_row )
+            {
+                const uint8_t *p_in = &p_src->p_pixels[i_row * p_src->i_pitch];
+                if( b_pad )
+                {
+                    memcpy( p_pad, p_in, i_src_width * i_pixel_size );
+                    p_in = p_pad;
+                }
+                pf_h( p_line, p_in, h );
+                pi_rows[i_slot] = i_row;
+            }
+            pp_lines[i] = p_line;
+            pi_coefs[i] = SCALE_COEF(v, y, i);
+        }
+
+        /* Skip the padding taps */
+        while( i_taps > 2 && pi_coefs[i_taps - 1] == 0
+                          && pi_coefs[i_taps - 2] == 0 )
+            i_taps -= 2;
+
+        p_sys->kernels.pf_v( &p_dst->p_pixels[y * p_dst->i_pitch],
+                             pp_lines, pi_coefs, i_taps, i_width );
+    }
+
+    vlc_mutex_lock( &p_sys->scratch_lock );
+    p_sys->pp_scratch_free[p_sys->i_scratch_free++] = p_mem;
+    vlc_mutex_unlock( &p_sys->scratch_lock );
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************/
@@ -103,9 +383,16 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         return NULL;
     }
 
-    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 )
+    if( p_filter->p_sys->i_mode != SCALE_NEAREST )
+    {
+        struct scale_job job = { .p_src = p_pic, .p_dst = p_pic_dst };
+
+        filter_ExecuteSlices( p_filter, ScaleSlice, &job, p_pic_dst,
+                              p_filter->p_sys->i_planes );
+    }
+    else if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
+             p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
+             p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 )
     {
         for( int i_plane = 0; i_plane < p_pic_dst->i_planes; i_plane++ )
         {
@@ -0,0 +1,504 @@
+/*****************************************************************************
+ * scale.h: separable polyphase scaler for 8-bit planes
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_SCALE_H
+#define VLC_VIDEO_FILTER_SCALE_H
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define SCALE_NEON 1
+#endif
+
+/* Each output sample is a weighted sum of i_taps consecutive input samples.
+ * The weights are in 2.14 fixed point and always sum to 1 << 14.
+ *
+ * The horizontal pass stores its results with SCALE_TMP_BITS more bits of
+ * precision in 16-bit intermediate lines, which the vertical pass combines
+ * into the output lines. Both passes only use integer arithmetic, so all
+ * versions of the kernels give the exact same pictures. */
+#define SCALE_COEF_BITS 14
+#define SCALE_TMP_BITS  6
+
+enum
+{
+    SCALE_NEAREST,
+    SCALE_BILINEAR,
+    SCALE_BICUBIC,
+};
+
+typedef struct
+{
+    unsigned i_taps;    /**< Coefficients per output sample, multiple of 4 */
+    unsigned i_size;    /**< Number of output samples */
+    int *pi_pos;        /**< Index of the first input sample */
+    int16_t *pi_coefs;  /**< Coefficients, see SCALE_COEF() */
+} scale_table_t;
+
+/* The coefficients are stored by groups of 4 taps, so that the
+ * coefficients of consecutive outputs are contiguous in each group. */
+#define SCALE_COEF(t, x, i) \
+    (t)->pi_coefs[((((i) >> 2) * (t)->i_size + (x)) << 2) + ((i) & 3)]
+
+static inline double scale_Kernel( int i_mode, double x )
+{
+    x = fabs( x );
+    if( i_mode == SCALE_BILINEAR )
+        return x < 1. ? 1. - x : 0.;
+
+    /* Catmull-Rom (Keys, a = -0.5) */
+    if( x < 1. )
+        return (1.5 * x - 2.5) * x * x + 1.;
+    if( x < 2. )
+        return ((-0.5 * x + 2.5) * x - 4.) * x + 2.;
+    return 0.;
+}
+
+static inline void scale_table_Clean( scale_table_t *t )
+{
+    free( t->pi_pos );
+    free( t->pi_coefs );
+}
+
+/**
+ * Computes the filter table to scale i_src samples to i_dst samples.
+ * When downscaling, the kernel is stretched to cover all the input samples.
+ * Samples outside of the input are replaced by the nearest edge sample.
+ */
+static inline int scale_table_Init( scale_table_t *t, int i_mode,
+                                    unsigned i_src, unsigned i_dst )
+{
+    const double f_ratio = (double)i_src / i_dst;
+    const double f_stretch = f_ratio > 1. ? f_ratio : 1.;
+    const double f_support = (i_mode == SCALE_BILINEAR ? 1. : 2.) * f_stretch;
+    const unsigned i_window = ceil( 2. * f_support );
+
+    t->i_taps = (i_window + 3) & ~3;
+    t->i_size = i_dst;
+    t->pi_pos = malloc( i_dst * sizeof(*t->pi_pos) );
+    t->pi_coefs = malloc( i_dst * t->i_taps * sizeof(*t->pi_coefs) );
+    if( unlikely(t->pi_pos == NULL || t->pi_coefs == NULL) )
+    {
+        scale_table_Clean( t );
+        return VLC_ENOMEM;
+    }
+
+    double pf_weights[t->i_taps];
+
+    for( unsigned x = 0; x < i_dst; x++ )
+    {
+        const double f_center = (x + .5) * f_ratio - .5;
+        const int i_first = floor( f_center - f_support ) + 1;
+        int i_pos = __MIN( i_first, (int)i_src - (int)t->i_taps );
+        double f_sum = 0.;
+
+        i_pos = __MAX( i_pos, 0 );
+        for( unsigned i = 0; i < t->i_taps; i++ )
+            pf_weights[i] = 0.;
+        for( unsigned i = 0; i < i_window; i++ )
+        {
+            const int j = i_first + i;
+            const double w = scale_Kernel( i_mode, (j - f_center) / f_stretch );
+
+            pf_weights[VLC_CLIP( j, 0, (int)i_src - 1 ) - i_pos] += w;
+            f_sum += w;
+        }
+
+        /* Normalize, and put the rounding error on the biggest weight */
+        int i_sum = 0;
+        unsigned i_max = 0;
+        for( unsigned i = 0; i < t->i_taps; i++ )
+        {
+            const int c = lround( pf_weights[i] / f_sum
+                                  * (1 << SCALE_COEF_BITS) );
+            SCALE_COEF(t, x, i) = c;
+            i_sum += c;
+            if( c > SCALE_COEF(t, x, i_max) )
+                i_max = i;
+        }
+        SCALE_COEF(t, x, i_max) += (1 << SCALE_COEF_BITS) - i_sum;
+        t->pi_pos[x] = i_pos;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Horizontal pass: i_size intermediate samples from one input line.
+ * The input line must hold at least pi_pos[x] + i_taps samples.
+ *****************************************************************************/
+typedef void (*scale_h_cb)( int16_t *, const uint8_t *, const scale_table_t * );
+
+#define SCALE_H_ROUND(sum) \
+    (((sum) + (1 << (SCALE_COEF_BITS - SCALE_TMP_BITS - 1))) \
+     >> (SCALE_COEF_BITS - SCALE_TMP_BITS))
+
+static inline void scale_h_sample( int16_t *p_dst, const uint8_t *p_src,
+                                   const scale_table_t *t, unsigned x,
+                                   unsigned i_pixel_size )
+{
+    const uint8_t *p = &p_src[t->pi_pos[x] * i_pixel_size];
+
+    for( unsigned c = 0; c < i_pixel_size; c++ )
+    {
+        int i_sum = 0;
+        for( unsigned i = 0; i < t->i_taps; i++ )
+            i_sum += p[i * i_pixel_size + c] * SCALE_COEF(t, x, i);
+        p_dst[x * i_pixel_size + c] = SCALE_H_ROUND(i_sum);
+    }
+}
+
+static void scale_h_C( int16_t *p_dst, const uint8_t *p_src,
+                       const scale_table_t *t )
+{
+    for( unsigned x = 0; x < t->i_size; x++ )
+        scale_h_sample( p_dst, p_src, t, x, 1 );
+}
+
+/* Interleaved components, such as RGBA */
+static void scale_h_packed_C( int16_t *p_dst, const uint8_t *p_src,
+                              const scale_table_t *t )
+{
+    for( unsigned x = 0; x < t->i_size; x++ )
+        scale_h_sample( p_dst, p_src, t, x, 4 );
+}
+
+/*****************************************************************************
+ * Vertical pass: i_width output samples from i_taps intermediate lines.
+ * i_taps is even.
+ *****************************************************************************/
+typedef void (*scale_v_cb)( uint8_t *, const int16_t *const *,
+                            const int16_t *, unsigned, unsigned );
+
+#define SCALE_V_SHIFT (SCALE_COEF_BITS + SCALE_TMP_BITS)
+
+static inline uint8_t scale_v_sample( const int16_t *const *pp_src,
+                                      const int16_t *pi_coefs,
+                                      unsigned i_taps, unsigned x )
+{
+    int i_sum = 1 << (SCALE_V_SHIFT - 1);
+
+    for( unsigned i = 0; i < i_taps; i++ )
+        i_sum += pp_src[i][x] * pi_coefs[i];
+    i_sum >>= SCALE_V_SHIFT;
+    return VLC_CLIP( i_sum, 0, 255 );
+}
+
+static void scale_v_C( uint8_t *p_dst, const int16_t *const *pp_src,
+                       const int16_t *pi_coefs, unsigned i_taps,
+                       unsigned i_width )
+{
+    for( unsigned x = 0; x < i_width; x++ )
+        p_dst[x] = scale_v_sample( pp_src, pi_coefs, i_taps, x );
+}
+
+#if defined(HAVE_SSE2_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+/* Two consecutive coefficients, as multiplied by pmaddwd */
+static inline int32_t scale_CoefPair( const int16_t *pi_coefs, unsigned i )
+{
+    return (uint16_t)pi_coefs[i] | ((uint32_t)(uint16_t)pi_coefs[i + 1] << 16);
+}
+#endif
+
+#ifdef HAVE_SSE2_INTRINSICS
+static inline __m128i scale_Load32( const uint8_t *p )
+{
+    int32_t v;
+    memcpy( &v, p, sizeof(v) );
+    return _mm_cvtsi32_si128( v );
+}
+
+/* 4 outputs at once, 4 taps at a time */
+__attribute__ ((__target__ ("sse2")))
+static void scale_h_SSE2( int16_t *p_dst, const uint8_t *p_src,
+                          const scale_table_t *t )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round =
+        _mm_set1_epi32( 1 << (SCALE_COEF_BITS - SCALE_TMP_BITS - 1) );
+    unsigned x = 0;
+
+    for( ; x + 4 <= t->i_size; x += 4 )
+    {
+        const uint8_t *p0 = &p_src[t->pi_pos[x]];
+        const uint8_t *p1 = &p_src[t->pi_pos[x + 1]];
+        const uint8_t *p2 = &p_src[t->pi_pos[x + 2]];
+        const uint8_t *p3 = &p_src[t->pi_pos[x + 3]];
+        __m128i sum = round;
+
+        for( unsigned i = 0; i < t->i_taps; i += 4 )
+        {
+            const int16_t *c = &SCALE_COEF(t, x, i);
+            __m128i v = _mm_unpacklo_epi64(
+                _mm_unpacklo_epi32( scale_Load32( p0 + i ),
+                                    scale_Load32( p1 + i ) ),
+                _mm_unpacklo_epi32( scale_Load32( p2 + i ),
+                                    scale_Load32( p3 + i ) ) );
+            __m128i m01 = _mm_madd_epi16( _mm_unpacklo_epi8( v, zero ),
+                              _mm_loadu_si128( (const __m128i *)c ) );
+            __m128i m23 = _mm_madd_epi16( _mm_unpackhi_epi8( v, zero ),
+                              _mm_loadu_si128( (const __m128i *)(c + 8) ) );
+
+            /* Add the pairs of products of each output */
+            m01 = _mm_shuffle_epi32( m01, _MM_SHUFFLE(3, 1, 2, 0) );
+            m23 = _mm_shuffle_epi32( m23, _MM_SHUFFLE(3, 1, 2, 0) );
+            sum = _mm_add_epi32( sum, _mm_add_epi32(
+                                 _mm_unpacklo_epi64( m01, m23 ),
+                                 _mm_unpackhi_epi64( m01, m23 ) ) );
+        }
+        sum = _mm_srai_epi32( sum, SCALE_COEF_BITS - SCALE_TMP_BITS );
+        _mm_storel_epi64( (__m128i *)&p_dst[x], _mm_packs_epi32( sum, sum ) );
+    }
+    for( ; x < t->i_size; x++ )
+        scale_h_sample( p_dst, p_src, t, x, 1 );
+}
+
+/* 16 outputs at once, 2 taps at a time */
+__attribute__ ((__target__ ("sse2")))
+static void scale_v_SSE2( uint8_t *p_dst, const int16_t *const *pp_src,
+                          const int16_t *pi_coefs, unsigned i_taps,
+                          unsigned i_width )
+{
+    const __m128i round = _mm_set1_epi32( 1 << (SCALE_V_SHIFT - 1) );
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        __m128i s0 = round, s1 = round, s2 = round, s3 = round;
+
+        for( unsigned i = 0; i < i_taps; i += 2 )
+        {
+            const __m128i c = _mm_set1_epi32( scale_CoefPair( pi_coefs, i ) );
+            const __m128i *a = (const __m128i *)&pp_src[i][x];
+            const __m128i *b = (const __m128i *)&pp_src[i + 1][x];
+            __m128i a0 = _mm_loadu_si128( a ), a1 = _mm_loadu_si128( a + 1 );
+            __m128i b0 = _mm_loadu_si128( b ), b1 = _mm_loadu_si128( b + 1 );
+
+            s0 = _mm_add_epi32( s0, _mm_madd_epi16( _mm_unpacklo_epi16( a0, b0 ), c ) );
+            s1 = _mm_add_epi32( s1, _mm_madd_epi16( _mm_unpackhi_epi16( a0, b0 ), c ) );
+            s2 = _mm_add_epi32( s2, _mm_madd_epi16( _mm_unpacklo_epi16( a1, b1 ), c ) );
+            s3 = _mm_add_epi32( s3, _mm_madd_epi16( _mm_unpackhi_epi16( a1, b1 ), c ) );
+        }
+        s0 = _mm_packs_epi32( _mm_srai_epi32( s0, SCALE_V_SHIFT ),
+                              _mm_srai_epi32( s1, SCALE_V_SHIFT ) );
+        s2 = _mm_packs_epi32( _mm_srai_epi32( s2, SCALE_V_SHIFT ),
+                              _mm_srai_epi32( s3, SCALE_V_SHIFT ) );
+        _mm_storeu_si128( (__m128i *)&p_dst[x], _mm_packus_epi16( s0, s2 ) );
+    }
+    for( ; x < i_width; x++ )
+        p_dst[x] = scale_v_sample( pp_src, pi_coefs, i_taps, x );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+/* 8 outputs at once, 4 taps at a time, gathering the input samples */
+__attribute__ ((__target__ ("avx2")))
+static void scale_h_AVX2( int16_t *p_dst, const uint8_t *p_src,
+                          const scale_table_t *t )
+{
+    const __m256i round =
+        _mm256_set1_epi32( 1 << (SCALE_COEF_BITS - SCALE_TMP_BITS - 1) );
+    unsigned x = 0;
+
+    for( ; x + 8 <= t->i_size; x += 8 )
+    {
+        const __m256i pos = _mm256_loadu_si256( (const __m256i *)&t->pi_pos[x] );
+        __m256i sum = _mm256_setzero_si256();
+
+        for( unsigned i = 0; i < t->i_taps; i += 4 )
+        {
+            const __m256i *c = (const __m256i *)&SCALE_COEF(t, x, i);
+            __m256i v = _mm256_i32gather_epi32( (const int *)&p_src[i], pos, 1 );
+            __m256i m0 = _mm256_madd_epi16(
+                _mm256_cvtepu8_epi16( _mm256_castsi256_si128( v ) ),
+                _mm256_loadu_si256( c ) );
+            __m256i m1 = _mm256_madd_epi16(
+                _mm256_cvtepu8_epi16( _mm256_extracti128_si256( v, 1 ) ),
+                _mm256_loadu_si256( c + 1 ) );
+
+            /* outputs 0, 1, 4, 5 | 2, 3, 6, 7 */
+            sum = _mm256_add_epi32( sum, _mm256_hadd_epi32( m0, m1 ) );
+        }
+        sum = _mm256_permute4x64_epi64( sum, _MM_SHUFFLE(3, 1, 2, 0) );
+        sum = _mm256_srai_epi32( _mm256_add_epi32( sum, round ),
+                                 SCALE_COEF_BITS - SCALE_TMP_BITS );
+        _mm_storeu_si128( (__m128i *)&p_dst[x],
+                          _mm_packs_epi32( _mm256_castsi256_si128( sum ),
+                                           _mm256_extracti128_si256( sum, 1 ) ) );
+    }
+    for( ; x < t->i_size; x++ )
+        scale_h_sample( p_dst, p_src, t, x, 1 );
+}
+
+/* 32 outputs at once, 2 taps at a time */
+__attribute__ ((__target__ ("avx2")))
+static void scale_v_AVX2( uint8_t *p_dst, const int16_t *const *pp_src,
+                          const int16_t *pi_coefs, unsigned i_taps,
+                          unsigned i_width )
+{
+    const __m256i round = _mm256_set1_epi32( 1 << (SCALE_V_SHIFT - 1) );
+    unsigned x = 0;
+
+    for( ; x + 32 <= i_width; x += 32 )
+    {
+        __m256i s0 = round, s1 = round, s2 = round, s3 = round;
+
+        for( unsigned i = 0; i < i_taps; i += 2 )
+        {
+            const __m256i c = _mm256_set1_epi32( scale_CoefPair( pi_coefs, i ) );
+            const __m256i *a = (const __m256i *)&pp_src[i][x];
+            const __m256i *b = (const __m256i *)&pp_src[i + 1][x];
+            __m256i a0 = _mm256_loadu_si256( a ), a1 = _mm256_loadu_si256( a + 1 );
+            __m256i b0 = _mm256_loadu_si256( b ), b1 = _mm256_loadu_si256( b + 1 );
+
+            s0 = _mm256_add_epi32( s0, _mm256_madd_epi16( _mm256_unpacklo_epi16( a0, b0 ), c ) );
+            s1 = _mm256_add_epi32( s1, _mm256_madd_epi16( _mm256_unpackhi_epi16( a0, b0 ), c ) );
+            s2 = _mm256_add_epi32( s2, _mm256_madd_epi16( _mm256_unpacklo_epi16( a1, b1 ), c ) );
+            s3 = _mm256_add_epi32( s3, _mm256_madd_epi16( _mm256_unpackhi_epi16( a1, b1 ), c ) );
+        }
+        /* The unpacking and packing are both per 128-bit lane, so that only
+         * the final 64-bit quarters are out of order */
+        s0 = _mm256_packs_epi32( _mm256_srai_epi32( s0, SCALE_V_SHIFT ),
+                                 _mm256_srai_epi32( s1, SCALE_V_SHIFT ) );
+        s2 = _mm256_packs_epi32( _mm256_srai_epi32( s2, SCALE_V_SHIFT ),
+                                 _mm256_srai_epi32( s3, SCALE_V_SHIFT ) );
+        s0 = _mm256_permute4x64_epi64( _mm256_packus_epi16( s0, s2 ),
+                                       _MM_SHUFFLE(3, 1, 2, 0) );
+        _mm256_storeu_si256( (__m256i *)&p_dst[x], s0 );
+    }
+    for( ; x < i_width; x++ )
+        p_dst[x] = scale_v_sample( pp_src, pi_coefs, i_taps, x );
+}
+#endif
+
+#ifdef SCALE_NEON
+/* 4 outputs at once, 4 taps at a time */
+static void scale_h_NEON( int16_t *p_dst, const uint8_t *p_src,
+                          const scale_table_t *t )
+{
+    unsigned x = 0;
+
+    for( ; x + 4 <= t->i_size; x += 4 )
+    {
+        int32x4_t sum = vdupq_n_s32( 0 );
+
+        for( unsigned i = 0; i < t->i_taps; i += 4 )
+        {
+            const int16_t *c = &SCALE_COEF(t, x, i);
+            uint32_t in[4];
+
+            for( unsigned k = 0; k < 4; k++ )
+                memcpy( &in[k], &p_src[t->pi_pos[x + k] + i], 4 );
+
+            uint8x16_t v = vreinterpretq_u8_u32( vld1q_u32( in ) );
+            int16x8_t v01 = vreinterpretq_s16_u16( vmovl_u8( vget_low_u8( v ) ) );
+            int16x8_t v23 = vreinterpretq_s16_u16( vmovl_high_u8( v ) );
+            int16x8_t c01 = vld1q_s16( c ), c23 = vld1q_s16( c + 8 );
+            int32x4_t m0 = vmull_s16( vget_low_s16( v01 ), vget_low_s16( c01 ) );
+            int32x4_t m1 = vmull_high_s16( v01, c01 );
+            int32x4_t m2 = vmull_s16( vget_low_s16( v23 ), vget_low_s16( c23 ) );
+            int32x4_t m3 = vmull_high_s16( v23, c23 );
+
+            sum = vaddq_s32( sum, vpaddq_s32( vpaddq_s32( m0, m1 ),
+                                              vpaddq_s32( m2, m3 ) ) );
+        }
+        sum = vaddq_s32( sum,
+            vdupq_n_s32( 1 << (SCALE_COEF_BITS - SCALE_TMP_BITS - 1) ) );
+        sum = vshrq_n_s32( sum, SCALE_COEF_BITS - SCALE_TMP_BITS );
+        vst1_s16( &p_dst[x], vmovn_s32( sum ) );
+    }
+    for( ; x < t->i_size; x++ )
+        scale_h_sample( p_dst, p_src, t, x, 1 );
+}
+
+/* 8 outputs at once */
+static void scale_v_NEON( uint8_t *p_dst, const int16_t *const *pp_src,
+                          const int16_t *pi_coefs, unsigned i_taps,
+                          unsigned i_width )
+{
+    const int32x4_t round = vdupq_n_s32( 1 << (SCALE_V_SHIFT - 1) );
+    unsigned x = 0;
+
+    for( ; x + 8 <= i_width; x += 8 )
+    {
+        int32x4_t s0 = round, s1 = round;
+
+        for( unsigned i = 0; i < i_taps; i++ )
+        {
+            int16x8_t a = vld1q_s16( &pp_src[i][x] );
+
+            s0 = vmlal_n_s16( s0, vget_low_s16( a ), pi_coefs[i] );
+            s1 = vmlal_high_n_s16( s1, a, pi_coefs[i] );
+        }
+        int16x8_t v = vcombine_s16( vqmovn_s32( vshrq_n_s32( s0, SCALE_V_SHIFT ) ),
+                                    vqmovn_s32( vshrq_n_s32( s1, SCALE_V_SHIFT ) ) );
+        vst1_u8( &p_dst[x], vqmovun_s16( v ) );
+    }
+    for( ; x < i_width; x++ )
+        p_dst[x] = scale_v_sample( pp_src, pi_coefs, i_taps, x );
+}
+#endif
+
+typedef struct
+{
+    scale_h_cb pf_h;
+    scale_v_cb pf_v;
+} scale_kernels_t;
+
+static inline void scale_InitKernels( scale_kernels_t *k )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        k->pf_h = scale_h_AVX2;
+        k->pf_v = scale_v_AVX2;
+        return;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        k->pf_h = scale_h_SSE2;
+        k->pf_v = scale_v_SSE2;
+        return;
+    }
+#endif
+#ifdef SCALE_NEON
+    if( vlc_CPU_ARM64_NEON() )
+    {
+        k->pf_h = scale_h_NEON;
+        k->pf_v = scale_v_NEON;
+        return;
+    }
+#endif
+    k->pf_h = scale_h_C;
+    k->pf_v = scale_v_C;
+}
+
+#endif
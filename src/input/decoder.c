@@ -94,6 +94,10 @@ struct decoder_owner_sys_t
 
     /* fifo */
     block_fifo_t *p_fifo;
+    int           i_fifo_cat; /* ES category, for the fifo statistics */
+    mtime_t       i_fifo_max; /* queue duration limit when not paced */
+    mtime_t       i_fifo_stat; /* queue duration last reported in stats,
+                                   * under the fifo lock */
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -145,6 +149,14 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/* The demuxer is paced once the decoder fifo holds that many blocks spanning
+ * DECODER_FIFO_PACE_DURATION or more (or with no usable timestamps) */
+#define DECODER_FIFO_PACE_COUNT     10
+#define DECODER_FIFO_PACE_DURATION  ((mtime_t)(0.400*CLOCK_FREQ))
+/* Last resort for unpaced input without timestamps: 400 MiB, i.e. ~ 50mb/s
+ * for 60s */
+#define DECODER_FIFO_MAX_BYTES      (400*1024*1024)
+
 /**
  * Load a decoder module
  */
@@ -1019,11 +1031,42 @@ static void DecoderUpdateStatVideo( decoder_t *p_dec, unsigned decoded,
         lost += vout_lost;
     }
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
     stats_Update( input_priv(p_input)->counters.p_decoded_video, decoded, NULL );
     stats_Update( input_priv(p_input)->counters.p_lost_pictures, lost , NULL);
     stats_Update( input_priv(p_input)->counters.p_displayed_pictures, displayed, NULL);
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
+}
+
+static void DecoderUpdateStatFifo( decoder_t *p_dec, mtime_t i_duration,
+                                   unsigned i_dropped )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    input_thread_t *p_input = p_owner->p_input;
+
+    /* Do not touch the shared counters for every block */
+    if( p_input == NULL || (i_dropped == 0
+     && llabs( i_duration - p_owner->i_fifo_stat ) < CLOCK_FREQ / 100
+     && (i_duration != 0 || p_owner->i_fifo_stat == 0)) )
+        return;
+
+    counter_t *p_counter;
+    switch( p_owner->i_fifo_cat )
+    {
+        case VIDEO_ES:
+            p_counter = input_priv(p_input)->counters.p_video_fifo;
+            break;
+        case AUDIO_ES:
+            p_counter = input_priv(p_input)->counters.p_audio_fifo;
+            break;
+        default:
+            p_counter = NULL;
+            break;
+    }
+
+    /* The queue counters are the sum of the durations of all decoders */
+    stats_Update( p_counter, i_duration - p_owner->i_fifo_stat, NULL );
+    stats_Update( input_priv(p_input)->counters.p_fifo_dropped, i_dropped,
+                  NULL );
+    p_owner->i_fifo_stat = i_duration;
 }
 
 static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
@@ -1039,17 +1082,36 @@ static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
 
 static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 {
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
     picture_t      *p_pic;
     block_t **pp_block = p_block ? &p_block : NULL;
     unsigned i_lost = 0, i_decoded = 0;
 
+    /* Only the time spent in the decoder module is accounted */
+    stats_histogram_t *p_hist = NULL;
+    mtime_t i_start = 0, i_time = 0;
+
+    if( p_owner->p_input != NULL && p_block != NULL )
+        p_hist = input_priv(p_owner->p_input)->counters.p_video_decode;
+    if( p_hist != NULL )
+        i_start = mdate();
+
     while( (p_pic = p_dec->pf_decode_video( p_dec, pp_block ) ) )
     {
         i_decoded++;
 
+        if( p_hist != NULL )
+            i_time += mdate() - i_start;
+
         DecoderPlayVideo( p_dec, p_pic, &i_lost );
+
+        if( p_hist != NULL )
+            i_start = mdate();
     }
 
+    if( p_hist != NULL )
+        stats_HistogramAdd( p_hist, i_time + mdate() - i_start );
+
     DecoderUpdateStatVideo( p_dec, i_decoded, i_lost );
 }
 
@@ -1213,11 +1275,9 @@ static void DecoderUpdateStatAudio( decoder_t *p_dec, unsigned decoded,
         lost += aout_lost;
     }
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock);
     stats_Update( input_priv(p_input)->counters.p_lost_abuffers, lost, NULL );
     stats_Update( input_priv(p_input)->counters.p_played_abuffers, played, NULL );
     stats_Update( input_priv(p_input)->counters.p_decoded_audio, decoded, NULL );
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock);
 }
 
 static int DecoderQueueAudio( decoder_t *p_dec, block_t *p_aout_buf )
@@ -1346,11 +1406,7 @@ static int DecoderQueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
     input_thread_t *p_input = p_owner->p_input;
 
     if( p_input != NULL )
-    {
-        vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
         stats_Update( input_priv(p_input)->counters.p_decoded_sub, 1, NULL );
-        vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
-    }
 
     int i_ret = -1;
     vout_thread_t *p_vout = input_resource_HoldVout( p_owner->p_resource );
@@ -1572,6 +1628,9 @@ static void *DecoderThread( void *p_data )
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
         block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        /* Keep the queue depth right when the input stalls or ends */
+        DecoderUpdateStatFifo( p_dec, vlc_fifo_GetDuration( p_owner->p_fifo ),
+                               0 );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
@@ -1681,6 +1740,20 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     }
 
+    const char *psz_fifo_duration;
+    switch( fmt->i_cat )
+    {
+        case VIDEO_ES: psz_fifo_duration = "video-fifo-duration"; break;
+        case AUDIO_ES: psz_fifo_duration = "audio-fifo-duration"; break;
+        case SPU_ES:   psz_fifo_duration = "spu-fifo-duration"; break;
+        default:       psz_fifo_duration = NULL; break;
+    }
+    p_owner->i_fifo_cat = fmt->i_cat;
+    p_owner->i_fifo_max = psz_fifo_duration != NULL
+        ? var_InheritInteger( p_dec, psz_fifo_duration ) * (CLOCK_FREQ / 1000)
+        : 0;
+    p_owner->i_fifo_stat = 0;
+
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -1971,6 +2044,9 @@ void input_DecoderDelete( decoder_t *p_dec )
 
     vlc_join( p_owner->thread, NULL );
 
+    /* Withdraw the remaining queue duration from the statistics */
+    DecoderUpdateStatFifo( p_dec, 0, 0 );
+
     /* */
     if( p_dec->p_owner->cc.b_supported )
     {
@@ -1982,6 +2058,81 @@ void input_DecoderDelete( decoder_t *p_dec )
     DeleteDecoder( p_dec );
 }
 
+static mtime_t BlockGetTimestamp( const block_t *p_block )
+{
+    return p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : p_block->i_pts;
+}
+
+/**
+ * Drops the oldest blocks of the fifo, so that it spans at most i_duration
+ * since its last discontinuity.
+ * For video, the queue is cut before a key frame if the demuxer flagged any,
+ * so that the decoder can resume without references to dropped pictures.
+ * The fifo must be locked.
+ * \return the number of dropped blocks
+ */
+static unsigned DecoderFifoTrim( decoder_t *p_dec, mtime_t i_duration )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    block_t *p_chain = vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo );
+    block_t **pp_cut = &p_chain;
+    mtime_t i_last = VLC_TS_INVALID;
+
+    /* As in vlc_fifo_GetDuration(), only the timestamps since the last
+     * discontinuity are compared: the blocks before it are all dropped. */
+    for( block_t **pp = &p_chain; *pp != NULL; pp = &(*pp)->p_next )
+    {
+        if( (*pp)->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        {
+            pp_cut = pp;
+            i_last = VLC_TS_INVALID;
+        }
+        i_last = __MAX( i_last, BlockGetTimestamp( *pp ) );
+    }
+
+    while( *pp_cut != NULL )
+    {
+        mtime_t i_ts = BlockGetTimestamp( *pp_cut );
+        if( i_ts > VLC_TS_INVALID && i_last - i_ts <= i_duration )
+            break;
+        pp_cut = &(*pp_cut)->p_next;
+    }
+
+    if( p_owner->i_fifo_cat == VIDEO_ES )
+    {
+        for( block_t **pp = pp_cut; *pp != NULL; pp = &(*pp)->p_next )
+            if( (*pp)->i_flags & BLOCK_FLAG_TYPE_I )
+            {
+                pp_cut = pp;
+                break;
+            }
+    }
+
+    block_t *p_kept = *pp_cut;
+    unsigned i_dropped = 0;
+
+    *pp_cut = NULL;
+    for( const block_t *p = p_chain; p != NULL; p = p->p_next )
+        i_dropped++;
+    block_ChainRelease( p_chain );
+
+    if( p_kept != NULL )
+    {
+        p_kept->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_kept );
+    }
+    return i_dropped;
+}
+
+static bool DecoderFifoIsFull( decoder_owner_sys_t *p_owner )
+{
+    if( vlc_fifo_GetCount( p_owner->p_fifo ) < DECODER_FIFO_PACE_COUNT )
+        return false;
+
+    mtime_t i_duration = vlc_fifo_GetDuration( p_owner->p_fifo );
+    return i_duration == 0 || i_duration >= DECODER_FIFO_PACE_DURATION;
+}
+
 /**
  * Put a block_t in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
@@ -1992,17 +2143,27 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    unsigned i_dropped = 0;
 
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
-        /* FIXME: ideally we would check the time amount of data
-         * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        /* The data is not consumed quickly enough: drop the oldest part of
+         * the queue rather than buffering without bounds. */
+        if( p_owner->i_fifo_max > 0
+         && vlc_fifo_GetDuration( p_owner->p_fifo ) > p_owner->i_fifo_max )
+        {
+            i_dropped = DecoderFifoTrim( p_dec, p_owner->i_fifo_max / 2 );
+            msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
+                      "consumed quickly enough), dropped %u blocks",
+                      i_dropped );
+        }
+        else
+        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > DECODER_FIFO_MAX_BYTES )
         {
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
+            i_dropped = vlc_fifo_GetCount( p_owner->p_fifo );
             block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
         }
     }
@@ -2011,11 +2172,13 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        while( DecoderFifoIsFull( p_owner ) )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    DecoderUpdateStatFifo( p_dec, vlc_fifo_GetDuration( p_owner->p_fifo ),
+                           i_dropped );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
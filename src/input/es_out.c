@@ -1966,7 +1966,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     {
         uint64_t i_total;
 
-        vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
         stats_Update( input_priv(p_input)->counters.p_demux_read,
                       p_block->i_buffer, &i_total );
         stats_Update( input_priv(p_input)->counters.p_demux_bitrate, i_total, NULL );
@@ -1981,7 +1980,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         {
             stats_Update( input_priv(p_input)->counters.p_demux_discontinuity, 1, NULL );
         }
-        vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
     }
 
     vlc_mutex_lock( &p_sys->lock );
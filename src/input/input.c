@@ -247,8 +247,6 @@ static void input_Destructor( vlc_object_t *obj )
 
     vlc_gc_decref( priv->p_item );
 
-    vlc_mutex_destroy( &priv->counters.counters_lock );
-
     for( int i = 0; i < priv->i_control; i++ )
     {
         input_control_t *p_ctrl = &priv->control[i];
@@ -460,7 +458,6 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
 
     /* */
     memset( &priv->counters, 0, sizeof( priv->counters ) );
-    vlc_mutex_init( &priv->counters.counters_lock );
 
     priv->p_es_out_display = input_EsOutNew( p_input, priv->i_rate );
     priv->p_es_out = NULL;
@@ -819,6 +816,13 @@ static void InitStatistics( input_thread_t *p_input )
         INIT_COUNTER( decoded_audio, COUNTER );
         INIT_COUNTER( decoded_video, COUNTER );
         INIT_COUNTER( decoded_sub, COUNTER );
+        INIT_COUNTER( audio_fifo, COUNTER );
+        INIT_COUNTER( video_fifo, COUNTER );
+        INIT_COUNTER( fifo_dropped, COUNTER );
+        INIT_COUNTER( cache_hits, COUNTER );
+        INIT_COUNTER( cache_misses, COUNTER );
+        INIT_COUNTER( cache_refills, COUNTER );
+        priv->counters.p_video_decode = stats_HistogramCreate();
         priv->counters.p_sout_send_bitrate = NULL;
         priv->counters.p_sout_sent_packets = NULL;
         priv->counters.p_sout_sent_bytes = NULL;
@@ -1404,6 +1408,14 @@ error:
         EXIT_COUNTER( decoded_audio );
         EXIT_COUNTER( decoded_video );
         EXIT_COUNTER( decoded_sub );
+        EXIT_COUNTER( audio_fifo );
+        EXIT_COUNTER( video_fifo );
+        EXIT_COUNTER( fifo_dropped );
+        EXIT_COUNTER( cache_hits );
+        EXIT_COUNTER( cache_misses );
+        EXIT_COUNTER( cache_refills );
+        stats_HistogramClean( input_priv(p_input)->counters.p_video_decode );
+        input_priv(p_input)->counters.p_video_decode = NULL;
 
         if( input_priv(p_input)->p_sout )
         {
@@ -1476,6 +1488,14 @@ do { \
             CL_CO( decoded_audio) ;
             CL_CO( decoded_video );
             CL_CO( decoded_sub) ;
+            CL_CO( audio_fifo );
+            CL_CO( video_fifo );
+            CL_CO( fifo_dropped );
+            CL_CO( cache_hits );
+            CL_CO( cache_misses );
+            CL_CO( cache_refills );
+            stats_HistogramClean( priv->counters.p_video_decode );
+            priv->counters.p_video_decode = NULL;
         }
 
         /* Close optional stream output instance */
@@ -3205,7 +3225,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
 {
     assert( input_priv(p_input)->i_state != INIT_S );
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock);
     switch( i_type )
     {
 #define I(c) stats_Update( input_priv(p_input)->counters.c, i_delta, NULL )
@@ -3234,7 +3253,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
         msg_Err( p_input, "Invalid statistic type %d (internal error)", i_type );
         break;
     }
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock);
 }
 
 /**/
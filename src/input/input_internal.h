@@ -156,6 +156,12 @@ typedef struct input_thread_private_t
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
+        counter_t *p_audio_fifo;
+        counter_t *p_video_fifo;
+        counter_t *p_fifo_dropped;
+        counter_t *p_cache_hits;
+        counter_t *p_cache_misses;
+        counter_t *p_cache_refills;
         counter_t *p_sout_sent_packets;
         counter_t *p_sout_sent_bytes;
         counter_t *p_sout_send_bitrate;
@@ -163,7 +169,7 @@ typedef struct input_thread_private_t
         counter_t *p_lost_abuffers;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
-        vlc_mutex_t counters_lock;
+        stats_histogram_t *p_video_decode;
     } counters;
 
     /* Buffer of pending actions */
@@ -25,44 +25,186 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include "input/input_internal.h"
 
+/* Counters are updated from the input, decoder and output threads. Each of
+ * them is a single atomic variable on its own cache line, so that the updates
+ * are plain relaxed atomic operations without any false sharing. Rates are
+ * computed by the reading thread (the input thread) from sampled totals. */
+#define STATS_CACHE_LINE 64
+
+typedef struct counter_sample_t
+{
+    uint64_t value;
+    mtime_t  date;
+} counter_sample_t;
+
+struct counter_t
+{
+    atomic_uint_least64_t value;
+    int                   i_compute_type;
+
+    /* Derivative samples (reading thread only) */
+    unsigned              i_samples;
+    counter_sample_t      samples[2];
+};
+
 /**
  * Create a statistics counter
- * \param i_compute_type the aggregation type. One of STATS_LAST (always
- * keep the last value), STATS_COUNTER (increment by the passed value),
- * STATS_MAX (keep the maximum passed value), STATS_MIN, or STATS_DERIVATIVE
- * (keep a time derivative of the value)
+ * \param i_compute_type the aggregation type. One of STATS_COUNTER
+ * (increment by the passed value) or STATS_DERIVATIVE (keep a time
+ * derivative of the passed total)
  */
 counter_t * stats_CounterCreate( int i_compute_type )
 {
-    counter_t *p_counter = (counter_t*) malloc( sizeof( counter_t ) ) ;
+    counter_t *p_counter = vlc_memalign( STATS_CACHE_LINE,
+                                         sizeof( counter_t ) );
 
     if( !p_counter ) return NULL;
+    atomic_init( &p_counter->value, 0 );
     p_counter->i_compute_type = i_compute_type;
     p_counter->i_samples = 0;
-    p_counter->pp_samples = NULL;
-
-    p_counter->last_update = 0;
 
     return p_counter;
 }
 
 static inline int64_t stats_GetTotal(const counter_t *counter)
 {
-    if (counter == NULL || counter->i_samples == 0)
+    if (counter == NULL)
         return 0;
-    return counter->pp_samples[0]->value;
+    return atomic_load_explicit(&counter->value, memory_order_relaxed);
 }
 
-static inline float stats_GetRate(const counter_t *counter)
+static inline float stats_GetRate(counter_t *counter)
 {
-    if (counter == NULL || counter->i_samples < 2)
+    if (counter == NULL)
         return 0.;
 
-    return (counter->pp_samples[0]->value - counter->pp_samples[1]->value)
-        / (float)(counter->pp_samples[0]->date - counter->pp_samples[1]->date);
+    /* Sample the total at most once per second */
+    mtime_t now = mdate();
+    if (counter->i_samples == 0
+     || now - counter->samples[0].date >= CLOCK_FREQ)
+    {
+        if (counter->i_samples > 0)
+            counter->samples[1] = counter->samples[0];
+        counter->samples[0].value = stats_GetTotal(counter);
+        counter->samples[0].date = now;
+        if (counter->i_samples < 2)
+            counter->i_samples++;
+    }
+
+    if (counter->i_samples < 2)
+        return 0.;
+
+    return (counter->samples[0].value - counter->samples[1].value)
+        / (float)(counter->samples[0].date - counter->samples[1].date);
+}
+
+/* Histograms are log-linear: each power of two is split into
+ * STATS_HISTOGRAM_SUB buckets, so that percentiles are within 25%. */
+#define STATS_HISTOGRAM_SUB_BITS 2
+#define STATS_HISTOGRAM_SUB      (1 << STATS_HISTOGRAM_SUB_BITS)
+#define STATS_HISTOGRAM_BUCKETS  ((65 - STATS_HISTOGRAM_SUB_BITS) \
+                                  * STATS_HISTOGRAM_SUB)
+
+struct stats_histogram_t
+{
+    atomic_uint_least32_t buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+static unsigned stats_HistogramIndex(uint64_t value)
+{
+    if (value < STATS_HISTOGRAM_SUB)
+        return value;
+
+    unsigned e = (value >> 32) ? 63 - clz32(value >> 32)
+                               : 31 - clz32(value);
+    unsigned m = (value >> (e - STATS_HISTOGRAM_SUB_BITS))
+               & (STATS_HISTOGRAM_SUB - 1);
+    return (e - STATS_HISTOGRAM_SUB_BITS + 1) * STATS_HISTOGRAM_SUB + m;
+}
+
+/** Largest value falling in a given bucket */
+static uint64_t stats_HistogramValue(unsigned index)
+{
+    if (index < STATS_HISTOGRAM_SUB)
+        return index;
+
+    unsigned shift = index / STATS_HISTOGRAM_SUB - 1;
+    uint64_t m = STATS_HISTOGRAM_SUB + index % STATS_HISTOGRAM_SUB;
+    return (m << shift) + ((UINT64_C(1) << shift) - 1);
+}
+
+/**
+ * Create a histogram, e.g. of latencies
+ */
+stats_histogram_t *stats_HistogramCreate( void )
+{
+    stats_histogram_t *p_hist = vlc_memalign( STATS_CACHE_LINE,
+                                              sizeof( *p_hist ) );
+    if( !p_hist ) return NULL;
+
+    for( unsigned i = 0; i < STATS_HISTOGRAM_BUCKETS; i++ )
+        atomic_init( &p_hist->buckets[i], 0 );
+    return p_hist;
+}
+
+/**
+ * Account one value in a histogram. This function may be called from any
+ * thread.
+ */
+void stats_HistogramAdd( stats_histogram_t *p_hist, uint64_t value )
+{
+    if( !p_hist )
+        return;
+
+    atomic_fetch_add_explicit( &p_hist->buckets[stats_HistogramIndex(value)],
+                               1, memory_order_relaxed );
+}
+
+/**
+ * Estimate a percentile of the accounted values.
+ * \param percent the percentile (50 for the median)
+ * \return an upper bound of the percentile, or 0 if the histogram is empty
+ */
+uint64_t stats_HistogramPercentile( stats_histogram_t *p_hist,
+                                    unsigned percent )
+{
+    uint32_t counts[STATS_HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+
+    if( !p_hist )
+        return 0;
+
+    for( unsigned i = 0; i < STATS_HISTOGRAM_BUCKETS; i++ )
+    {
+        counts[i] = atomic_load_explicit( &p_hist->buckets[i],
+                                          memory_order_relaxed );
+        total += counts[i];
+    }
+    if( total == 0 )
+        return 0;
+
+    uint64_t rank = (total * percent + 99) / 100;
+    if( rank == 0 )
+        rank = 1;
+
+    for( unsigned i = 0; i < STATS_HISTOGRAM_BUCKETS; i++ )
+    {
+        if( counts[i] >= rank )
+            return stats_HistogramValue( i );
+        rank -= counts[i];
+    }
+    vlc_assert_unreachable();
+}
+
+void stats_HistogramClean( stats_histogram_t *p_hist )
+{
+    vlc_free( p_hist );
 }
 
 input_stats_t *stats_NewInputStats( input_thread_t *p_input )
@@ -85,7 +227,6 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     if (!libvlc_stats(input))
         return;
 
-    vlc_mutex_lock(&priv->counters.counters_lock);
     vlc_mutex_lock(&st->lock);
 
     /* Input */
@@ -96,10 +237,20 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     st->f_demux_bitrate = stats_GetRate(priv->counters.p_demux_bitrate);
     st->i_demux_corrupted = stats_GetTotal(priv->counters.p_demux_corrupted);
     st->i_demux_discontinuity = stats_GetTotal(priv->counters.p_demux_discontinuity);
+    st->i_cache_hits = stats_GetTotal(priv->counters.p_cache_hits);
+    st->i_cache_misses = stats_GetTotal(priv->counters.p_cache_misses);
+    st->i_cache_refills = stats_GetTotal(priv->counters.p_cache_refills);
 
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(priv->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(priv->counters.p_decoded_audio);
+    st->i_audio_fifo = stats_GetTotal(priv->counters.p_audio_fifo);
+    st->i_video_fifo = stats_GetTotal(priv->counters.p_video_fifo);
+    st->i_fifo_dropped = stats_GetTotal(priv->counters.p_fifo_dropped);
+    st->i_video_decode_p50 =
+        stats_HistogramPercentile(priv->counters.p_video_decode, 50);
+    st->i_video_decode_p99 =
+        stats_HistogramPercentile(priv->counters.p_video_decode, 99);
 
     /* Sout */
     if (priv->counters.p_sout_send_bitrate)
@@ -118,7 +269,6 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     st->i_lost_pictures = stats_GetTotal(priv->counters.p_lost_pictures);
 
     vlc_mutex_unlock(&st->lock);
-    vlc_mutex_unlock(&priv->counters.counters_lock);
 }
 
 void stats_ReinitInputStats( input_stats_t *p_stats )
@@ -129,9 +279,13 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
+    p_stats->i_cache_hits = p_stats->i_cache_misses =
+    p_stats->i_cache_refills =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
+    p_stats->i_audio_fifo = p_stats->i_video_fifo = p_stats->i_fifo_dropped =
+    p_stats->i_video_decode_p50 = p_stats->i_video_decode_p99 =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
      = 0;
     vlc_mutex_unlock( &p_stats->lock );
@@ -139,26 +293,18 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
 
 void stats_CounterClean( counter_t *p_c )
 {
-    if( p_c )
-    {
-        int i = p_c->i_samples - 1 ;
-        while( i >= 0 )
-        {
-            counter_sample_t *p_s = p_c->pp_samples[i];
-            REMOVE_ELEM( p_c->pp_samples, p_c->i_samples, i );
-            free( p_s );
-            i--;
-        }
-        free( p_c );
-    }
+    vlc_free( p_c );
 }
 
 
 /** Update a counter element with new values
  * \param p_counter the counter to update
- * \param val the vlc_value union containing the new value to aggregate. For
- * more information on how data is aggregated, \see stats_Create
- * \param val_new a pointer that will be filled with new data
+ * \param val the value to add (STATS_COUNTER) or the new total
+ * (STATS_DERIVATIVE)
+ * \param new_val a pointer that will be filled with the new total
+ * (STATS_COUNTER only)
+ *
+ * This function may be called from any thread without locking.
  */
 void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
 {
@@ -169,48 +315,24 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
     {
     case STATS_DERIVATIVE:
     {
-        counter_sample_t *p_new, *p_old;
-        mtime_t now = mdate();
-        if( now - p_counter->last_update < CLOCK_FREQ )
-            return;
-        p_counter->last_update = now;
-        /* Insert the new one at the beginning */
-        p_new = (counter_sample_t*)malloc( sizeof( counter_sample_t ) );
-        if (unlikely(p_new == NULL))
-            return; /* NOTE: Losing sample here */
-
-        p_new->value = val;
-        p_new->date = p_counter->last_update;
-        INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                     0, p_new );
-
-        if( p_counter->i_samples == 3 )
-        {
-            p_old = p_counter->pp_samples[2];
-            REMOVE_ELEM( p_counter->pp_samples, p_counter->i_samples, 2 );
-            free( p_old );
-        }
+        /* Totals from concurrent threads may be stored out of order */
+        uint64_t cur = atomic_load_explicit( &p_counter->value,
+                                             memory_order_relaxed );
+        while( cur < val
+            && !atomic_compare_exchange_weak_explicit( &p_counter->value,
+                                                       &cur, val,
+                                                       memory_order_relaxed,
+                                                       memory_order_relaxed ) );
         break;
     }
     case STATS_COUNTER:
-        if( p_counter->i_samples == 0 )
-        {
-            counter_sample_t *p_new = (counter_sample_t*)malloc(
-                                               sizeof( counter_sample_t ) );
-            if (unlikely(p_new == NULL))
-                return; /* NOTE: Losing sample here */
-
-            p_new->value = 0;
-
-            INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                         p_counter->i_samples, p_new );
-        }
-        if( p_counter->i_samples == 1 )
-        {
-            p_counter->pp_samples[0]->value += val;
-            if( new_val )
-                *new_val = p_counter->pp_samples[0]->value;
-        }
+    {
+        uint64_t total = atomic_fetch_add_explicit( &p_counter->value, val,
+                                                    memory_order_relaxed )
+                       + val;
+        if( new_val )
+            *new_val = total;
         break;
     }
+    }
 }
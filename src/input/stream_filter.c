@@ -33,6 +33,7 @@
 #include <assert.h>
 
 #include "stream.h"
+#include "input_internal.h"
 
 static void StreamDelete( stream_t * );
 
@@ -120,3 +121,18 @@ int vlc_stream_FilterDefaultReadDir( stream_t *s, input_item_node_t *p_node )
     assert( s->p_source != NULL );
     return vlc_stream_ReadDir( s->p_source, p_node );
 }
+
+void vlc_stream_FilterReportCache( stream_t *s, unsigned hits,
+                                   unsigned misses, unsigned refills )
+{
+    input_thread_t *p_input = s->p_input;
+
+    if( p_input == NULL )
+        return;
+
+    input_thread_private_t *priv = input_priv(p_input);
+
+    stats_Update( priv->counters.p_cache_hits, hits, NULL );
+    stats_Update( priv->counters.p_cache_misses, misses, NULL );
+    stats_Update( priv->counters.p_cache_refills, refills, NULL );
+}
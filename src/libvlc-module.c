@@ -386,6 +386,11 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filters threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads used by the video filters which can process " \
+    "pictures in slices (0 = one per CPU, 1 = disabled).")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -815,6 +820,13 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the clients of each HTTP/RTSP server. " \
+    "More threads allow serving more concurrent clients. The request " \
+    "handlers of a server still run one at a time. Only one thread is " \
+    "used if epoll is not available." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -901,6 +913,14 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define FIFO_DURATION_LONGTEXT N_( \
+    "Maximum amount of data queued for a decoder when the input cannot be " \
+    "paced, such as live streams (in milliseconds). Beyond it, the oldest " \
+    "data is dropped. 0 means no limit." )
+#define VIDEO_FIFO_DURATION_TEXT N_("Video decoder queue duration")
+#define AUDIO_FIFO_DURATION_TEXT N_("Audio decoder queue duration")
+#define SPU_FIFO_DURATION_TEXT N_("Subtitles decoder queue duration")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1627,6 +1647,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list( "video-filter", "video filter", NULL,
                      VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_integer( "filter-threads", 0,
+                 FILTER_THREADS_TEXT, FILTER_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
     add_module_list( "video-splitter", "video splitter", NULL,
@@ -1762,6 +1785,9 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT,
+                 HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -1887,6 +1913,9 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer( "video-fifo-duration", 60000, VIDEO_FIFO_DURATION_TEXT,
+                 FIFO_DURATION_LONGTEXT, true )
+        change_integer_range( 0, 3600000 )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -1895,7 +1924,13 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     add_module( "demux", "demux", "any", DEMUX_TEXT, DEMUX_LONGTEXT, true )
     set_subcategory( SUBCAT_INPUT_ACODEC )
+    add_integer( "audio-fifo-duration", 60000, AUDIO_FIFO_DURATION_TEXT,
+                 FIFO_DURATION_LONGTEXT, true )
+        change_integer_range( 0, 3600000 )
     set_subcategory( SUBCAT_INPUT_SCODEC )
+    add_integer( "spu-fifo-duration", 60000, SPU_FIFO_DURATION_TEXT,
+                 FIFO_DURATION_LONGTEXT, true )
+        change_integer_range( 0, 3600000 )
     add_obsolete_bool( "prefer-system-codecs" )
 
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
@@ -539,6 +539,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
         playlist_preparser_Delete(priv->parser);
 
     vlc_DeinitActions( p_libvlc, priv->actions );
+    filter_SlicesDestroy( p_libvlc );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
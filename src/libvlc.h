@@ -151,6 +151,8 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct filter_slices_t *slices; ///< Video filters slice threads (or NULL)
+    bool               b_slices_disabled; ///< No slice threads
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -167,6 +169,13 @@ void intf_DestroyAll( libvlc_int_t * );
 
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->obj.libvlc)->b_stats)
 
+/*
+ * Video filters slice threads
+ */
+typedef struct filter_slices_t filter_slices_t;
+
+void filter_SlicesDestroy( libvlc_int_t * );
+
 /*
  * Variables stuff
  */
@@ -181,20 +190,8 @@ enum
     STATS_DERIVATIVE,
 };
 
-typedef struct counter_sample_t
-{
-    uint64_t value;
-    mtime_t  date;
-} counter_sample_t;
-
-typedef struct counter_t
-{
-    int                 i_compute_type;
-    int                 i_samples;
-    counter_sample_t ** pp_samples;
-
-    mtime_t             last_update;
-} counter_t;
+typedef struct counter_t counter_t;
+typedef struct stats_histogram_t stats_histogram_t;
 
 enum
 {
@@ -223,6 +220,11 @@ counter_t * stats_CounterCreate (int);
 void stats_Update (counter_t *, uint64_t, uint64_t *);
 void stats_CounterClean (counter_t * );
 
+stats_histogram_t *stats_HistogramCreate (void);
+void stats_HistogramAdd (stats_histogram_t *, uint64_t);
+uint64_t stats_HistogramPercentile (stats_histogram_t *, unsigned);
+void stats_HistogramClean (stats_histogram_t *);
+
 void stats_ComputeInputStats(input_thread_t*, input_stats_t*);
 void stats_ReinitInputStats(input_stats_t *);
 
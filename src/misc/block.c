@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -117,6 +118,313 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Thread-cached allocator
+ *
+ * Small and medium blocks are recycled through per-thread caches rather than
+ * going back to the heap. Each cache keeps one free list per power-of-two
+ * size class. A block released from its owner thread goes straight back to
+ * the free list. A block released from another thread is pushed onto the
+ * owner's lock-free "remote" stack, which the owner drains on its next miss.
+ *
+ * A cache is reference-counted: one reference for the owner thread, plus one
+ * per block carved out of it (whether idle or in use). It is destroyed once
+ * the owner thread has exited and every block has been freed.
+ */
+
+/** Smallest cached size class (log2 of the payload capacity) */
+#define BLOCK_CACHE_MIN_SHIFT 8
+/** Largest cached size class (log2 of the payload capacity) */
+#define BLOCK_CACHE_MAX_SHIFT 16
+#define BLOCK_CACHE_CLASSES (BLOCK_CACHE_MAX_SHIFT - BLOCK_CACHE_MIN_SHIFT + 1)
+/** Maximum idle payload bytes per size class and per thread */
+#define BLOCK_CACHE_BYTES (512 << 10)
+
+typedef struct block_cache_t block_cache_t;
+
+typedef struct
+{
+    block_t self;
+    block_cache_t *cache;
+    unsigned klass;
+} block_cached_t;
+
+struct block_cache_t
+{
+    struct
+    {
+        block_t *head; /**< Idle blocks (owner thread only) */
+        unsigned count;
+    } classes[BLOCK_CACHE_CLASSES];
+
+    atomic_uintptr_t remote; /**< Blocks released by other threads */
+    atomic_uintptr_t refs;
+    atomic_bool dead;
+
+    atomic_uint_least64_t hits;
+    atomic_uint_least64_t misses;
+    atomic_uint_least64_t remote_frees;
+
+    block_cache_t *prev;
+    block_cache_t *next;
+};
+
+static vlc_mutex_t block_cache_lock = VLC_STATIC_MUTEX;
+static vlc_threadvar_t block_cache_key;
+static atomic_bool block_cache_ready = ATOMIC_VAR_INIT(false);
+static block_cache_t *block_cache_list = NULL;
+/** Statistics of the deleted caches */
+static block_cache_stats_t block_cache_totals;
+
+static unsigned block_cache_Limit(unsigned klass)
+{
+    unsigned limit = BLOCK_CACHE_BYTES >> (klass + BLOCK_CACHE_MIN_SHIFT);
+    return (limit < 8) ? 8 : (limit > 256) ? 256 : limit;
+}
+
+/** Increments a counter only ever written by the owner thread. */
+static void block_cache_Count(atomic_uint_least64_t *counter)
+{
+    atomic_store_explicit(counter,
+        atomic_load_explicit(counter, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+}
+
+static void block_cache_Unref(block_cache_t *cache)
+{
+    if (atomic_fetch_sub(&cache->refs, 1) != 1)
+        return;
+
+    vlc_mutex_lock(&block_cache_lock);
+    block_cache_totals.hits += atomic_load(&cache->hits);
+    block_cache_totals.misses += atomic_load(&cache->misses);
+    block_cache_totals.remote_frees += atomic_load(&cache->remote_frees);
+    if (cache->prev != NULL)
+        cache->prev->next = cache->next;
+    else
+        block_cache_list = cache->next;
+    if (cache->next != NULL)
+        cache->next->prev = cache->prev;
+    vlc_mutex_unlock(&block_cache_lock);
+    free(cache);
+}
+
+static void block_cached_Free(block_cached_t *cb)
+{
+    block_cache_t *cache = cb->cache;
+
+    free(cb);
+    block_cache_Unref(cache);
+}
+
+/** Frees all blocks released by other threads to a dead cache. */
+static void block_cache_FreeRemote(block_cache_t *cache)
+{
+    block_t *b = (block_t *)atomic_exchange(&cache->remote, (uintptr_t)NULL);
+
+    while (b != NULL)
+    {
+        block_t *next = b->p_next;
+
+        block_cached_Free((block_cached_t *)b);
+        b = next;
+    }
+}
+
+static void block_cache_Destroy(void *data)
+{
+    block_cache_t *cache = data;
+
+    atomic_store(&cache->dead, true);
+    block_cache_FreeRemote(cache);
+
+    for (unsigned i = 0; i < BLOCK_CACHE_CLASSES; i++)
+        for (block_t *b = cache->classes[i].head, *next; b != NULL; b = next)
+        {
+            next = b->p_next;
+            block_cached_Free((block_cached_t *)b);
+        }
+
+    block_cache_Unref(cache);
+}
+
+/**
+ * Gets the cache of the calling thread, creating it if needed.
+ * @return the cache, or NULL on error
+ */
+static block_cache_t *block_cache_Self(void)
+{
+    if (unlikely(!atomic_load_explicit(&block_cache_ready,
+                                       memory_order_acquire)))
+    {
+        vlc_mutex_lock(&block_cache_lock);
+        if (!atomic_load_explicit(&block_cache_ready, memory_order_relaxed))
+        {
+            if (vlc_threadvar_create(&block_cache_key, block_cache_Destroy))
+            {
+                vlc_mutex_unlock(&block_cache_lock);
+                return NULL;
+            }
+            atomic_store_explicit(&block_cache_ready, true,
+                                  memory_order_release);
+        }
+        vlc_mutex_unlock(&block_cache_lock);
+    }
+
+    block_cache_t *cache = vlc_threadvar_get(block_cache_key);
+    if (likely(cache != NULL))
+        return cache;
+
+    cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    for (unsigned i = 0; i < BLOCK_CACHE_CLASSES; i++)
+    {
+        cache->classes[i].head = NULL;
+        cache->classes[i].count = 0;
+    }
+    atomic_init(&cache->remote, (uintptr_t)NULL);
+    atomic_init(&cache->refs, 1);
+    atomic_init(&cache->dead, false);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->remote_frees, 0);
+    cache->prev = NULL;
+
+    if (vlc_threadvar_set(block_cache_key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&block_cache_lock);
+    cache->next = block_cache_list;
+    if (cache->next != NULL)
+        cache->next->prev = cache;
+    block_cache_list = cache;
+    vlc_mutex_unlock(&block_cache_lock);
+    return cache;
+}
+
+/** Puts an idle block back on the owner free list (owner thread only). */
+static void block_cache_Put(block_cache_t *cache, block_cached_t *cb)
+{
+    unsigned klass = cb->klass;
+
+    if (cache->classes[klass].count >= block_cache_Limit(klass))
+    {
+        block_cached_Free(cb);
+        return;
+    }
+
+    cb->self.p_next = cache->classes[klass].head;
+    cache->classes[klass].head = &cb->self;
+    cache->classes[klass].count++;
+}
+
+/** Moves blocks released by other threads to the free lists. */
+static void block_cache_Reclaim(block_cache_t *cache)
+{
+    block_t *b = (block_t *)atomic_exchange(&cache->remote, (uintptr_t)NULL);
+
+    while (b != NULL)
+    {
+        block_t *next = b->p_next;
+
+        block_cache_Put(cache, (block_cached_t *)b);
+        b = next;
+    }
+}
+
+static void block_cached_Release(block_t *block)
+{
+    block_cached_t *cb = (block_cached_t *)block;
+    block_cache_t *cache = cb->cache;
+
+    assert(block->p_start == (unsigned char *)(cb + 1));
+    block_Invalidate(block);
+
+    if (vlc_threadvar_get(block_cache_key) == cache)
+    {
+        block_cache_Put(cache, cb);
+        return;
+    }
+
+    /* Hold the cache while pushing, as the owner may be exiting. */
+    atomic_fetch_add(&cache->refs, 1);
+    atomic_fetch_add_explicit(&cache->remote_frees, 1, memory_order_relaxed);
+
+    uintptr_t head = atomic_load(&cache->remote);
+    do
+        block->p_next = (block_t *)head;
+    while (!atomic_compare_exchange_weak(&cache->remote, &head,
+                                         (uintptr_t)block));
+
+    if (atomic_load(&cache->dead))
+        block_cache_FreeRemote(cache);
+    block_cache_Unref(cache);
+}
+
+static block_t *block_cache_Alloc(block_cache_t *cache, size_t size)
+{
+    unsigned klass = 0;
+
+    if (size > (1u << BLOCK_CACHE_MIN_SHIFT))
+        klass = (sizeof (unsigned) * 8 - clz(size - 1))
+              - BLOCK_CACHE_MIN_SHIFT;
+    assert(klass < BLOCK_CACHE_CLASSES);
+
+    if (cache->classes[klass].head == NULL)
+        block_cache_Reclaim(cache);
+
+    block_cached_t *cb = (block_cached_t *)cache->classes[klass].head;
+    const size_t alloc = sizeof (*cb) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                       + (1u << (klass + BLOCK_CACHE_MIN_SHIFT));
+
+    if (cb != NULL)
+    {
+        cache->classes[klass].head = cb->self.p_next;
+        cache->classes[klass].count--;
+        block_cache_Count(&cache->hits);
+    }
+    else
+    {
+        cb = malloc(alloc);
+        if (unlikely(cb == NULL))
+            return NULL;
+
+        cb->cache = cache;
+        cb->klass = klass;
+        atomic_fetch_add(&cache->refs, 1);
+        block_cache_Count(&cache->misses);
+    }
+
+    block_t *b = &cb->self;
+
+    block_Init(b, cb + 1, alloc - sizeof (*cb));
+    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
+    b->i_buffer = size;
+    b->pf_release = block_cached_Release;
+    return b;
+}
+
+void block_GetCacheStats(block_cache_stats_t *stats)
+{
+    vlc_mutex_lock(&block_cache_lock);
+    *stats = block_cache_totals;
+    for (block_cache_t *c = block_cache_list; c != NULL; c = c->next)
+    {
+        stats->hits += atomic_load_explicit(&c->hits, memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&c->misses,
+                                              memory_order_relaxed);
+        stats->remote_frees += atomic_load_explicit(&c->remote_frees,
+                                                    memory_order_relaxed);
+    }
+    vlc_mutex_unlock(&block_cache_lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
@@ -125,6 +433,13 @@ block_t *block_Alloc (size_t size)
     if (unlikely(alloc <= size))
         return NULL;
 
+    if (size <= (1u << BLOCK_CACHE_MAX_SHIFT))
+    {
+        block_cache_t *cache = block_cache_Self();
+        if (likely(cache != NULL))
+            return block_cache_Alloc(cache, size);
+    }
+
     block_t *b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
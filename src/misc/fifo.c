@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -44,10 +45,24 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+    mtime_t             i_last_ts; /**< Newest queued timestamp */
+    const block_t       *p_span;   /**< Last queued discontinuity, if any */
+
+    /* Single producer, single consumer mode:
+     * the producer pushes onto a lock-free stack (newest block first), the
+     * consumer grabs the whole stack at once and keeps the blocks in
+     * p_first/pp_last, which it owns exclusively. The lock and condition
+     * variable are only used when the consumer has to sleep. */
+    bool                spsc;
+    atomic_uintptr_t    stack;
+    atomic_bool         parked;    /**< Whether the consumer is sleeping */
+    atomic_size_t       depth;
+    atomic_size_t       size;
 };
 
 void vlc_fifo_Lock(vlc_fifo_t *fifo)
 {
+    assert(!fifo->spsc); /* not supported with a lock-free FIFO */
     vlc_mutex_lock(&fifo->lock);
 }
 
@@ -86,6 +101,28 @@ size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
     return fifo->i_size;
 }
 
+static inline mtime_t block_GetTimestamp(const block_t *block)
+{
+    return (block->i_dts > VLC_TS_INVALID) ? block->i_dts : block->i_pts;
+}
+
+mtime_t vlc_fifo_GetDuration(const vlc_fifo_t *fifo)
+{
+    if (fifo->i_last_ts <= VLC_TS_INVALID)
+        return 0;
+
+    /* Timestamps are only comparable since the last discontinuity.
+     * Usually its block is timestamped, so this is short. */
+    for (const block_t *block = fifo->p_span ? fifo->p_span : fifo->p_first;
+         block != NULL; block = block->p_next)
+    {
+        mtime_t ts = block_GetTimestamp(block);
+        if (ts > VLC_TS_INVALID)
+            return (fifo->i_last_ts > ts) ? fifo->i_last_ts - ts : 0;
+    }
+    return 0;
+}
+
 void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 {
     vlc_assert_locked(&fifo->lock);
@@ -99,6 +136,18 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
         fifo->i_depth++;
         fifo->i_size += block->i_buffer;
 
+        if (block->i_flags & BLOCK_FLAG_DISCONTINUITY)
+        {
+            fifo->p_span = block;
+            fifo->i_last_ts = VLC_TS_INVALID;
+        }
+
+        /* Steps backward are ignored, so that the span never shrinks
+         * until the next discontinuity */
+        mtime_t ts = block_GetTimestamp(block);
+        if (ts > fifo->i_last_ts)
+            fifo->i_last_ts = ts;
+
         block = block->p_next;
     }
 
@@ -123,6 +172,10 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
     fifo->i_depth--;
     assert(fifo->i_size >= block->i_buffer);
     fifo->i_size -= block->i_buffer;
+    if (fifo->p_span == block)
+        fifo->p_span = NULL;
+    if (fifo->i_depth == 0)
+        fifo->i_last_ts = VLC_TS_INVALID;
 
     return block;
 }
@@ -137,11 +190,129 @@ block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
     fifo->pp_last = &fifo->p_first;
     fifo->i_depth = 0;
     fifo->i_size = 0;
+    fifo->i_last_ts = VLC_TS_INVALID;
+    fifo->p_span = NULL;
 
     return block;
 }
 
-block_fifo_t *block_FifoNew( void )
+/**
+ * Queues a chain of blocks into a single producer single consumer FIFO.
+ */
+static void block_FifoPutSPSC(block_fifo_t *fifo, block_t *block)
+{
+    block_t *first = block, *rev = NULL;
+    size_t depth = 0, size = 0;
+
+    if (block == NULL)
+        return;
+
+    /* Reverse the chain so that it can be pushed at once */
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = rev;
+        rev = block;
+        depth++;
+        size += block->i_buffer;
+        block = next;
+    }
+
+    /* Account before publishing so the consumer never goes below zero */
+    atomic_fetch_add_explicit(&fifo->depth, depth, memory_order_relaxed);
+    atomic_fetch_add_explicit(&fifo->size, size, memory_order_relaxed);
+
+    uintptr_t head = atomic_load_explicit(&fifo->stack, memory_order_relaxed);
+    do
+        first->p_next = (block_t *)head;
+    while (!atomic_compare_exchange_weak(&fifo->stack, &head,
+                                         (uintptr_t)rev));
+
+    /* Only bother with the lock if the consumer is (about to be) asleep */
+    if (atomic_exchange(&fifo->parked, false))
+    {
+        vlc_mutex_lock(&fifo->lock);
+        vlc_cond_signal(&fifo->wait);
+        vlc_mutex_unlock(&fifo->lock);
+    }
+}
+
+/**
+ * Moves blocks pushed by the producer to the consumer private list.
+ * @return the first queued block (or NULL if the FIFO is empty)
+ */
+static block_t *block_FifoPeekSPSC(block_fifo_t *fifo)
+{
+    if (fifo->p_first != NULL)
+        return fifo->p_first;
+
+    block_t *block = (block_t *)atomic_exchange_explicit(&fifo->stack, 0,
+                                                        memory_order_acquire);
+    if (block == NULL)
+        return NULL;
+
+    fifo->pp_last = &block->p_next;
+
+    block_t *list = NULL;
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = list;
+        list = block;
+        block = next;
+    }
+    fifo->p_first = list;
+    return list;
+}
+
+static block_t *block_FifoDequeueSPSC(block_fifo_t *fifo)
+{
+    block_t *block = block_FifoPeekSPSC(fifo);
+    if (block == NULL)
+        return NULL;
+
+    fifo->p_first = block->p_next;
+    if (block->p_next == NULL)
+        fifo->pp_last = &fifo->p_first;
+    block->p_next = NULL;
+
+    atomic_fetch_sub_explicit(&fifo->depth, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&fifo->size, block->i_buffer,
+                              memory_order_relaxed);
+    return block;
+}
+
+static void block_FifoParkCleanup(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    atomic_store(&fifo->parked, false);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static block_t *block_FifoGetSPSC(block_fifo_t *fifo)
+{
+    block_t *block = block_FifoDequeueSPSC(fifo);
+    if (block != NULL)
+        return block;
+
+    vlc_mutex_lock(&fifo->lock);
+    atomic_store(&fifo->parked, true);
+    while (atomic_load(&fifo->stack) == 0)
+    {
+        vlc_cleanup_push(block_FifoParkCleanup, fifo);
+        vlc_cond_wait(&fifo->wait, &fifo->lock);
+        vlc_cleanup_pop();
+    }
+    atomic_store(&fifo->parked, false);
+    vlc_mutex_unlock(&fifo->lock);
+
+    return block_FifoDequeueSPSC(fifo);
+}
+
+static block_fifo_t *block_FifoCreate(bool spsc)
 {
     block_fifo_t *p_fifo = malloc( sizeof( block_fifo_t ) );
     if( !p_fifo )
@@ -152,12 +323,30 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
+    p_fifo->i_last_ts = VLC_TS_INVALID;
+    p_fifo->p_span = NULL;
+    p_fifo->spsc = spsc;
+    atomic_init( &p_fifo->stack, 0 );
+    atomic_init( &p_fifo->parked, false );
+    atomic_init( &p_fifo->depth, 0 );
+    atomic_init( &p_fifo->size, 0 );
 
     return p_fifo;
 }
 
+block_fifo_t *block_FifoNew( void )
+{
+    return block_FifoCreate( false );
+}
+
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    return block_FifoCreate( true );
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    block_ChainRelease( (block_t *)atomic_load( &p_fifo->stack ) );
     block_ChainRelease( p_fifo->p_first );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
@@ -168,6 +357,13 @@ void block_FifoEmpty(block_fifo_t *fifo)
 {
     block_t *block;
 
+    if (fifo->spsc)
+    {
+        while ((block = block_FifoDequeueSPSC(fifo)) != NULL)
+            block_Release(block);
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     block = vlc_fifo_DequeueAllUnlocked(fifo);
     vlc_fifo_Unlock(fifo);
@@ -176,6 +372,12 @@ void block_FifoEmpty(block_fifo_t *fifo)
 
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (fifo->spsc)
+    {
+        block_FifoPutSPSC(fifo, block);
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -187,6 +389,9 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (fifo->spsc)
+        return block_FifoGetSPSC(fifo);
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -200,10 +405,31 @@ block_t *block_FifoGet(block_fifo_t *fifo)
     return block;
 }
 
+block_t *block_FifoTryGet(block_fifo_t *fifo)
+{
+    block_t *block;
+
+    if (fifo->spsc)
+        return block_FifoDequeueSPSC(fifo);
+
+    vlc_fifo_Lock(fifo);
+    block = vlc_fifo_DequeueUnlocked(fifo);
+    vlc_fifo_Unlock(fifo);
+
+    return block;
+}
+
 block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if (p_fifo->spsc)
+    {
+        b = block_FifoPeekSPSC(p_fifo);
+        assert(b != NULL);
+        return b;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -217,6 +443,9 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    if (fifo->spsc)
+        return atomic_load_explicit(&fifo->size, memory_order_relaxed);
+
     vlc_mutex_lock (&fifo->lock);
     size = fifo->i_size;
     vlc_mutex_unlock (&fifo->lock);
@@ -228,6 +457,9 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (fifo->spsc)
+        return atomic_load_explicit(&fifo->depth, memory_order_relaxed);
+
     vlc_mutex_lock (&fifo->lock);
     depth = fifo->i_depth;
     vlc_mutex_unlock (&fifo->lock);
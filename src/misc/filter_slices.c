@@ -0,0 +1,282 @@
+/*****************************************************************************
+ * filter_slices.c : video filters slice threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include "libvlc.h"
+
+/* Slices smaller than this are not worth a context switch */
+#define SLICE_MIN_LINES 16
+
+typedef struct filter_slice_job_t filter_slice_job_t;
+
+struct filter_slice_job_t
+{
+    filter_t *filter;
+    filter_slice_cb cb;
+    void *opaque;
+
+    unsigned i_planes;
+    unsigned pi_lines[PICTURE_PLANE_MAX];
+    unsigned pi_slice_lines[PICTURE_PLANE_MAX];
+    unsigned pi_slices[PICTURE_PLANE_MAX];
+
+    unsigned i_slices; /**< Total number of slices */
+    unsigned i_next; /**< Next slice to process */
+    unsigned i_done; /**< Number of processed slices */
+
+    filter_slice_job_t *p_next;
+};
+
+struct filter_slices_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait_job; /**< Signaled when a job is queued */
+    vlc_cond_t wait_done; /**< Signaled when a job is completed */
+    filter_slice_job_t *p_first;
+    filter_slice_job_t **pp_last;
+    bool b_exit;
+
+    unsigned i_threads;
+    vlc_thread_t threads[];
+};
+
+static vlc_mutex_t slices_lock = VLC_STATIC_MUTEX;
+
+/**
+ * Processes the next slice of a queued job.
+ * The slices lock must be held, it is released while processing.
+ */
+static void SliceProcessNext( filter_slices_t *p_slices,
+                              filter_slice_job_t *p_job )
+{
+    unsigned i_slice = p_job->i_next++;
+
+    assert( i_slice < p_job->i_slices );
+    if( p_job->i_next == p_job->i_slices )
+    {
+        /* All the slices are taken: dequeue the job */
+        filter_slice_job_t **pp_job = &p_slices->p_first;
+
+        while( *pp_job != p_job )
+            pp_job = &(*pp_job)->p_next;
+        *pp_job = p_job->p_next;
+        if( p_slices->pp_last == &p_job->p_next )
+            p_slices->pp_last = pp_job;
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+
+    unsigned i_plane = 0;
+    while( i_slice >= p_job->pi_slices[i_plane] )
+        i_slice -= p_job->pi_slices[i_plane++];
+
+    const unsigned i_start = i_slice * p_job->pi_slice_lines[i_plane];
+    const unsigned i_end = __MIN( i_start + p_job->pi_slice_lines[i_plane],
+                                  p_job->pi_lines[i_plane] );
+    p_job->cb( p_job->filter, p_job->opaque, i_plane, i_start, i_end );
+
+    vlc_mutex_lock( &p_slices->lock );
+    if( ++p_job->i_done == p_job->i_slices )
+        vlc_cond_broadcast( &p_slices->wait_done );
+}
+
+static void *SliceThread( void *data )
+{
+    filter_slices_t *p_slices = data;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( p_slices->p_first == NULL && !p_slices->b_exit )
+            vlc_cond_wait( &p_slices->wait_job, &p_slices->lock );
+        if( p_slices->b_exit )
+            break;
+        SliceProcessNext( p_slices, p_slices->p_first );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+static filter_slices_t *SlicesCreate( vlc_object_t *obj, unsigned i_threads )
+{
+    filter_slices_t *p_slices =
+        malloc( sizeof(*p_slices) + i_threads * sizeof(vlc_thread_t) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait_job );
+    vlc_cond_init( &p_slices->wait_done );
+    p_slices->p_first = NULL;
+    p_slices->pp_last = &p_slices->p_first;
+    p_slices->b_exit = false;
+    p_slices->i_threads = 0;
+
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        if( vlc_clone( &p_slices->threads[i], SliceThread, p_slices,
+                       VLC_THREAD_PRIORITY_LOW ) )
+            break;
+        p_slices->i_threads++;
+    }
+
+    if( p_slices->i_threads == 0 )
+    {
+        vlc_cond_destroy( &p_slices->wait_done );
+        vlc_cond_destroy( &p_slices->wait_job );
+        vlc_mutex_destroy( &p_slices->lock );
+        free( p_slices );
+        return NULL;
+    }
+    msg_Dbg( obj, "using %u video filters slice threads",
+             p_slices->i_threads );
+    return p_slices;
+}
+
+/**
+ * Returns the slice threads of the instance, creating them if needed.
+ */
+static filter_slices_t *SlicesGet( vlc_object_t *obj )
+{
+    libvlc_priv_t *priv = libvlc_priv( obj->obj.libvlc );
+
+    vlc_mutex_lock( &slices_lock );
+    if( priv->slices == NULL && !priv->b_slices_disabled )
+    {
+        int i_threads = var_InheritInteger( obj, "filter-threads" );
+        if( i_threads <= 0 )
+            i_threads = vlc_GetCPUCount();
+
+        /* The calling thread processes slices too */
+        if( i_threads > 1 )
+            priv->slices = SlicesCreate( obj, i_threads - 1 );
+        priv->b_slices_disabled = priv->slices == NULL;
+    }
+    vlc_mutex_unlock( &slices_lock );
+    return priv->slices;
+}
+
+void filter_SlicesDestroy( libvlc_int_t *p_libvlc )
+{
+    filter_slices_t *p_slices = libvlc_priv( p_libvlc )->slices;
+
+    if( p_slices == NULL )
+        return;
+
+    vlc_mutex_lock( &p_slices->lock );
+    assert( p_slices->p_first == NULL );
+    p_slices->b_exit = true;
+    vlc_cond_broadcast( &p_slices->wait_job );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->i_threads; i++ )
+        vlc_join( p_slices->threads[i], NULL );
+
+    vlc_cond_destroy( &p_slices->wait_done );
+    vlc_cond_destroy( &p_slices->wait_job );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+}
+
+unsigned filter_GetSliceThreads( filter_t *p_filter )
+{
+    filter_slices_t *p_slices = SlicesGet( VLC_OBJECT(p_filter) );
+
+    /* The calling thread processes slices too */
+    return (p_slices != NULL) ? p_slices->i_threads + 1 : 1;
+}
+
+void filter_ExecuteSlices( filter_t *p_filter, filter_slice_cb cb,
+                           void *opaque, const picture_t *p_pic,
+                           unsigned i_planes )
+{
+    filter_slices_t *p_slices = SlicesGet( VLC_OBJECT(p_filter) );
+    filter_slice_job_t job;
+
+    assert( i_planes <= (unsigned)p_pic->i_planes );
+
+    job.filter = p_filter;
+    job.cb = cb;
+    job.opaque = opaque;
+    job.i_planes = i_planes;
+    job.i_slices = 0;
+    job.i_next = 0;
+    job.i_done = 0;
+    job.p_next = NULL;
+
+    for( unsigned i = 0; i < i_planes; i++ )
+    {
+        const unsigned i_lines = p_pic->p[i].i_visible_lines;
+        unsigned i_count = 1;
+
+        /* A few slices per thread to balance the load */
+        if( p_slices != NULL )
+            i_count = __MAX( __MIN( 4 * (p_slices->i_threads + 1),
+                                    i_lines / SLICE_MIN_LINES ), 1 );
+
+        unsigned i_slice_lines = (i_lines + i_count - 1) / i_count;
+        i_slice_lines = (i_slice_lines + 1) & ~1;
+
+        job.pi_lines[i] = i_lines;
+        job.pi_slice_lines[i] = __MAX( i_slice_lines, 2 );
+        job.pi_slices[i] = (i_lines + job.pi_slice_lines[i] - 1)
+                         / job.pi_slice_lines[i];
+        job.i_slices += job.pi_slices[i];
+    }
+
+    if( job.i_slices == 0 )
+        return;
+
+    if( p_slices == NULL || job.i_slices == 1 )
+    {
+        for( unsigned i = 0; i < i_planes; i++ )
+            for( unsigned y = 0; y < job.pi_lines[i];
+                 y += job.pi_slice_lines[i] )
+                cb( p_filter, opaque, i, y,
+                    __MIN( y + job.pi_slice_lines[i], job.pi_lines[i] ) );
+        return;
+    }
+
+    /* The job lives on the stack: do not let the caller be cancelled */
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_slices->lock );
+    *p_slices->pp_last = &job;
+    p_slices->pp_last = &job.p_next;
+    vlc_cond_broadcast( &p_slices->wait_job );
+
+    /* Help with our own slices until they are all taken. Only the slice
+     * threads run the callbacks of other filters (see
+     * filter_GetSliceThreads()). */
+    while( job.i_next < job.i_slices )
+        SliceProcessNext( p_slices, &job );
+    while( job.i_done < job.i_slices )
+        vlc_cond_wait( &p_slices->wait_done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    vlc_restorecancel( canc );
+}
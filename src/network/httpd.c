@@ -40,6 +40,7 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -49,11 +50,16 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#if defined(HAVE_EPOLL_CREATE1) && !defined(__ANDROID__)
+# include <sys/epoll.h>
+# define HTTPD_EPOLL 1
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
 #else
 #   include <sys/socket.h>
+#   include <sys/uio.h>
 #endif
 
 #if defined(_WIN32)
@@ -63,10 +69,52 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of stream chunks sent at once to a client */
+#define HTTPD_CL_CHUNKS 16
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+/* immutable piece of stream data, shared by all clients of the stream */
+typedef struct httpd_chunk_t httpd_chunk_t;
+struct httpd_chunk_t
+{
+    atomic_uint    refs;
+    int64_t        i_pos;   /* absolute position of the first byte */
+    size_t         i_data;
+    httpd_chunk_t *next;    /* newer chunk, protected by the stream lock */
+    uint8_t        p_data[];
+};
+
+static httpd_chunk_t *httpd_ChunkHold(httpd_chunk_t *chunk)
+{
+    atomic_fetch_add_explicit(&chunk->refs, 1, memory_order_relaxed);
+    return chunk;
+}
+
+static void httpd_ChunkRelease(httpd_chunk_t *chunk)
+{
+    if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1)
+        free(chunk);
+}
+
+/* each worker thread serves its own set of clients */
+typedef struct
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+
+    int            i_client;
+    httpd_client_t **client;
+
+#ifdef HTTPD_EPOLL
+    int          epfd; /* -1 if not available, poll() is used instead */
+    mtime_t      i_scan_date; /* next scan of all clients */
+#endif
+} httpd_worker_t;
+
+/* each host run in one or more worker threads */
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -79,7 +127,9 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
+    unsigned        i_worker;
+    httpd_worker_t *workers;
+
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -90,9 +140,6 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
-
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -146,6 +193,7 @@ struct httpd_client_t
     int     i_ref;
 
     int     fd;
+    short   i_events; /* events currently watched by the worker */
 
     bool    b_stream_mode;
     uint8_t i_state;
@@ -158,6 +206,13 @@ struct httpd_client_t
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* shared stream data being sent instead of p_buffer, if any */
+    httpd_chunk_t *chunks[HTTPD_CL_CHUNKS];
+    unsigned       i_chunks;
+    size_t         i_chunk_offset; /* start of the data in the first chunk */
+    /* last chunk sent (stream mode): where to resume from */
+    httpd_chunk_t *p_cursor;
+
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
      * last keyframe the stream saw before this client connected.
@@ -611,9 +666,11 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* backlog of shared chunks, from oldest to newest */
+    httpd_chunk_t *p_first;
+    httpd_chunk_t *p_last;
+    int64_t     i_backlog;          /* bytes in the backlog */
+    int         i_buffer_size;      /* backlog size limit */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -632,34 +689,48 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        vlc_mutex_lock(&stream->lock);
 
         if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+            goto wait;              /* wait, no data available */
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
             if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
                 /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+                goto wait;
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        if (answer->i_body_offset < stream->p_first->i_pos)
             answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        /* Resume from the last chunk sent, as long as it is in the backlog */
+        httpd_chunk_t *chunk = cl->p_cursor;
+        if (chunk == NULL || chunk->i_pos < stream->p_first->i_pos
+         || chunk->i_pos > answer->i_body_offset)
+            chunk = stream->p_first;
+        while (chunk->i_pos + (int64_t)chunk->i_data <= answer->i_body_offset)
+            chunk = chunk->next;
+
+        /* Reference the data to send, no copying */
+        int64_t i_write = 0;
+
+        assert(cl->i_chunks == 0);
+        cl->i_chunk_offset = answer->i_body_offset - chunk->i_pos;
+        do {
+            cl->chunks[cl->i_chunks++] = httpd_ChunkHold(chunk);
+            i_write += chunk->i_data;
+            chunk = chunk->next;
+        } while (chunk != NULL && cl->i_chunks < HTTPD_CL_CHUNKS);
+        i_write -= cl->i_chunk_offset;
+
+        if (cl->p_cursor != NULL)
+            httpd_ChunkRelease(cl->p_cursor);
+        cl->p_cursor = httpd_ChunkHold(cl->chunks[cl->i_chunks - 1]);
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
@@ -667,12 +738,14 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         answer->i_type   = HTTPD_MSG_ANSWER;
 
         answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        answer->p_body = NULL; /* sent from the chunks */
 
         answer->i_body_offset += i_write;
 
         return VLC_SUCCESS;
+wait:
+        vlc_mutex_unlock(&stream->lock);
+        return VLC_EGENERIC;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -696,6 +769,11 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
             }
         vlc_mutex_unlock(&stream->lock);
 
+        if (cl->p_cursor != NULL) {
+            httpd_ChunkRelease(cl->p_cursor);
+            cl->p_cursor = NULL;
+        }
+
         if (query->i_type != HTTPD_MSG_HEAD) {
             cl->b_stream_mode = true;
             vlc_mutex_lock(&stream->lock);
@@ -766,7 +844,9 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->p_first = NULL;
+    stream->p_last = NULL;
+    stream->i_backlog = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -804,20 +884,35 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    if (i_data <= 0)
+        return;
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+    httpd_chunk_t *chunk = malloc(sizeof (*chunk) + i_data);
+    if (unlikely(chunk == NULL))
+        return;
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
+    atomic_init(&chunk->refs, 1);
+    chunk->i_pos = stream->i_buffer_pos;
+    chunk->i_data = i_data;
+    chunk->next = NULL;
+    memcpy(chunk->p_data, p_data, i_data);
 
+    if (stream->p_last != NULL)
+        stream->p_last->next = chunk;
+    else
+        stream->p_first = chunk;
+    stream->p_last = chunk;
+    stream->i_backlog += i_data;
     stream->i_buffer_pos += i_data;
+
+    /* Drop the oldest chunks; clients still sending them hold a reference */
+    while (stream->i_backlog - (int64_t)stream->p_first->i_data
+                                                    >= stream->i_buffer_size) {
+        chunk = stream->p_first;
+        stream->p_first = chunk->next;
+        stream->i_backlog -= chunk->i_data;
+        httpd_ChunkRelease(chunk);
+    }
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -852,7 +947,12 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    while (stream->p_first != NULL) {
+        httpd_chunk_t *chunk = stream->p_first;
+
+        stream->p_first = chunk->next;
+        httpd_ChunkRelease(chunk);
+    }
     free(stream);
 }
 
@@ -906,6 +1006,59 @@ static struct httpd
     int          i_host;
 } httpd = { VLC_STATIC_MUTEX, NULL, 0 };
 
+static int httpd_WorkerInit(httpd_worker_t *worker, httpd_host_t *host)
+{
+    worker->host = host;
+    worker->i_client = 0;
+    worker->client = NULL;
+    vlc_mutex_init(&worker->lock);
+
+#ifdef HTTPD_EPOLL
+    worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+    worker->i_scan_date = 0;
+    for (unsigned i = 0; worker->epfd != -1 && i < host->nfd; i++) {
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.ptr = &host->fds[i],
+        };
+# ifdef EPOLLEXCLUSIVE
+        ev.events |= EPOLLEXCLUSIVE; /* avoid waking up every worker */
+# endif
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev)) {
+            close(worker->epfd);
+            worker->epfd = -1;
+        }
+    }
+    if (worker->epfd == -1)
+        msg_Warn(host, "cannot use epoll: %s", vlc_strerror_c(errno));
+#endif
+
+    if (vlc_clone(&worker->thread, httpd_HostThread, worker,
+                  VLC_THREAD_PRIORITY_LOW)) {
+#ifdef HTTPD_EPOLL
+        if (worker->epfd != -1)
+            close(worker->epfd);
+#endif
+        vlc_mutex_destroy(&worker->lock);
+        return -1;
+    }
+    return 0;
+}
+
+static void httpd_WorkerClean(httpd_worker_t *worker)
+{
+    for (int i = 0; i < worker->i_client; i++) {
+        msg_Warn(worker->host, "client still connected");
+        httpd_ClientDestroy(worker->client[i]);
+    }
+    TAB_CLEAN(worker->i_client, worker->client);
+#ifdef HTTPD_EPOLL
+    if (worker->epfd != -1)
+        close(worker->epfd);
+#endif
+    vlc_mutex_destroy(&worker->lock);
+}
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
@@ -914,6 +1067,13 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     httpd_host_t *host;
     char *hostname = var_InheritString(p_this, hostvar);
     unsigned port = var_InheritInteger(p_this, portvar);
+    int64_t threads = var_InheritInteger(p_this, "http-threads");
+
+#if !defined(HTTPD_EPOLL) || !defined(EPOLLEXCLUSIVE)
+    threads = 1; /* every worker would wake up for every connection */
+#endif
+    if (threads < 1)
+        threads = 1;
 
     vlc_url_t url;
     vlc_UrlParse(&url, hostname);
@@ -959,6 +1119,7 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+    host->workers = NULL;
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -970,17 +1131,31 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    /* create the threads */
+    host->i_worker = 0;
+    host->workers = malloc(threads * sizeof (*host->workers));
+    if (unlikely(host->workers == NULL))
         goto error;
+
+    while (host->i_worker < threads) {
+        httpd_worker_t *worker = &host->workers[host->i_worker];
+
+        if (httpd_WorkerInit(worker, host)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            break;
+        }
+        host->i_worker++;
+#ifdef HTTPD_EPOLL
+        if (worker->epfd == -1)
+            break; /* poll() would wake every worker up, use only one */
+#endif
     }
 
+    if (host->i_worker == 0)
+        goto error;
+
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
     vlc_mutex_unlock(&httpd.mutex);
@@ -993,6 +1168,7 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        free(host->workers);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1024,19 +1200,19 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_cancel(host->workers[i].thread);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_join(host->workers[i].thread, NULL);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(host->client[i]);
-    }
-    TAB_CLEAN(host->i_client, host->client);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        httpd_WorkerClean(&host->workers[i]);
+    free(host->workers);
 
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
@@ -1075,7 +1251,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     TAB_APPEND(host->i_url, host->url, url);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1100,26 +1276,32 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
+    vlc_mutex_unlock(&host->lock);
 
-    vlc_mutex_destroy(&url->lock);
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    /* The workers destroy dead clients on their next iteration */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *worker = &host->workers[i];
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
+        vlc_mutex_lock(&worker->lock);
+        for (int j = 0; j < worker->i_client; j++) {
+            httpd_client_t *client = worker->client[j];
 
-        if (client->url != url)
-            continue;
+            if (client->url != url)
+                continue;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        TAB_REMOVE(host->i_client, host->client, client);
-        httpd_ClientDestroy(client);
-        i--;
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+        }
+        vlc_mutex_unlock(&worker->lock);
     }
+
+    vlc_mutex_destroy(&url->lock);
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1201,6 +1383,8 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->i_chunks = 0;
+    cl->p_cursor = NULL;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1216,8 +1400,19 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(cl->fd, ip, port) ? NULL : ip;
 }
 
+static void httpd_ClientReleaseChunks(httpd_client_t *cl)
+{
+    for (unsigned i = 0; i < cl->i_chunks; i++)
+        httpd_ChunkRelease(cl->chunks[i]);
+    cl->i_chunks = 0;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
+    httpd_ClientReleaseChunks(cl);
+    if (cl->p_cursor != NULL)
+        httpd_ChunkRelease(cl->p_cursor);
+
     if (cl->p_tls != NULL)
         vlc_tls_Close(cl->p_tls);
     else
@@ -1238,6 +1433,7 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
 
     cl->i_ref   = 0;
     cl->fd      = fd;
+    cl->i_events = 0;
     cl->url     = NULL;
     cl->p_tls = p_tls;
 
@@ -1277,6 +1473,44 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
 }
 
 
+/* sends the remaining shared stream data with a single gathering write */
+static
+ssize_t httpd_ClientSendChunks (httpd_client_t *cl)
+{
+    struct iovec iov[HTTPD_CL_CHUNKS];
+    size_t skip = cl->i_chunk_offset + cl->i_buffer;
+    unsigned count = 0;
+    ssize_t val;
+
+    for (unsigned i = 0; i < cl->i_chunks; i++) {
+        httpd_chunk_t *chunk = cl->chunks[i];
+
+        if (skip >= chunk->i_data) {
+            skip -= chunk->i_data;
+            continue;
+        }
+        iov[count].iov_base = chunk->p_data + skip;
+        iov[count].iov_len = chunk->i_data - skip;
+        count++;
+        skip = 0;
+    }
+
+    do
+        if (cl->p_tls != NULL)
+            val = cl->p_tls->writev(cl->p_tls, iov, count);
+        else
+        {
+            struct msghdr msg = {
+                .msg_iov = iov,
+                .msg_iovlen = count,
+            };
+
+            val = sendmsg(cl->fd, &msg, MSG_NOSIGNAL);
+        }
+    while (val == -1 && errno == EINTR);
+    return val;
+}
+
 static const struct
 {
     const char name[16];
@@ -1580,6 +1814,18 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
+/* calls the URL handler for more body data. Handlers are not reentrant, so
+ * the callbacks of a host are serialized, even with several worker threads. */
+static void httpd_ClientCatch(httpd_client_t *cl)
+{
+    httpd_url_t *url = cl->url;
+    int i_msg = cl->query.i_type;
+
+    vlc_mutex_lock(&url->host->lock);
+    url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, &cl->answer, &cl->query);
+    vlc_mutex_unlock(&url->host->lock);
+}
+
 static void httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
@@ -1615,22 +1861,25 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
+    if (cl->i_chunks > 0)
+        i_len = httpd_ClientSendChunks(cl);
+    else
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
     if (i_len >= 0) {
         cl->i_buffer += i_len;
 
         if (cl->i_buffer >= cl->i_buffer_size) {
+            httpd_ClientReleaseChunks(cl);
+
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
-                int     i_msg = cl->query.i_type;
                 int64_t i_offset = cl->answer.i_body_offset;
 
                 httpd_MsgClean(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
+                httpd_ClientCatch(cl);
             }
 
             if (cl->answer.i_body > 0) {
@@ -1709,277 +1958,478 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* updates the events watched for a client, or stops watching it */
+static void httpd_ClientWatch(httpd_worker_t *worker, httpd_client_t *cl,
+                              short events)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+#ifdef HTTPD_EPOLL
+    if (worker->epfd != -1 && cl->i_events != events) {
+        struct epoll_event ev = {
+            .events = ((events & POLLIN) ? EPOLLIN : 0)
+                    | ((events & POLLOUT) ? EPOLLOUT : 0),
+            .data.ptr = cl,
+        };
+        int op = (events == 0) ? EPOLL_CTL_DEL
+               : (cl->i_events == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+
+        if (epoll_ctl(worker->epfd, op, cl->fd, &ev) == 0)
+            cl->i_events = events;
+        else if (events != 0)
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        return;
     }
+#endif
+    VLC_UNUSED(worker);
+    cl->i_events = events;
+}
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
+static void httpd_ClientEvent(httpd_host_t *host, httpd_client_t *cl,
+                              mtime_t now)
+{
+    cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
     }
+}
 
-    mtime_t now = mdate();
-    bool b_low_delay = false;
+/* accepts a new connection on a listening socket */
+static httpd_client_t *httpd_WorkerAccept(httpd_worker_t *worker, int fd,
+                                          mtime_t now)
+{
+    httpd_host_t *host = worker->host;
+    httpd_client_t *cl;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
-            i_client--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return NULL;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+    vlc_tls_t *p_tls;
 
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+        p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
+    }
+    else
+        p_tls = NULL;
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+    cl = httpd_ClientNew(fd, p_tls, now);
+    if (unlikely(cl == NULL)) {
+        if (p_tls != NULL)
+            vlc_tls_Close(p_tls);
+        else
+            net_Close(fd);
+        return NULL;
+    }
+
+    TAB_APPEND(worker->i_client, worker->client, cl);
+    return cl;
+}
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+/* runs one step of the client state machine, returns the events to poll */
+static short httpd_ClientStep(httpd_host_t *host, httpd_client_t *cl)
+{
+    int64_t i_offset;
+    short events = 0;
 
-                httpd_MsgInit(answer);
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
+
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
                         break;
 
-                    case HTTPD_MSG_OPTIONS:
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
+                        cl->i_state = HTTPD_CLIENT_DEAD;
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
-                        }
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
                         cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+                    }
+                    break;
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                default: {
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+                    /* Search the url and trigger callbacks */
+                    vlc_mutex_lock(&host->lock);
+                    for (int i = 0; i < host->i_url; i++) {
+                        httpd_url_t *url = host->url[i];
+
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
                         if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                break;
-            }
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
+
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
-                    const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if (psz_connection) {
-                        b_connection = (strcasecmp(psz_connection, "Close") == 0);
-                        b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
                     }
+                    vlc_mutex_unlock(&host->lock);
 
-                    if (psz_query)
-                        b_query = (strcasecmp(psz_query, "Close") == 0);
-
-                    if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
-                                ((cl->query.i_version == 0 && b_keepalive) ||
-                                  (cl->query.i_version == 1 && !b_connection))) ||
-                            ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
-                              !b_query && !b_connection)) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                    }
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+            }
+            break;
+        }
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
+                const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
+                bool b_connection = false;
+                bool b_keepalive = false;
+                bool b_query = false;
+
+                cl->url = NULL;
+                if (psz_connection) {
+                    b_connection = (strcasecmp(psz_connection, "Close") == 0);
+                    b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
                 }
-                break;
 
-            case HTTPD_CLIENT_WAITING:
+                if (psz_query)
+                    b_query = (strcasecmp(psz_query, "Close") == 0);
+
+                if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
+                            ((cl->query.i_version == 0 && b_keepalive) ||
+                              (cl->query.i_version == 1 && !b_connection))) ||
+                        ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
+                          !b_query && !b_connection)) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
+
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    cl->p_buffer = xmalloc(cl->i_buffer_size);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
                 i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+                httpd_MsgClean(&cl->answer);
 
-                httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+                cl->i_state = HTTPD_CLIENT_WAITING;
+            }
+            break;
+
+        case HTTPD_CLIENT_WAITING:
+            i_offset = cl->answer.i_body_offset;
+
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
+
+            httpd_ClientCatch(cl);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
+    return events;
+}
+
+/* runs the client state machine until it waits for I/O, a callback or death */
+static short httpd_ClientUpdate(httpd_host_t *host, httpd_client_t *cl)
+{
+    short events;
+
+    do
+        events = httpd_ClientStep(host, cl);
+    while (events == 0 && cl->i_state != HTTPD_CLIENT_WAITING
+                       && cl->i_state != HTTPD_CLIENT_DEAD);
+    return events;
+}
+
+/* destroys a client if it is finished or timed out */
+static bool httpd_WorkerReap(httpd_worker_t *worker, httpd_client_t *cl,
+                             mtime_t now)
+{
+    if (!(cl->i_ref < 0 || (cl->i_ref == 0 &&
+                (cl->i_state == HTTPD_CLIENT_DEAD ||
+                  (cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now)))))
+        return false;
+
+    TAB_REMOVE(worker->i_client, worker->client, cl);
+    httpd_ClientWatch(worker, cl, 0);
+    httpd_ClientDestroy(cl);
+    return true;
+}
+
+#ifdef HTTPD_EPOLL
+/* Only the clients with events are served on wake-up. All clients are scanned
+ * periodically for timeouts, waiting streams and deletion of their URL. */
+static void httpd_WorkerEpoll(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+    struct epoll_event evs[64];
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+
+    mtime_t now = mdate();
+
+    if (now >= worker->i_scan_date) {
+        bool b_low_delay = false;
+
+        for (int i_client = 0; i_client < worker->i_client; i_client++) {
+            httpd_client_t *cl = worker->client[i_client];
+
+            if (httpd_WorkerReap(worker, cl, now)) {
+                i_client--;
+                continue;
+            }
+
+            short events = httpd_ClientUpdate(host, cl);
+            if (events == 0)
+                b_low_delay = true;
+            httpd_ClientWatch(worker, cl, events);
         }
 
-        if (pufd->events != 0)
-            nfd++;
-        else
-            b_low_delay = true;
+        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+        worker->i_scan_date = now + (b_low_delay ? 20000 : CLOCK_FREQ);
     }
-    vlc_mutex_unlock(&host->lock);
+
+    int timeout = (worker->i_scan_date - now + 999) / 1000;
+
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+    int ret = epoll_wait(worker->epfd, evs, ARRAY_SIZE(evs), timeout);
+    if (ret == -1) {
+        if (errno != EINTR) {
+            /* Kernel on low memory or a bug: pace */
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+            msleep(100000);
+        }
+        return;
+    }
 
     canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+    now = mdate();
+
+    /* Clients are only destroyed by this thread, one per event at most */
+    for (int i = 0; i < ret; i++) {
+        void *ptr = evs[i].data.ptr;
+        httpd_client_t *cl;
+
+        if (ptr >= (void *)host->fds
+         && ptr < (void *)(host->fds + host->nfd)) {
+            cl = httpd_WorkerAccept(worker, *(int *)ptr, now);
+            if (cl == NULL)
+                continue;
+        } else {
+            cl = ptr;
+            httpd_ClientEvent(host, cl, now);
+        }
+
+        short events = httpd_ClientUpdate(host, cl);
+        if (httpd_WorkerReap(worker, cl, now))
+            continue;
+        if (events == 0 && worker->i_scan_date > now + 20000)
+            worker->i_scan_date = now + 20000;
+        httpd_ClientWatch(worker, cl, events);
+    }
+
+    vlc_mutex_unlock(&worker->lock);
+    vlc_restorecancel(canc);
+}
+#endif
+
+static void httpdLoop(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+    unsigned nfd;
+
+    /* add all socket that should be read/write and close dead connection */
     vlc_mutex_lock(&host->lock);
-    switch(ret) {
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+    vlc_mutex_unlock(&host->lock);
+
+#ifdef HTTPD_EPOLL
+    if (worker->epfd != -1) {
+        httpd_WorkerEpoll(worker);
+        return;
+    }
+#endif
+
+    vlc_mutex_lock(&worker->lock);
+
+    struct pollfd ufd[host->nfd + worker->i_client];
+    unsigned polled;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+
+    mtime_t now = mdate();
+    bool b_low_delay = false;
+
+    int canc = vlc_savecancel();
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
+
+        if (httpd_WorkerReap(worker, cl, now)) {
+            i_client--;
+            continue;
+        }
+
+        short events = httpd_ClientUpdate(host, cl);
+
+        if (events == 0)
+            b_low_delay = true;
+        else {
+            assert(nfd < sizeof (ufd) / sizeof (ufd[0]));
+            ufd[nfd].fd = cl->fd;
+            ufd[nfd].events = events;
+            ufd[nfd].revents = 0;
+            nfd++;
+        }
+    }
+    polled = nfd;
+    vlc_mutex_unlock(&worker->lock);
+    vlc_restorecancel(canc);
+
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+    switch (poll(ufd, nfd, b_low_delay ? 20 : -1)) {
         case -1:
             if (errno != EINTR) {
                 /* Kernel on low memory or a bug: pace */
@@ -1987,82 +2437,51 @@ static void httpdLoop(httpd_host_t *host)
                 msleep(100000);
             }
         case 0:
-            vlc_restorecancel(canc);
             return;
     }
 
-    /* Handle client sockets */
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
     now = mdate();
+
+    /* Handle client sockets */
     nfd = host->nfd;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
         const struct pollfd *pufd = &ufd[nfd];
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
-
+        if (nfd >= polled)
+            break;
         if (cl->fd != pufd->fd)
             continue; // we were not waiting for this client
         ++nfd;
         if (pufd->revents == 0)
             continue; // no event received
 
-        cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        httpd_ClientEvent(host, cl, now);
     }
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
-
-        assert (fd == host->fds[nfd]);
+        assert (ufd[nfd].fd == host->fds[nfd]);
 
         if (ufd[nfd].revents == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
-
-        vlc_tls_t *p_tls;
-
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-
-            p_tls = vlc_tls_ServerSessionCreate(host->p_tls, fd, alpn);
-        }
-        else
-            p_tls = NULL;
-
-        cl = httpd_ClientNew(fd, p_tls, now);
-
-        TAB_APPEND(host->i_client, host->client, cl);
+        httpd_WorkerAccept(worker, ufd[nfd].fd, now);
     }
 
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *worker = data;
 
-    vlc_mutex_lock(&host->lock);
-    while (host->i_ref > 0)
-        httpdLoop(host);
-    vlc_mutex_unlock(&host->lock);
+    for (;;)
+        httpdLoop(worker);
     return NULL;
 }
 
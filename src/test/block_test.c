@@ -86,11 +86,132 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void *test_block_Thread (void *data)
+{
+    block_t **blocks = data;
+
+    for (unsigned i = 0; i < 16; i++)
+    {
+        blocks[i] = block_Alloc (1316);
+        assert (blocks[i] != NULL);
+        memset (blocks[i]->p_buffer, i, 1316);
+    }
+    return NULL;
+}
+
+static void test_block_Cache (void)
+{
+    block_cache_stats_t before, after;
+    block_t *block;
+    uint8_t *buf;
+
+    block_GetCacheStats (&before);
+
+    /* Same thread: the released block is recycled */
+    block = block_Alloc (1316);
+    assert (block != NULL);
+    buf = block->p_start;
+    block_Release (block);
+    block = block_Alloc (1400);
+    assert (block != NULL);
+    assert (block->p_start == buf);
+    assert (block->i_buffer == 1400);
+    assert (((uintptr_t)block->p_buffer % 32) == 0);
+    block_Release (block);
+
+    block_GetCacheStats (&after);
+    assert (after.hits >= before.hits + 1);
+
+    /* Other threads: blocks are returned to their (exited) owner */
+    block_t *blocks[16];
+    vlc_thread_t th;
+
+    before = after;
+    if (vlc_clone (&th, test_block_Thread, blocks, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+    vlc_join (th, NULL);
+
+    for (unsigned i = 0; i < 16; i++)
+    {
+        assert (blocks[i]->p_buffer[1315] == i);
+        block_Release (blocks[i]);
+    }
+
+    block_GetCacheStats (&after);
+    assert (after.misses >= before.misses + 16);
+    assert (after.remote_frees >= before.remote_frees + 16);
+
+    /* Large blocks bypass the cache */
+    block = block_Alloc (1 << 20);
+    assert (block != NULL);
+    block_Release (block);
+}
+
+#define FIFO_BLOCKS 100000
+
+static void *test_fifo_Thread (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i += 2)
+    {   /* queue chains of two blocks */
+        block_t *a = block_Alloc (i % 64);
+        block_t *b = block_Alloc ((i + 1) % 64);
+        assert (a != NULL && b != NULL);
+        a->i_dts = i;
+        b->i_dts = i + 1;
+        a->p_next = b;
+        block_FifoPut (fifo, a);
+    }
+    return NULL;
+}
+
+static void test_block_FifoSPSC (void)
+{
+    block_fifo_t *fifo = block_FifoNewSPSC ();
+    vlc_thread_t th;
+    block_t *block;
+
+    assert (fifo != NULL);
+    assert (block_FifoTryGet (fifo) == NULL);
+
+    block = block_Alloc (10);
+    block_FifoPut (fifo, block);
+    assert (block_FifoShow (fifo) == block);
+    assert (block_FifoGet (fifo) == block);
+    assert (block->p_next == NULL);
+    block_Release (block);
+
+    if (vlc_clone (&th, test_fifo_Thread, fifo, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block = block_FifoGet (fifo);
+        assert (block->i_dts == (mtime_t)i);
+        assert (block->i_buffer == i % 64);
+        assert (block->p_next == NULL);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+
+    assert (block_FifoTryGet (fifo) == NULL);
+
+    /* Leftovers are accounted for and released with the FIFO */
+    block_FifoPut (fifo, block_Alloc (100));
+    block_FifoPut (fifo, block_Alloc (200));
+    assert (block_FifoShow (fifo)->i_buffer == 100);
+    block_FifoPut (fifo, block_Alloc (300));
+    block_FifoRelease (fifo);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Cache ();
+    test_block_FifoSPSC ();
     return 0;
 }
 
@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * pcm_convert.c: PCM conversion kernels tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../simd.h"
+#include "../modules/audio_filter/converter/pcm_convert.h"
+
+typedef struct
+{
+    void (*s16_fl32)(float *, const int16_t *, size_t);
+    void (*s16_s32)(int32_t *, const int16_t *, size_t);
+    void (*fl32_s16)(int16_t *, const float *, size_t);
+    void (*fl32_s32)(int32_t *, const float *, size_t);
+    void (*s32_s16)(int16_t *, const int32_t *, size_t);
+    void (*s32_fl32)(float *, const int32_t *, size_t);
+} pcm_kernels_t;
+
+#define KERNELS(suffix) { s16_fl32_##suffix, s16_s32_##suffix, \
+    fl32_s16_##suffix, fl32_s32_##suffix, s32_s16_##suffix, s32_fl32_##suffix }
+
+static const struct
+{
+    const char *psz_name;
+    pcm_kernels_t k;
+    bool (*pf_usable)(void);
+} impls[] = {
+    { "C", KERNELS(C), NULL },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", KERNELS(SSE2), cpu_sse2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", KERNELS(AVX2), cpu_avx2 },
+#endif
+#ifdef PCM_CONVERT_NEON
+    { "NEON", KERNELS(NEON), cpu_neon },
+#endif
+};
+
+/* Random samples, with halfway cases and out of range values */
+static float rand_sample(void)
+{
+    switch (rand() % 8)
+    {
+        case 0:
+            return (rand() % 65536 - 32768 + .5f) / 32768.f;
+        case 1:
+            return (rand() % 65536 - 32768 + .5f) / 2147483648.f;
+        case 2:
+            return (rand() / (float)RAND_MAX - .5f) * 4.f;
+        case 3:
+        {
+            static const float specials[] = {
+                0.f, -0.f, 1.f, -1.f, 1.00001f, -1.00001f, 32767.f / 32768.f,
+                32767.5f / 32768.f, -32768.5f / 32768.f, 1e-30f, -1e-30f,
+                1e30f, -1e30f,
+            };
+            return specials[rand() % ARRAY_SIZE(specials)];
+        }
+        default:
+            return rand() / (float)RAND_MAX * 2.f - 1.f;
+    }
+}
+
+#define CHECK(conv, dst_t, src, n) \
+    do { \
+        dst_t ref[n], out[n]; \
+        impls[0].k.conv(ref, src, n); \
+        for (unsigned i = 1; i < ARRAY_SIZE(impls); i++) \
+        { \
+            if (!cpu_usable(impls[i].pf_usable)) \
+                continue; \
+            impls[i].k.conv(out, src, n); \
+            if (memcmp(ref, out, sizeof(ref))) \
+            { \
+                fprintf(stderr, "%s: " #conv " %zu mismatch\n", \
+                        impls[i].psz_name, (size_t)n); \
+                abort(); \
+            } \
+        } \
+    } while (0)
+
+static void check(size_t n)
+{
+    int16_t s16[n];
+    int32_t s32[n];
+    float fl32[n];
+
+    for (size_t i = 0; i < n; i++)
+    {
+        s16[i] = rand();
+        s32[i] = (uint32_t)rand() << 16 ^ rand();
+        fl32[i] = rand_sample();
+    }
+
+    CHECK(s16_fl32, float, s16, n);
+    CHECK(s16_s32, int32_t, s16, n);
+    CHECK(fl32_s16, int16_t, fl32, n);
+    CHECK(fl32_s32, int32_t, fl32, n);
+    CHECK(s32_s16, int16_t, s32, n);
+    CHECK(s32_fl32, float, s32, n);
+
+    /* The narrowing conversions are done in place */
+    void *buf = malloc(n * 4);
+    assert(buf != NULL);
+
+    for (unsigned i = 1; i < ARRAY_SIZE(impls); i++)
+    {
+        if (!cpu_usable(impls[i].pf_usable))
+            continue;
+
+        int16_t ref16[n];
+        int32_t ref32[n];
+
+        memcpy(buf, fl32, sizeof(fl32));
+        impls[0].k.fl32_s16(ref16, fl32, n);
+        impls[i].k.fl32_s16(buf, buf, n);
+        assert(!memcmp(buf, ref16, sizeof(ref16)));
+
+        memcpy(buf, fl32, sizeof(fl32));
+        impls[0].k.fl32_s32(ref32, fl32, n);
+        impls[i].k.fl32_s32(buf, buf, n);
+        assert(!memcmp(buf, ref32, sizeof(ref32)));
+
+        memcpy(buf, s32, sizeof(s32));
+        impls[0].k.s32_s16(ref16, s32, n);
+        impls[i].k.s32_s16(buf, buf, n);
+        assert(!memcmp(buf, ref16, sizeof(ref16)));
+    }
+    free(buf);
+}
+
+static void bench(void)
+{
+    const size_t n = 4096;
+    int16_t *s16 = malloc(n * sizeof(*s16));
+    float *fl32 = malloc(n * sizeof(*fl32));
+    int32_t *s32 = malloc(n * sizeof(*s32));
+    assert(s16 != NULL && fl32 != NULL && s32 != NULL);
+
+    for (size_t i = 0; i < n; i++)
+        fl32[i] = rand_sample();
+
+    for (unsigned i = 0; i < ARRAY_SIZE(impls); i++)
+    {
+        if (!cpu_usable(impls[i].pf_usable))
+            continue;
+
+        mtime_t start = mdate();
+        for (int k = 0; k < 2000; k++)
+        {
+            impls[i].k.fl32_s16(s16, fl32, n);
+            impls[i].k.s16_fl32(fl32, s16, n);
+        }
+        int64_t s16_rate = bench_rate(start, 2 * 2000 * n) / 1000000;
+
+        start = mdate();
+        for (int k = 0; k < 2000; k++)
+        {
+            impls[i].k.fl32_s32(s32, fl32, n);
+            impls[i].k.s32_fl32(fl32, s32, n);
+        }
+        int64_t s32_rate = bench_rate(start, 2 * 2000 * n) / 1000000;
+
+        printf("%s: FL32<->S16 %4"PRId64" Msamples/s, "
+               "FL32<->S32 %4"PRId64" Msamples/s\n", impls[i].psz_name,
+               s16_rate, s32_rate);
+    }
+
+    free(s32);
+    free(fl32);
+    free(s16);
+}
+
+int main(void)
+{
+    srand(42);
+
+    if (test_bench)
+    {
+        bench();
+        return 0;
+    }
+
+    for (size_t n = 1; n <= 70; n++)
+        check(n);
+    for (unsigned i = 0; i < 20; i++)
+        check(4096 + i);
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*****************************************************************************
+ * polyphase.c: polyphase resampler tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../simd.h"
+#include "../modules/audio_filter/resampler/polyphase.h"
+
+static const struct
+{
+    const char *psz_name;
+    polyphase_dot_cb pf_dot;
+    bool (*pf_usable)( void );
+} impls[] = {
+    { "C", polyphase_dot_C, NULL },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", polyphase_dot_SSE2, cpu_sse2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", polyphase_dot_AVX2, cpu_avx2 },
+#endif
+#ifdef POLYPHASE_NEON
+    { "NEON", polyphase_dot_NEON, cpu_neon },
+#endif
+};
+
+static void check_dot( unsigned n )
+{
+    float *p_coefs = vlc_memalign( 32, n * sizeof(float) );
+    float p_in[n + 1];
+    assert( p_coefs != NULL );
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        p_coefs[i] = randf();
+        p_in[i] = randf();
+    }
+    p_in[n] = randf();
+
+    /* The input samples are not aligned in the second case */
+    double ref[2] = { 0., 0. };
+    for( unsigned j = 0; j < 2; j++ )
+        for( unsigned k = 0; k < n; k++ )
+            ref[j] += (double)p_in[j + k] * p_coefs[k];
+
+    for( unsigned i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        for( unsigned j = 0; j < 2; j++ )
+        {
+            const float f_out = impls[i].pf_dot( &p_in[j], p_coefs, n );
+
+            if( fabs( f_out - ref[j] ) > 1e-5 * n )
+            {
+                fprintf( stderr, "%s: dot %u: %f instead of %f\n",
+                         impls[i].psz_name, n, f_out, ref[j] );
+                abort();
+            }
+        }
+    }
+    vlc_free( p_coefs );
+}
+
+/* Resamples a sine, and returns the signal to noise ratio in dB */
+static double check_sine( unsigned i_quality, unsigned i_in_rate,
+                          unsigned i_out_rate, bool b_variable,
+                          unsigned i_chunk )
+{
+    const unsigned i_channels = 2;
+    const size_t i_frames = i_in_rate / 4;
+    const double f_freq = 997.;
+    polyphase_t p;
+
+    assert( polyphase_Init( &p, i_quality, i_channels, i_in_rate,
+                            i_out_rate, b_variable ) == VLC_SUCCESS );
+
+    float *p_in = malloc( i_frames * i_channels * sizeof(float) );
+    size_t i_max = polyphase_GetMaxOutput( &p, i_frames )
+                 + polyphase_GetMaxOutput( &p, p.i_taps / 2 );
+    float *p_out = malloc( i_max * i_channels * sizeof(float) );
+    assert( p_in != NULL && p_out != NULL );
+
+    for( size_t i = 0; i < i_frames; i++ )
+        for( unsigned c = 0; c < i_channels; c++ )
+            p_in[i * i_channels + c] =
+                .5 * sin( 2. * M_PI * f_freq * (i + c * .25) / i_in_rate );
+
+    size_t i_out = 0;
+    for( size_t i = 0; i < i_frames; i += i_chunk )
+    {
+        const size_t i_count = __MIN(i_chunk, i_frames - i);
+        i_out += polyphase_Process( &p, &p_out[i_out * i_channels],
+                                    &p_in[i * i_channels], i_count );
+    }
+    i_out += polyphase_Drain( &p, &p_out[i_out * i_channels] );
+
+    /* All the input is output, the filter delay is compensated */
+    const size_t i_expected = ((uint64_t)i_frames * i_out_rate
+                               + i_in_rate - 1) / i_in_rate;
+    assert( i_out == i_expected );
+
+    /* Ignore the edges, where the filter sees the zeros around the input */
+    const size_t i_edge = (uint64_t)p.i_taps * i_out_rate / i_in_rate + 1;
+    double f_signal = 0., f_noise = 0.;
+    for( size_t k = i_edge; k + i_edge < i_out; k++ )
+        for( unsigned c = 0; c < i_channels; c++ )
+        {
+            const double f_ref = .5 * sin( 2. * M_PI * f_freq
+                * ((double)k * i_in_rate / i_out_rate + c * .25) / i_in_rate );
+            const double f_err = p_out[k * i_channels + c] - f_ref;
+
+            f_signal += f_ref * f_ref;
+            f_noise += f_err * f_err;
+        }
+
+    free( p_out );
+    free( p_in );
+    polyphase_Clean( &p );
+    return 10. * log10( f_signal / f_noise );
+}
+
+/* Bands are processed in chunks: the output must not depend on them */
+static void check_chunks( unsigned i_in_rate, unsigned i_out_rate,
+                          bool b_variable )
+{
+    static const unsigned chunks[] = { 1, 7, 64, 1000 };
+    double f_ref = check_sine( 1, i_in_rate, i_out_rate, b_variable, 4096 );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(chunks); i++ )
+        assert( check_sine( 1, i_in_rate, i_out_rate, b_variable,
+                            chunks[i] ) == f_ref );
+}
+
+int main( void )
+{
+    static const unsigned rates[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 },
+        { 96000, 48000 }, { 8000, 44100 }, { 48000, 48000 },
+    };
+    /* Minimum signal to noise ratios of the presets */
+    static const double snr[] = { 50., 70., 95., 110. };
+
+    srand( 42 );
+
+    for( unsigned n = 16; n <= 256; n += 16 )
+        check_dot( n );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(rates); i++ )
+    {
+        check_chunks( rates[i][0], rates[i][1], false );
+        check_chunks( rates[i][0], rates[i][1], true );
+
+        for( unsigned q = 0; q <= POLYPHASE_MAX_QUALITY; q++ )
+            for( int v = 0; v < 2; v++ )
+            {
+                double f_snr = check_sine( q, rates[i][0], rates[i][1],
+                                           v, 1024 );
+                printf( "%u->%uHz, quality %u%s: %.1f dB\n", rates[i][0],
+                        rates[i][1], q, v ? " (variable)" : "", f_snr );
+                assert( f_snr >= snr[q] );
+            }
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * polyphase_bench.c: polyphase resampler benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+/* The band-limited resampler is the reference of the benchmark: its filter
+ * callback is called directly, so the module is built in */
+#define MODULE_NAME bandlimited
+#define MODULE_STRING "bandlimited"
+#include "../modules/audio_filter/resampler/bandlimited.c"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../simd.h"
+#include "../modules/audio_filter/resampler/polyphase.h"
+
+static void bench( unsigned i_in_rate, unsigned i_out_rate )
+{
+    const size_t i_block = 1024, i_blocks = 60 * i_in_rate / i_block;
+    mtime_t start;
+
+    /* The input blocks are all copies of the same one */
+    block_t *p_block = block_Alloc( i_block * 2 * sizeof(float) );
+    assert( p_block != NULL );
+    for( size_t i = 0; i < 2 * i_block; i++ )
+        ((float *)p_block->p_buffer)[i] = randf();
+    p_block->i_nb_samples = i_block;
+    p_block->i_pts = VLC_TS_0;
+
+    printf( "%u->%uHz stereo, speed:", i_in_rate, i_out_rate );
+
+    /* As OpenFilter() does, without an object to log to */
+    filter_t filter;
+    filter_sys_t sys = { .p_buf = NULL, .b_first = true };
+
+    memset( &filter, 0, sizeof(filter) );
+    es_format_Init( &filter.fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    filter.fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter.fmt_in.audio.i_rate = i_in_rate;
+    filter.fmt_in.audio.i_physical_channels =
+    filter.fmt_in.audio.i_original_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare( &filter.fmt_in.audio );
+    filter.fmt_out = filter.fmt_in;
+    filter.fmt_out.audio.i_rate = i_out_rate;
+    filter.p_sys = &sys;
+
+    start = mdate();
+    for( size_t i = 0; i < i_blocks; i++ )
+    {
+        block_t *p_out = Resample( &filter, block_Duplicate( p_block ) );
+        if( p_out != NULL )
+            block_Release( p_out );
+    }
+    free( sys.p_buf );
+    printf( " bandlimited %4"PRId64"x", bench_rate( start, 60 ) );
+
+    for( unsigned q = 0; q <= POLYPHASE_MAX_QUALITY; q++ )
+    {
+        polyphase_t p;
+        assert( polyphase_Init( &p, q, 2, i_in_rate, i_out_rate,
+                                false ) == VLC_SUCCESS );
+
+        start = mdate();
+        for( size_t i = 0; i < i_blocks; i++ )
+        {
+            block_t *p_in = block_Duplicate( p_block );
+            block_t *p_out = block_Alloc( polyphase_GetMaxOutput( &p,
+                                              i_block ) * 2 * sizeof(float) );
+            assert( p_in != NULL && p_out != NULL );
+            polyphase_Process( &p, (float *)p_out->p_buffer,
+                               (const float *)p_in->p_buffer, i_block );
+            block_Release( p_out );
+            block_Release( p_in );
+        }
+        printf( " q%u %4"PRId64"x", q, bench_rate( start, 60 ) );
+        polyphase_Clean( &p );
+    }
+    printf( "\n" );
+    block_Release( p_block );
+}
+
+int main( void )
+{
+    srand( 42 );
+
+    bench( 44100, 48000 );
+    bench( 48000, 44100 );
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+ * amplify.c: audio amplification kernels tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../simd.h"
+#include "../modules/audio_mixer/amplify.h"
+
+typedef void (*amplify_fl32_t)( float *, size_t, unsigned, float, float );
+typedef void (*amplify_fl64_t)( double *, size_t, unsigned, float, float );
+
+static const struct
+{
+    const char *psz_name;
+    amplify_fl32_t pf_fl32;
+    amplify_fl64_t pf_fl64;
+    bool (*pf_usable)( void );
+} impls[] = {
+    { "C", amplify_fl32_C, amplify_fl64_C, NULL },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", amplify_fl32_SSE2, amplify_fl64_SSE2, cpu_sse2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", amplify_fl32_AVX2, amplify_fl64_AVX2, cpu_avx2 },
+#endif
+#ifdef AMPLIFY_NEON
+    { "NEON", amplify_fl32_NEON, amplify_fl64_NEON, cpu_neon },
+#endif
+};
+
+/* The ramps may differ in the last bit, depending on how the compiler
+ * contracted or reassociated the C version */
+#define same( a, b ) (fabs( (a) - (b) ) <= 1e-6 * fabs( b ))
+
+/* Guard samples after the buffer catch writes past the end */
+#define GUARD 16
+
+static void check( size_t i_frames, unsigned i_channels,
+                   float f_from, float f_to )
+{
+    const size_t i_samples = i_frames * i_channels;
+    float src32[i_samples + GUARD], ref32[i_samples + GUARD];
+    float out32[i_samples + GUARD];
+    double src64[i_samples + GUARD], ref64[i_samples + GUARD];
+    double out64[i_samples + GUARD];
+
+    for( size_t i = 0; i < i_samples + GUARD; i++ )
+        src64[i] = src32[i] = randf();
+
+    memcpy( ref32, src32, sizeof(ref32) );
+    memcpy( ref64, src64, sizeof(ref64) );
+    amplify_fl32_C( ref32, i_frames, i_channels, f_from, f_to );
+    amplify_fl64_C( ref64, i_frames, i_channels, f_from, f_to );
+
+    /* The ramp ends on the new gain, and leaves the guard alone */
+    if( i_frames > 0 )
+        for( unsigned c = 0; c < i_channels; c++ )
+        {
+            const size_t i = (i_frames - 1) * i_channels + c;
+            assert( fabsf( ref32[i] - src32[i] * f_to ) <= 1e-5f );
+            assert( fabs( ref64[i] - src64[i] * f_to ) <= 1e-6 );
+        }
+    assert( !memcmp( &ref32[i_samples], &src32[i_samples],
+                     GUARD * sizeof(float) ) );
+
+    for( unsigned i = 1; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        memcpy( out32, src32, sizeof(out32) );
+        memcpy( out64, src64, sizeof(out64) );
+        impls[i].pf_fl32( out32, i_frames, i_channels, f_from, f_to );
+        impls[i].pf_fl64( out64, i_frames, i_channels, f_from, f_to );
+
+        for( size_t j = 0; j < i_samples + GUARD; j++ )
+            if( !same( out32[j], ref32[j] ) || !same( out64[j], ref64[j] ) )
+            {
+                fprintf( stderr, "%s: %zux%u %f->%f mismatch at %zu\n",
+                         impls[i].psz_name, i_frames, i_channels,
+                         f_from, f_to, j );
+                abort();
+            }
+    }
+}
+
+static void bench( unsigned i_channels )
+{
+    const size_t i_frames = 1024;
+    float *p = malloc( i_frames * i_channels * sizeof(float) );
+    assert( p != NULL );
+
+    for( size_t i = 0; i < i_frames * i_channels; i++ )
+        p[i] = randf();
+
+    printf( "%u channels:", i_channels );
+    for( unsigned i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        mtime_t start = mdate();
+        for( int k = 0; k < 2000; k++ )
+        {
+            impls[i].pf_fl32( p, i_frames, i_channels, 1.f, 1.f );
+            impls[i].pf_fl32( p, i_frames, i_channels, 1.f, .5f );
+            impls[i].pf_fl32( p, i_frames, i_channels, .5f, 1.f );
+        }
+
+        printf( " %s %4"PRId64" Msamples/s", impls[i].psz_name,
+                bench_rate( start, 3 * 2000 * i_frames * i_channels )
+                / 1000000 );
+    }
+    printf( "\n" );
+    free( p );
+}
+
+int main( void )
+{
+    static const size_t frames[] = { 0, 1, 3, 4, 7, 8, 9, 31, 64, 1023 };
+    static const float gains[][2] = {
+        { 1.f, 1.f }, { .5f, .5f }, { 0.f, 1.f }, { 1.f, 0.f },
+        { .3f, 2.7f }, { 1.f, .999f },
+    };
+
+    srand( 42 );
+
+    if( test_bench )
+    {
+        bench( 1 );
+        bench( 2 );
+        bench( 6 );
+        return 0;
+    }
+
+    for( unsigned c = 1; c <= AOUT_CHAN_MAX + 1; c++ )
+        for( unsigned i = 0; i < ARRAY_SIZE(frames); i++ )
+            for( unsigned g = 0; g < ARRAY_SIZE(gains); g++ )
+                check( frames[i], c, gains[g][0], gains[g][1] );
+    return 0;
+}
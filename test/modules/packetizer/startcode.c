@@ -0,0 +1,185 @@
+/*****************************************************************************
+ * startcode.c: AnnexB startcode lookup tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../modules/packetizer/startcode_helper.h"
+
+#ifdef HAVE_AVX2_INTRINSICS
+static bool avx2_usable( void )
+{
+    return vlc_CPU_AVX2();
+}
+#endif
+
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+static bool sse2_usable( void )
+{
+    return vlc_CPU_SSE2();
+}
+#endif
+
+typedef const uint8_t * (*startcode_finder)( const uint8_t *, const uint8_t * );
+
+static const struct
+{
+    const char *psz_name;
+    startcode_finder pf_find;
+    bool (*pf_usable)( void );
+} finders[] = {
+#define FINDER(name, usable) { #name, startcode_FindAnnexB_##name, usable },
+#ifdef HAVE_AVX2_INTRINSICS
+    FINDER(AVX2, avx2_usable)
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    FINDER(SSE2, sse2_usable)
+#endif
+#ifdef STARTCODE_NEON
+    FINDER(NEON, NULL)
+#endif
+    FINDER(C, NULL)
+#undef FINDER
+};
+
+/* A startcode is only reported if at least one byte follows it */
+static const uint8_t * ref_FindAnnexB( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 4; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+/* Fills a buffer like a stream with NAL units of about i_nal bytes: random
+ * payload with some emulation prevention sequences */
+static void fill( uint8_t *p, size_t i_size, size_t i_nal )
+{
+    size_t i_next = 0;
+
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        int r = rand();
+
+        if( i == i_next && i + 4 <= i_size )
+        {
+            memcpy( &p[i], "\x00\x00\x00\x01", 4 );
+            i += 3;
+            i_next = i + 1 + i_nal / 2 + (size_t)r % (i_nal + 1);
+        }
+        else if( (r & 0xff) == 0 && i + 3 <= i_size )
+        {
+            memcpy( &p[i], "\x00\x00\x03", 3 );
+            i += 2;
+        }
+        else
+            p[i] = r >> 8;
+    }
+}
+
+static size_t count( startcode_finder pf_find, const uint8_t *p,
+                     const uint8_t *end )
+{
+    size_t i_count = 0;
+
+    while( (p = pf_find( p, end )) != NULL )
+    {
+        i_count++;
+        p += 3;
+    }
+    return i_count;
+}
+
+static void test_finder( unsigned i, const uint8_t *p_buf, size_t i_buf )
+{
+    /* all offsets and lengths around the vector sizes */
+    for( size_t i_start = 0; i_start < 64; i_start++ )
+        for( size_t i_len = 0; i_len < 160 && i_start + i_len <= i_buf; i_len++ )
+        {
+            const uint8_t *p = p_buf + i_start, *end = p + i_len;
+            const uint8_t *p_ref;
+
+            do
+            {
+                p_ref = ref_FindAnnexB( p, end );
+                const uint8_t *p_found = finders[i].pf_find( p, end );
+                if( p_found != p_ref )
+                {
+                    fprintf( stderr, "%s: mismatch at %zu+%zu: %td vs %td\n",
+                             finders[i].psz_name, i_start, i_len,
+                             p_found ? p_found - p_buf : -1,
+                             p_ref ? p_ref - p_buf : -1 );
+                    abort();
+                }
+                p = p_ref + 1;
+            } while( p_ref != NULL );
+        }
+
+    assert( count( finders[i].pf_find, p_buf, p_buf + i_buf )
+         == count( ref_FindAnnexB, p_buf, p_buf + i_buf ) );
+}
+
+#define BUFFER_SIZE (4 << 20)
+
+int main( void )
+{
+    /* From about 1 Mb/s to 100 Mb/s at 25 fps with one slice per frame */
+    static const size_t nal_sizes[] = { 64, 1500, 5000, 50000, 500000 };
+    uint8_t *p_buf = malloc( BUFFER_SIZE );
+
+    assert( p_buf != NULL );
+    srand( 42 );
+
+    for( size_t j = 0; j < sizeof(nal_sizes) / sizeof(nal_sizes[0]); j++ )
+    {
+        fill( p_buf, BUFFER_SIZE, nal_sizes[j] );
+        printf( "NAL size %6zu:", nal_sizes[j] );
+
+        for( unsigned i = 0; i < sizeof(finders) / sizeof(finders[0]); i++ )
+        {
+            if( finders[i].pf_usable != NULL && !finders[i].pf_usable() )
+                continue;
+
+            test_finder( i, p_buf, BUFFER_SIZE );
+
+            mtime_t start = mdate();
+            for( unsigned k = 0; k < 4; k++ )
+                (void) count( finders[i].pf_find, p_buf, p_buf + BUFFER_SIZE );
+            mtime_t elapsed = mdate() - start;
+
+            printf( " %s %5"PRId64" MB/s", finders[i].psz_name,
+                    elapsed > 0 ? 4 * (int64_t)BUFFER_SIZE / elapsed : 0 );
+        }
+        printf( "\n" );
+    }
+
+    free( p_buf );
+    return 0;
+}
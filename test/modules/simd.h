@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * simd.h: common helpers for the tests of the modules SIMD kernels
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_MODULES_SIMD_H
+#define VLC_TEST_MODULES_SIMD_H
+
+/* Each test lists the implementations of its kernels in a table, the C one
+ * first, with a CPU check for the other ones. The checks compare every
+ * usable implementation against the C one. The same source built with
+ * TEST_BENCH defined is the benchmark instead (see EXTRA_PROGRAMS). */
+
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#if defined (__i386__) || defined (__x86_64__)
+static inline bool cpu_mmx( void ) { return vlc_CPU_MMX(); }
+static inline bool cpu_sse2( void ) { return vlc_CPU_SSE2(); }
+static inline bool cpu_ssse3( void ) { return vlc_CPU_SSSE3(); }
+static inline bool cpu_sse4_1( void ) { return vlc_CPU_SSE4_1(); }
+static inline bool cpu_avx2( void ) { return vlc_CPU_AVX2(); }
+#endif
+#ifdef __aarch64__
+static inline bool cpu_neon( void ) { return vlc_CPU_ARM64_NEON(); }
+#endif
+
+/* Whether an implementation can run, given its CPU check (NULL for C) */
+static inline bool cpu_usable( bool (*pf_usable)( void ) )
+{
+    return pf_usable == NULL || pf_usable();
+}
+
+#ifdef TEST_BENCH
+# define test_bench true
+#else
+# define test_bench false
+#endif
+
+/* Uniform random sample in [-1, 1] */
+static inline float randf( void )
+{
+    return rand() / (float)RAND_MAX * 2.f - 1.f;
+}
+
+/* Rate per second of i_count operations done since i_start */
+static inline int64_t bench_rate( mtime_t i_start, int64_t i_count )
+{
+    mtime_t i_elapsed = mdate() - i_start;
+    return i_elapsed > 0 ? i_count * CLOCK_FREQ / i_elapsed : 0;
+}
+
+#endif
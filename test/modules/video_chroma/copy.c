@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * copy.c: hardware surfaces copy tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../modules/video_chroma/copy.c"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A surface with its own pitch, not aligned like the pictures */
+typedef struct
+{
+    uint8_t *p_buffer;
+    uint8_t *planes[3];
+    size_t pitches[3];
+} surface_t;
+
+static void surface_Init( surface_t *s, unsigned i_pitch, unsigned i_height,
+                          unsigned i_planes )
+{
+    const size_t i_luma = (size_t)i_pitch * i_height;
+    const size_t i_chroma = (size_t)i_pitch / (i_planes - 1)
+                          * ((i_height + 1) / 2);
+
+    s->p_buffer = malloc( 1 + i_luma + (i_planes - 1) * i_chroma );
+    assert( s->p_buffer != NULL );
+    for( size_t i = 0; i < 1 + i_luma + (i_planes - 1) * i_chroma; i++ )
+        s->p_buffer[i] = rand();
+
+    s->planes[0] = s->p_buffer + 1;
+    s->pitches[0] = i_pitch;
+    for( unsigned i = 1; i < i_planes; i++ )
+    {
+        s->planes[i] = s->planes[0] + i_luma + (i - 1) * i_chroma;
+        s->pitches[i] = i_pitch / (i_planes - 1);
+    }
+}
+
+static picture_t *NewPicture( vlc_fourcc_t i_chroma, unsigned i_width,
+                              unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic != NULL );
+    return p_pic;
+}
+
+static void check_nv12( unsigned i_width, unsigned i_height, unsigned i_pitch )
+{
+    surface_t src;
+    copy_cache_t cache;
+
+    surface_Init( &src, i_pitch, i_height, 2 );
+    assert( CopyInitCache( &cache, i_width ) == VLC_SUCCESS );
+
+    /* NV12 -> YV12 */
+    picture_t *p_pic = NewPicture( VLC_CODEC_YV12, i_width, i_height );
+    CopyFromNv12( p_pic, src.planes, src.pitches, i_height, &cache );
+
+    for( unsigned y = 0; y < i_height; y++ )
+        assert( !memcmp( &p_pic->p[0].p_pixels[y * p_pic->p[0].i_pitch],
+                         &src.planes[0][y * src.pitches[0]], i_width ) );
+    for( unsigned y = 0; y < i_height / 2; y++ )
+        for( unsigned x = 0; x < i_width / 2; x++ )
+        {
+            const uint8_t *p_uv = &src.planes[1][y * src.pitches[1] + 2 * x];
+            /* YV12 has V in the second plane */
+            assert( p_pic->p[2].p_pixels[y * p_pic->p[2].i_pitch + x]
+                    == p_uv[0] );
+            assert( p_pic->p[1].p_pixels[y * p_pic->p[1].i_pitch + x]
+                    == p_uv[1] );
+        }
+    picture_Release( p_pic );
+
+    /* NV12 -> NV12 */
+    p_pic = NewPicture( VLC_CODEC_NV12, i_width, i_height );
+    CopyFromNv12ToNv12( p_pic, src.planes, src.pitches, i_height, &cache );
+
+    for( unsigned i = 0; i < 2; i++ )
+        for( unsigned y = 0; y < i_height >> i; y++ )
+            assert( !memcmp( &p_pic->p[i].p_pixels[y * p_pic->p[i].i_pitch],
+                             &src.planes[i][y * src.pitches[i]], i_width ) );
+    picture_Release( p_pic );
+
+    CopyCleanCache( &cache );
+    free( src.p_buffer );
+}
+
+static void check_yv12( unsigned i_width, unsigned i_height, unsigned i_pitch )
+{
+    surface_t src;
+    copy_cache_t cache;
+
+    surface_Init( &src, i_pitch, i_height, 3 );
+    assert( CopyInitCache( &cache, i_width ) == VLC_SUCCESS );
+
+    picture_t *p_pic = NewPicture( VLC_CODEC_YV12, i_width, i_height );
+    CopyFromYv12( p_pic, src.planes, src.pitches, i_height, &cache );
+
+    for( unsigned i = 0; i < 3; i++ )
+    {
+        const unsigned i_lines = i ? (i_height + 1) / 2 : i_height;
+        const unsigned i_pixels = i ? i_width / 2 : i_width;
+
+        for( unsigned y = 0; y < i_lines; y++ )
+            assert( !memcmp( &p_pic->p[i].p_pixels[y * p_pic->p[i].i_pitch],
+                             &src.planes[i][y * src.pitches[i]], i_pixels ) );
+    }
+    picture_Release( p_pic );
+
+    CopyCleanCache( &cache );
+    free( src.p_buffer );
+}
+
+static void bench( unsigned i_width, unsigned i_height )
+{
+    /* Surfaces are usually padded, so that the copy cannot be one memcpy */
+    const unsigned i_pitch = (i_width + 255) & ~255;
+    surface_t src;
+    copy_cache_t cache;
+
+    surface_Init( &src, i_pitch, i_height, 2 );
+    assert( CopyInitCache( &cache, i_width ) == VLC_SUCCESS );
+
+    picture_t *p_yv12 = NewPicture( VLC_CODEC_YV12, i_width, i_height );
+    picture_t *p_nv12 = NewPicture( VLC_CODEC_NV12, i_width, i_height );
+
+    mtime_t start = mdate();
+    for( int k = 0; k < 20; k++ )
+        CopyFromNv12( p_yv12, src.planes, src.pitches, i_height, &cache );
+    mtime_t split = mdate() - start;
+
+    start = mdate();
+    for( int k = 0; k < 20; k++ )
+        CopyFromNv12ToNv12( p_nv12, src.planes, src.pitches, i_height,
+                            &cache );
+    mtime_t copy = mdate() - start;
+
+    printf( "%ux%u: NV12->YV12 %4"PRId64" fps, NV12->NV12 %4"PRId64" fps\n",
+            i_width, i_height, split > 0 ? 20 * CLOCK_FREQ / split : 0,
+            copy > 0 ? 20 * CLOCK_FREQ / copy : 0 );
+
+    picture_Release( p_nv12 );
+    picture_Release( p_yv12 );
+    CopyCleanCache( &cache );
+    free( src.p_buffer );
+}
+
+int main( void )
+{
+    static const unsigned sizes[][3] = {
+        { 2, 2, 2 }, { 16, 16, 32 }, { 64, 8, 64 }, { 64, 8, 96 },
+        { 100, 62, 112 }, { 720, 576, 768 }, { 1920, 1080, 2048 },
+        { 3840, 2160, 4096 }, { 4096, 2160, 4096 },
+    };
+
+    srand( 42 );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(sizes); i++ )
+    {
+        check_nv12( sizes[i][0], sizes[i][1], sizes[i][2] );
+        check_yv12( sizes[i][0], sizes[i][1], sizes[i][2] );
+    }
+
+    bench( 1280, 720 );
+    bench( 1920, 1080 );
+    bench( 3840, 2160 );
+    return 0;
+}
@@ -0,0 +1,304 @@
+/*****************************************************************************
+ * yuv_pack.c: YUV packing kernels tests and chroma conversion benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../simd.h"
+#include "../modules/video_chroma/yuv_pack.h"
+
+static const struct
+{
+    const char *psz_name;
+    yuv_pack_kernels_t kernels;
+    bool (*pf_usable)( void );
+} impls[] = {
+    { "C", { split422_C, luma422_C, p010_luma_C, p010_chroma_C }, NULL },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", { split422_SSE2, luma422_SSE2,
+                p010_luma_SSE2, p010_chroma_SSE2 }, cpu_sse2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", { split422_AVX2, luma422_AVX2,
+                p010_luma_AVX2, p010_chroma_AVX2 }, cpu_avx2 },
+#endif
+#ifdef YUV_PACK_NEON
+    { "NEON", { split422_NEON, luma422_NEON,
+                p010_luma_NEON, p010_chroma_NEON }, cpu_neon },
+#endif
+};
+
+/* Guard bytes after each output line catch writes past the width */
+#define GUARD 64
+
+static void fill( void *p_buf, size_t i_size )
+{
+    uint8_t *p = p_buf;
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = rand();
+}
+
+static void check_split422( unsigned i_width, bool b_luma_first )
+{
+    uint8_t src[2 * i_width];
+    uint8_t ref[3][i_width + GUARD], out[3][i_width + GUARD];
+
+    fill( src, sizeof(src) );
+    memset( ref, 0x5A, sizeof(ref) );
+    split422_C( ref[0], ref[1], ref[2], src, i_width, b_luma_first );
+
+    const unsigned i_luma = !b_luma_first;
+    for( unsigned x = 0; x < i_width; x++ )
+        assert( ref[0][x] == src[2 * x + i_luma] );
+    for( unsigned x = 0; x < i_width / 2; x++ )
+    {
+        assert( ref[1][x] == src[4 * x + 1 - i_luma] );
+        assert( ref[2][x] == src[4 * x + 3 - i_luma] );
+    }
+
+    for( unsigned i = 1; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        memset( out, 0x5A, sizeof(out) );
+        impls[i].kernels.pf_split422( out[0], out[1], out[2], src, i_width,
+                                      b_luma_first );
+        if( memcmp( ref, out, sizeof(ref) ) )
+        {
+            fprintf( stderr, "%s: split422 %u mismatch\n",
+                     impls[i].psz_name, i_width );
+            abort();
+        }
+
+        memset( out, 0x5A, sizeof(out) );
+        impls[i].kernels.pf_luma422( out[0], src, i_width, b_luma_first );
+        if( memcmp( ref[0], out[0], sizeof(ref[0]) ) )
+        {
+            fprintf( stderr, "%s: luma422 %u mismatch\n",
+                     impls[i].psz_name, i_width );
+            abort();
+        }
+    }
+}
+
+static void check_p010( unsigned i_width )
+{
+    uint16_t y[i_width], u[i_width], v[i_width];
+    uint16_t ref[2][2 * i_width + GUARD], out[2][2 * i_width + GUARD];
+
+    for( unsigned x = 0; x < i_width; x++ )
+    {
+        y[x] = rand() & 0x3ff;
+        u[x] = rand() & 0x3ff;
+        v[x] = rand() & 0x3ff;
+    }
+
+    memset( ref, 0x5A, sizeof(ref) );
+    p010_luma_C( ref[0], y, i_width );
+    p010_chroma_C( ref[1], u, v, i_width );
+    for( unsigned x = 0; x < i_width; x++ )
+    {
+        assert( ref[0][x] == y[x] << 6 );
+        assert( ref[1][2 * x] == u[x] << 6 );
+        assert( ref[1][2 * x + 1] == v[x] << 6 );
+    }
+
+    for( unsigned i = 1; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        memset( out, 0x5A, sizeof(out) );
+        impls[i].kernels.pf_p010_luma( out[0], y, i_width );
+        impls[i].kernels.pf_p010_chroma( out[1], u, v, i_width );
+        if( memcmp( ref, out, sizeof(ref) ) )
+        {
+            fprintf( stderr, "%s: p010 %u mismatch\n",
+                     impls[i].psz_name, i_width );
+            abort();
+        }
+    }
+}
+
+/* Whole frame conversions, line by line as the converters do */
+static void yuy2_i420( const yuv_pack_kernels_t *k, uint8_t *p_dst,
+                       const uint8_t *p_src, unsigned i_width,
+                       unsigned i_height )
+{
+    uint8_t *p_u = &p_dst[i_width * i_height];
+    uint8_t *p_v = &p_u[i_width / 2 * ((i_height + 1) / 2)];
+    unsigned y;
+
+    for( y = 0; y + 1 < i_height; y += 2 )
+    {
+        k->pf_split422( &p_dst[y * i_width], &p_u[y / 2 * i_width / 2],
+                        &p_v[y / 2 * i_width / 2], &p_src[y * 2 * i_width],
+                        i_width, true );
+        k->pf_luma422( &p_dst[(y + 1) * i_width],
+                       &p_src[(y + 1) * 2 * i_width], i_width, true );
+    }
+    if( y < i_height )
+        split422_C( &p_dst[y * i_width], &p_u[y / 2 * i_width / 2],
+                    &p_v[y / 2 * i_width / 2], &p_src[y * 2 * i_width],
+                    i_width, true );
+}
+
+static void check_yuy2_i420( unsigned i_width, unsigned i_height )
+{
+    const size_t i_planar = i_width * i_height
+                          + i_width * ((i_height + 1) / 2);
+    uint8_t src[2 * i_width * i_height];
+    uint8_t ref[i_planar], out[i_planar];
+
+    fill( src, sizeof(src) );
+    memset( ref, 0x5A, sizeof(ref) );
+    yuy2_i420( &impls[0].kernels, ref, src, i_width, i_height );
+
+    /* The chroma of the last line of odd heights is converted too */
+    if( i_height & 1 )
+    {
+        const uint8_t *p_last = &src[2 * i_width * (i_height - 1)];
+        const uint8_t *p_u = &ref[i_width * i_height
+                                  + i_width / 2 * (i_height / 2)];
+
+        for( unsigned x = 0; x < i_width / 2; x++ )
+            assert( p_u[x] == p_last[4 * x + 1] );
+    }
+
+    for( unsigned i = 1; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        memset( out, 0x5A, sizeof(out) );
+        yuy2_i420( &impls[i].kernels, out, src, i_width, i_height );
+        if( memcmp( ref, out, sizeof(ref) ) )
+        {
+            fprintf( stderr, "%s: YUY2->I420 %ux%u mismatch\n",
+                     impls[i].psz_name, i_width, i_height );
+            abort();
+        }
+    }
+}
+
+static void i420_10_p010( const yuv_pack_kernels_t *k, uint16_t *p_dst,
+                          const uint16_t *p_src, unsigned i_width,
+                          unsigned i_height )
+{
+    const uint16_t *p_u = &p_src[i_width * i_height];
+    const uint16_t *p_v = &p_u[i_width / 2 * i_height / 2];
+
+    for( unsigned y = 0; y < i_height; y++ )
+        k->pf_p010_luma( &p_dst[y * i_width], &p_src[y * i_width], i_width );
+    for( unsigned y = 0; y < i_height / 2; y++ )
+        k->pf_p010_chroma( &p_dst[(i_height + y) * i_width],
+                           &p_u[y * i_width / 2], &p_v[y * i_width / 2],
+                           i_width / 2 );
+}
+
+static void bench( unsigned i_width, unsigned i_height )
+{
+    const size_t i_pixels = (size_t)i_width * i_height;
+    uint8_t *p_packed = malloc( 2 * i_pixels );
+    uint8_t *p_planar = malloc( i_pixels * 3 / 2 );
+    uint16_t *p_i420_10 = malloc( i_pixels * 3 / 2 * sizeof(uint16_t) );
+    uint16_t *p_p010 = malloc( i_pixels * 3 / 2 * sizeof(uint16_t) );
+    assert( p_packed != NULL && p_planar != NULL );
+    assert( p_i420_10 != NULL && p_p010 != NULL );
+
+    fill( p_packed, 2 * i_pixels );
+    fill( p_i420_10, i_pixels * 3 / 2 * sizeof(uint16_t) );
+
+    printf( "%ux%u YUY2->I420:", i_width, i_height );
+    for( unsigned i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        mtime_t start = mdate();
+        for( int k = 0; k < 10; k++ )
+            yuy2_i420( &impls[i].kernels, p_planar, p_packed,
+                       i_width, i_height );
+
+        printf( " %s %5"PRId64" fps", impls[i].psz_name,
+                bench_rate( start, 10 ) );
+    }
+
+    printf( "\n%ux%u I420_10->P010:", i_width, i_height );
+    for( unsigned i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        mtime_t start = mdate();
+        for( int k = 0; k < 10; k++ )
+            i420_10_p010( &impls[i].kernels, p_p010, p_i420_10,
+                          i_width, i_height );
+
+        printf( " %s %5"PRId64" fps", impls[i].psz_name,
+                bench_rate( start, 10 ) );
+    }
+    printf( "\n" );
+
+    free( p_p010 );
+    free( p_i420_10 );
+    free( p_planar );
+    free( p_packed );
+}
+
+int main( void )
+{
+    static const unsigned widths[] = {
+        2, 6, 14, 16, 30, 32, 34, 62, 64, 66, 126, 128, 130, 720, 1918,
+    };
+    static const unsigned sizes[][2] = {
+        { 720, 576 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 },
+    };
+
+    srand( 42 );
+
+    if( test_bench )
+    {
+        for( unsigned i = 0; i < ARRAY_SIZE(sizes); i++ )
+            bench( sizes[i][0], sizes[i][1] );
+        return 0;
+    }
+
+    for( unsigned i = 0; i < ARRAY_SIZE(widths); i++ )
+    {
+        check_split422( widths[i], true );
+        check_split422( widths[i], false );
+        check_p010( widths[i] );
+        check_p010( widths[i] + 1 );
+        check_yuy2_i420( widths[i], 6 );
+        check_yuy2_i420( widths[i], 7 );
+    }
+    return 0;
+}
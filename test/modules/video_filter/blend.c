@@ -0,0 +1,309 @@
+/*****************************************************************************
+ * blend.c: test for the video blending
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+#include "../modules/video_filter/filter_picture.h"
+
+static unsigned div255( unsigned v )
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static void merge( uint8_t *dst, unsigned src, unsigned a )
+{
+    *dst = div255( (255 - a) * *dst + src * a );
+}
+
+/* Straightforward version of the generic blending */
+static void ref_blend( picture_t *p_dst, const picture_t *p_src,
+                       unsigned x0, unsigned y0, unsigned i_width,
+                       unsigned i_height, int i_alpha )
+{
+    const vlc_fourcc_t i_chroma = p_dst->format.i_chroma;
+    plane_t *p = p_dst->p;
+
+    for( unsigned y = 0; y < i_height; y++ )
+        for( unsigned x = 0; x < i_width; x++ )
+        {
+            const plane_t *s = p_src->p;
+            unsigned c[3], i_a;
+
+            if( p_src->format.i_chroma == VLC_CODEC_YUVA )
+            {
+                for( unsigned i = 0; i < 3; i++ )
+                    c[i] = s[i].p_pixels[y * s[i].i_pitch + x];
+                i_a = s[A_PLANE].p_pixels[y * s[A_PLANE].i_pitch + x];
+            }
+            else
+            {
+                const uint8_t *rgba = &s->p_pixels[y * s->i_pitch + 4 * x];
+                if( i_chroma != VLC_CODEC_RGB32 )
+                {
+                    uint8_t yuv[3];
+                    rgb_to_yuv( &yuv[0], &yuv[1], &yuv[2],
+                                rgba[0], rgba[1], rgba[2] );
+                    for( unsigned i = 0; i < 3; i++ )
+                        c[i] = yuv[i];
+                }
+                else
+                    for( unsigned i = 0; i < 3; i++ )
+                        c[i] = rgba[i];
+                i_a = rgba[3];
+            }
+
+            const unsigned a = div255( i_alpha * i_a );
+            const unsigned dx = x0 + x, dy = y0 + y;
+            const bool b_full = (dx % 2) == 0 && (dy % 2) == 0;
+
+            switch( i_chroma )
+            {
+                case VLC_CODEC_RGB32:
+                {
+                    uint8_t *d = &p->p_pixels[dy * p->i_pitch + 4 * dx];
+                    merge( &d[p_dst->format.i_lrshift / 8], c[0], a );
+                    merge( &d[p_dst->format.i_lgshift / 8], c[1], a );
+                    merge( &d[p_dst->format.i_lbshift / 8], c[2], a );
+                    break;
+                }
+                case VLC_CODEC_I420:
+                case VLC_CODEC_YV12:
+                {
+                    const unsigned u = i_chroma == VLC_CODEC_YV12 ? 2 : 1;
+                    merge( &p[0].p_pixels[dy * p[0].i_pitch + dx], c[0], a );
+                    if( !b_full )
+                        break;
+                    merge( &p[u].p_pixels[dy / 2 * p[u].i_pitch + dx / 2],
+                           c[1], a );
+                    merge( &p[3 - u].p_pixels[dy / 2 * p[3 - u].i_pitch + dx / 2],
+                           c[2], a );
+                    break;
+                }
+                case VLC_CODEC_NV12:
+                case VLC_CODEC_NV21:
+                {
+                    const unsigned u = i_chroma == VLC_CODEC_NV21;
+                    uint8_t *uv = &p[1].p_pixels[dy / 2 * p[1].i_pitch + dx];
+                    merge( &p[0].p_pixels[dy * p[0].i_pitch + dx], c[0], a );
+                    if( !b_full )
+                        break;
+                    merge( &uv[u], c[1], a );
+                    merge( &uv[!u], c[2], a );
+                    break;
+                }
+                default:
+                    assert( !"unexpected chroma" );
+            }
+        }
+}
+
+static picture_t *NewPicture( vlc_fourcc_t i_chroma, unsigned i_width,
+                              unsigned i_height, bool b_bgr )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    fmt.i_width = fmt.i_visible_width = i_width;
+    fmt.i_height = fmt.i_visible_height = i_height;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+    if( i_chroma == VLC_CODEC_RGB32 && !b_bgr )
+    {
+        fmt.i_rmask = 0x0000ff;
+        fmt.i_gmask = 0x00ff00;
+        fmt.i_bmask = 0xff0000;
+    }
+    video_format_FixRgb( &fmt );
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic != NULL );
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        for( int j = 0; j < p_pic->p[i].i_pitch * p_pic->p[i].i_lines; j++ )
+            p_pic->p[i].p_pixels[j] = rand();
+    return p_pic;
+}
+
+/* Transparent and opaque runs, as in subtitles */
+static void SetAlpha( picture_t *p_pic )
+{
+    plane_t *p = &p_pic->p[p_pic->format.i_chroma == VLC_CODEC_YUVA
+                           ? A_PLANE : 0];
+    const unsigned i_step = p_pic->format.i_chroma == VLC_CODEC_YUVA ? 1 : 4;
+    const unsigned i_offset = i_step - 1;
+
+    for( int y = 0; y < p->i_visible_lines; y++ )
+        for( unsigned x = 0; x < p_pic->format.i_width; x++ )
+        {
+            uint8_t *a = &p->p_pixels[y * p->i_pitch + x * i_step + i_offset];
+            switch( (x / 24 + y) % 4 )
+            {
+                case 0: *a = 0; break;
+                case 1: *a = 255; break;
+                default: break;
+            }
+        }
+}
+
+static filter_t *NewBlend( vlc_object_t *p_obj, const picture_t *p_dst,
+                           const picture_t *p_src )
+{
+    filter_t *p_blend = vlc_object_create( p_obj, sizeof(*p_blend) );
+    assert( p_blend != NULL );
+
+    p_blend->fmt_out.video = p_dst->format;
+    p_blend->fmt_in.video = p_src->format;
+    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
+    assert( p_blend->p_module != NULL );
+    return p_blend;
+}
+
+static void DeleteBlend( filter_t *p_blend )
+{
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+}
+
+static void check( vlc_object_t *p_obj, vlc_fourcc_t i_dst_chroma,
+                   vlc_fourcc_t i_src_chroma, bool b_bgr,
+                   unsigned i_src_width, unsigned i_src_height,
+                   unsigned x, unsigned y, int i_alpha )
+{
+    const unsigned i_dst_width = 67, i_dst_height = 45;
+    picture_t *p_dst = NewPicture( i_dst_chroma, i_dst_width, i_dst_height,
+                                   b_bgr );
+    picture_t *p_ref = NewPicture( i_dst_chroma, i_dst_width, i_dst_height,
+                                   b_bgr );
+    picture_t *p_src = NewPicture( i_src_chroma, i_src_width, i_src_height,
+                                   false );
+
+    SetAlpha( p_src );
+    picture_Copy( p_ref, p_dst );
+
+    filter_t *p_blend = NewBlend( p_obj, p_dst, p_src );
+    p_blend->pf_video_blend( p_blend, p_dst, p_src, x, y, i_alpha );
+    DeleteBlend( p_blend );
+
+    ref_blend( p_ref, p_src, x, y,
+               __MIN( i_dst_width - x, i_src_width ),
+               __MIN( i_dst_height - y, i_src_height ), i_alpha );
+
+    for( int i = 0; i < p_dst->i_planes; i++ )
+        for( int l = 0; l < p_dst->p[i].i_visible_lines; l++ )
+            if( memcmp( &p_dst->p[i].p_pixels[l * p_dst->p[i].i_pitch],
+                        &p_ref->p[i].p_pixels[l * p_ref->p[i].i_pitch],
+                        p_dst->p[i].i_visible_pitch ) )
+            {
+                fprintf( stderr, "%4.4s onto %4.4s: %ux%u at %u,%u alpha %d: "
+                         "mismatch on plane %d line %d\n",
+                         (const char *)&i_src_chroma,
+                         (const char *)&i_dst_chroma, i_src_width,
+                         i_src_height, x, y, i_alpha, i, l );
+                abort();
+            }
+
+    picture_Release( p_src );
+    picture_Release( p_ref );
+    picture_Release( p_dst );
+}
+
+static void bench( vlc_object_t *p_obj, vlc_fourcc_t i_dst_chroma,
+                   vlc_fourcc_t i_src_chroma, bool b_bgr )
+{
+    const unsigned i_width = 1920, i_height = 1080, i_loops = 20;
+    picture_t *p_dst = NewPicture( i_dst_chroma, i_width, i_height, b_bgr );
+    picture_t *p_src = NewPicture( i_src_chroma, i_width, i_height, false );
+
+    SetAlpha( p_src );
+
+    filter_t *p_blend = NewBlend( p_obj, p_dst, p_src );
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < i_loops; i++ )
+        p_blend->pf_video_blend( p_blend, p_dst, p_src, 0, 0, 200 );
+    mtime_t elapsed = mdate() - start;
+    DeleteBlend( p_blend );
+
+    log( "%4.4s onto %4.4s%s: %.1f Mpix/s\n", (const char *)&i_src_chroma,
+         (const char *)&i_dst_chroma,
+         i_dst_chroma == VLC_CODEC_RGB32 && !b_bgr ? " (RGB order)" : "",
+         elapsed > 0 ? (double)i_loops * i_width * i_height / elapsed : 0. );
+
+    picture_Release( p_src );
+    picture_Release( p_dst );
+}
+
+int main( void )
+{
+    static const struct
+    {
+        vlc_fourcc_t i_dst;
+        vlc_fourcc_t i_src;
+        bool b_bgr;
+    } combinations[] = {
+        { VLC_CODEC_I420, VLC_CODEC_YUVA, false },
+        { VLC_CODEC_I420, VLC_CODEC_RGBA, false },
+        { VLC_CODEC_YV12, VLC_CODEC_YUVA, false },
+        { VLC_CODEC_YV12, VLC_CODEC_RGBA, false },
+        { VLC_CODEC_NV12, VLC_CODEC_YUVA, false },
+        { VLC_CODEC_NV12, VLC_CODEC_RGBA, false },
+        { VLC_CODEC_NV21, VLC_CODEC_YUVA, false },
+        { VLC_CODEC_NV21, VLC_CODEC_RGBA, false },
+        { VLC_CODEC_RGB32, VLC_CODEC_RGBA, true },
+        { VLC_CODEC_RGB32, VLC_CODEC_RGBA, false },
+    };
+    static const unsigned sizes[][4] = {
+        /* width, height, x, y */
+        { 1, 1, 0, 0 }, { 1, 1, 1, 1 }, { 37, 23, 0, 0 }, { 37, 23, 1, 1 },
+        { 37, 23, 3, 2 }, { 40, 30, 40, 30 }, { 67, 45, 0, 0 },
+        { 80, 60, 5, 3 },
+    };
+
+    test_init();
+    srand( 42 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    for( unsigned i = 0; i < ARRAY_SIZE(combinations); i++ )
+    {
+        for( unsigned j = 0; j < ARRAY_SIZE(sizes); j++ )
+        {
+            check( p_obj, combinations[i].i_dst, combinations[i].i_src,
+                   combinations[i].b_bgr, sizes[j][0], sizes[j][1],
+                   sizes[j][2], sizes[j][3], 255 );
+            check( p_obj, combinations[i].i_dst, combinations[i].i_src,
+                   combinations[i].b_bgr, sizes[j][0], sizes[j][1],
+                   sizes[j][2], sizes[j][3], 97 );
+        }
+        bench( p_obj, combinations[i].i_dst, combinations[i].i_src,
+               combinations[i].b_bgr );
+    }
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * deinterlace.c: deinterlace filter slices tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+
+#define FRAMES 8
+
+static picture_t *NewPicture( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static filter_t *NewDeinterlace( libvlc_instance_t *p_vlc,
+                                 const video_format_t *p_fmt,
+                                 const char *psz_mode, int i_chroma_mode )
+{
+    filter_t *p_filter = vlc_object_create( p_vlc->p_libvlc_int,
+                                            sizeof(*p_filter) );
+    assert( p_filter != NULL );
+
+    es_format_Init( &p_filter->fmt_in, VIDEO_ES, p_fmt->i_chroma );
+    video_format_Copy( &p_filter->fmt_in.video, p_fmt );
+    es_format_Copy( &p_filter->fmt_out, &p_filter->fmt_in );
+    p_filter->owner.video.buffer_new = NewPicture;
+    p_filter->b_allow_fmt_out_change = true;
+
+    var_Create( p_filter, "sout-deinterlace-mode", VLC_VAR_STRING );
+    var_SetString( p_filter, "sout-deinterlace-mode", psz_mode );
+    var_Create( p_filter, "sout-deinterlace-phosphor-chroma",
+                VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "sout-deinterlace-phosphor-chroma",
+                    i_chroma_mode );
+
+    p_filter->p_module = module_need( p_filter, "video filter",
+                                      "deinterlace", true );
+    assert( p_filter->p_module != NULL );
+    return p_filter;
+}
+
+static void DeleteDeinterlace( filter_t *p_filter )
+{
+    module_unneed( p_filter, p_filter->p_module );
+    es_format_Clean( &p_filter->fmt_in );
+    es_format_Clean( &p_filter->fmt_out );
+    vlc_object_release( p_filter );
+}
+
+/* Interlaced frame: each field shows a noisy moving pattern at a different
+ * instant, so that there are both still and combed areas. The margins are
+ * filled too, as some algorithms read a few pixels out of the picture. */
+static picture_t *NewFrame( const video_format_t *p_fmt, int i_frame,
+                            unsigned i_seed )
+{
+    picture_t *p_pic = picture_NewFromFormat( p_fmt );
+    assert( p_pic != NULL );
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+        {
+            const int t = 2 * i_frame + (y & 1);
+
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                int v = (x * 255) / p->i_visible_pitch;
+                if( ((x + 8 * t) / 32 + y / 16) % 2 )
+                    v = 255 - v;
+                i_seed = i_seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = v ^ ((i_seed >> 16) & 7);
+            }
+        }
+    }
+
+    p_pic->date = VLC_TS_0 + i_frame * CLOCK_FREQ / 25;
+    p_pic->b_progressive = false;
+    p_pic->b_top_field_first = true;
+    p_pic->i_nb_fields = 2;
+    return p_pic;
+}
+
+static void Compare( const picture_t *p_ref, const picture_t *p_pic,
+                     const char *psz_mode, int i_frame )
+{
+    assert( p_ref->i_planes == p_pic->i_planes );
+
+    for( int i = 0; i < p_ref->i_planes; i++ )
+    {
+        const plane_t *r = &p_ref->p[i], *p = &p_pic->p[i];
+
+        assert( r->i_visible_lines == p->i_visible_lines );
+        for( int y = 0; y < r->i_visible_lines; y++ )
+            if( memcmp( &r->p_pixels[y * r->i_pitch],
+                        &p->p_pixels[y * p->i_pitch], r->i_visible_pitch ) )
+            {
+                fprintf( stderr, "%s: frame %d, plane %d, line %d mismatch\n",
+                         psz_mode, i_frame, i, y );
+                abort();
+            }
+    }
+}
+
+/* The output must not depend on how the pictures are sliced */
+static void check( libvlc_instance_t *p_single, libvlc_instance_t *p_multi,
+                   vlc_fourcc_t i_chroma, unsigned i_width, unsigned i_height,
+                   const char *psz_mode, int i_chroma_mode )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+
+    log( "Testing %s on %ux%u %4.4s\n", psz_mode, i_width, i_height,
+         (const char *)&i_chroma );
+
+    filter_t *p_ref = NewDeinterlace( p_single, &fmt, psz_mode,
+                                      i_chroma_mode );
+    filter_t *p_filter = NewDeinterlace( p_multi, &fmt, psz_mode,
+                                         i_chroma_mode );
+
+    for( int k = 0; k < FRAMES; k++ )
+    {
+        picture_t *p_out_ref = p_ref->pf_video_filter( p_ref,
+                                                       NewFrame( &fmt, k, k ) );
+        picture_t *p_out = p_filter->pf_video_filter( p_filter,
+                                                      NewFrame( &fmt, k, k ) );
+
+        assert( (p_out_ref == NULL) == (p_out == NULL) );
+        while( p_out_ref != NULL )
+        {
+            assert( p_out != NULL );
+            Compare( p_out_ref, p_out, psz_mode, k );
+
+            picture_t *p_next_ref = p_out_ref->p_next;
+            picture_t *p_next = p_out->p_next;
+            picture_Release( p_out_ref );
+            picture_Release( p_out );
+            p_out_ref = p_next_ref;
+            p_out = p_next;
+        }
+        assert( p_out == NULL );
+    }
+
+    DeleteDeinterlace( p_ref );
+    DeleteDeinterlace( p_filter );
+}
+
+int main( void )
+{
+    static const char *const modes[] = {
+        "discard", "blend", "mean", "bob", "linear", "x",
+        "yadif", "yadif2x", "phosphor", "ivtc",
+    };
+    static const unsigned sizes[][2] = {
+        { 64, 2 }, { 70, 48 }, { 352, 288 },
+    };
+    const char *args[test_defaults_nargs + 1];
+
+    test_init();
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+
+    args[test_defaults_nargs] = "--filter-threads=1";
+    libvlc_instance_t *p_single = libvlc_new( test_defaults_nargs + 1, args );
+    args[test_defaults_nargs] = "--filter-threads=4";
+    libvlc_instance_t *p_multi = libvlc_new( test_defaults_nargs + 1, args );
+    assert( p_single != NULL && p_multi != NULL );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(modes); i++ )
+        for( unsigned j = 0; j < ARRAY_SIZE(sizes); j++ )
+        {
+            check( p_single, p_multi, VLC_CODEC_I420, sizes[j][0],
+                   sizes[j][1], modes[i], 2 );
+            check( p_single, p_multi, VLC_CODEC_I422, sizes[j][0],
+                   sizes[j][1], modes[i], 2 );
+        }
+
+    /* Odd heights (X reads beyond the visible lines there) */
+    for( unsigned i = 0; i < ARRAY_SIZE(modes); i++ )
+        if( strcmp( modes[i], "x" ) && strncmp( modes[i], "yadif", 5 ) )
+            check( p_single, p_multi, VLC_CODEC_I420, 71, 35, modes[i], 2 );
+
+    /* 4:2:0 chroma handling of the phosphor field composition */
+    for( int i_chroma_mode = 1; i_chroma_mode <= 4; i_chroma_mode++ )
+        check( p_single, p_multi, VLC_CODEC_I420, 352, 288, "phosphor",
+               i_chroma_mode );
+    check( p_single, p_multi, VLC_CODEC_YV12, 352, 288, "phosphor", 4 );
+
+    /* 16-bit line filters */
+    check( p_single, p_multi, VLC_CODEC_I420_10L, 352, 288, "yadif2x", 2 );
+    check( p_single, p_multi, VLC_CODEC_I420_10L, 352, 288, "linear", 2 );
+
+    /* Packed formats only support the basic modes */
+    check( p_single, p_multi, VLC_CODEC_NV12, 352, 288, "linear", 2 );
+    check( p_single, p_multi, VLC_CODEC_YUYV, 352, 288, "bob", 2 );
+
+    libvlc_release( p_multi );
+    libvlc_release( p_single );
+    return 0;
+}
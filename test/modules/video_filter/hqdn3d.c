@@ -0,0 +1,261 @@
+/*****************************************************************************
+ * hqdn3d.c: hqdn3d denoiser bit-exactness tests
+ *****************************************************************************
+ * Copyright (C) 2003 Daniel Moreno <comac@comac.darktech.org>
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "../modules/video_filter/hqdn3d.h"
+
+/* The original scalar implementation, used as the reference */
+static unsigned int ref_LowPassMul(unsigned int PrevMul, unsigned int CurrMul, int* Coef){
+//    int dMul= (PrevMul&0xFFFFFF)-(CurrMul&0xFFFFFF);
+    int dMul= PrevMul-CurrMul;
+    unsigned int d=((dMul+0x10007FF)>>12);
+    return CurrMul + Coef[d];
+}
+
+static void ref_deNoiseTemporal(
+                    unsigned char *Frame,        // mpi->planes[x]
+                    unsigned char *FrameDest,    // dmpi->planes[x]
+                    unsigned short *FrameAnt,
+                    int W, int H, int sStride, int dStride,
+                    int *Temporal)
+{
+    unsigned int PixelDst;
+
+    for (long Y = 0; Y < H; Y++){
+        for (long X = 0; X < W; X++){
+            PixelDst = ref_LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
+            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        Frame += sStride;
+        FrameDest += dStride;
+        FrameAnt += W;
+    }
+}
+
+static void ref_deNoiseSpacial(
+                    unsigned char *Frame,        // mpi->planes[x]
+                    unsigned char *FrameDest,    // dmpi->planes[x]
+                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
+                    int W, int H, int sStride, int dStride,
+                    int *Horizontal, int *Vertical)
+{
+    long sLineOffs = 0, dLineOffs = 0;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
+
+    /* First pixel has no left nor top neighbor. */
+    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
+    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+
+    /* First line has no top neighbor, only left. */
+    for (long X = 1; X < W; X++){
+        PixelDst = LineAnt[X] = ref_LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+
+    for (long Y = 1; Y < H; Y++){
+        unsigned int PixelAnt;
+        sLineOffs += sStride, dLineOffs += dStride;
+        /* First pixel on each line doesn't have previous pixel */
+        PixelAnt = Frame[sLineOffs]<<16;
+        PixelDst = LineAnt[0] = ref_LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        for (long X = 1; X < W; X++){
+            unsigned int PixelDst;
+            /* The rest are normal */
+            PixelAnt = ref_LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            PixelDst = LineAnt[X] = ref_LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+}
+
+static void ref_deNoise(unsigned char *Frame,        // mpi->planes[x]
+                    unsigned char *FrameDest,    // dmpi->planes[x]
+                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
+                    unsigned short **FrameAntPtr,
+                    int W, int H, int sStride, int dStride,
+                    int *Horizontal, int *Vertical, int *Temporal)
+{
+    long sLineOffs = 0, dLineOffs = 0;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
+    unsigned short* FrameAnt=(*FrameAntPtr);
+
+    if(!FrameAnt){
+        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
+        if(!FrameAnt)
+            return;
+        for (long Y = 0; Y < H; Y++){
+            unsigned short* dst=&FrameAnt[Y*W];
+            unsigned char* src=Frame+Y*sStride;
+            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
+        }
+    }
+
+    if(!Horizontal[0] && !Vertical[0]){
+        ref_deNoiseTemporal(Frame, FrameDest, FrameAnt,
+                        W, H, sStride, dStride, Temporal);
+        return;
+    }
+    if(!Temporal[0]){
+        ref_deNoiseSpacial(Frame, FrameDest, LineAnt,
+                       W, H, sStride, dStride, Horizontal, Vertical);
+        return;
+    }
+
+    /* First pixel has no left nor top neighbor. Only previous frame */
+    LineAnt[0] = PixelAnt = Frame[0]<<16;
+    PixelDst = ref_LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
+    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
+    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+
+    /* First line has no top neighbor. Only left one for each pixel and
+     * last frame */
+    for (long X = 1; X < W; X++){
+        LineAnt[X] = PixelAnt = ref_LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        PixelDst = ref_LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+
+    for (long Y = 1; Y < H; Y++){
+        unsigned int PixelAnt;
+        unsigned short* LinePrev=&FrameAnt[Y*W];
+        sLineOffs += sStride, dLineOffs += dStride;
+        /* First pixel on each line doesn't have previous pixel */
+        PixelAnt = Frame[sLineOffs]<<16;
+        LineAnt[0] = ref_LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        PixelDst = ref_LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
+        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        for (long X = 1; X < W; X++){
+            unsigned int PixelDst;
+            /* The rest are normal */
+            PixelAnt = ref_LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            LineAnt[X] = ref_LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            PixelDst = ref_LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+}
+
+#define FRAMES 8
+
+/* Noisy gradient frames, with some moving content */
+static void fill( unsigned char *p, int i_width, int i_height, int i_stride,
+                  int i_frame )
+{
+    for( int y = 0; y < i_height; y++ )
+        for( int x = 0; x < i_width; x++ )
+        {
+            int v = ((x + y) * 255) / (i_width + i_height)
+                  + (rand() % 31) - 15;
+            if( ((x + 4 * i_frame) / 16 + y / 16) % 5 == 0 )
+                v = 255 - v;
+            p[y * i_stride + x] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+}
+
+static void test_size( int W, int H, const double dist[3] )
+{
+    const int i_stride = W + 7;
+    unsigned char *p_src = malloc( i_stride * H * FRAMES );
+    unsigned char *p_ref = malloc( i_stride * H );
+    unsigned char *p_dst = malloc( i_stride * H );
+    unsigned int *p_line_ref = malloc( W * sizeof(unsigned int) );
+    unsigned int *p_line = malloc( W * sizeof(unsigned int) );
+    unsigned int *p_line_cur =
+        malloc( HQDN3D_ROWS * W * sizeof(unsigned int) );
+    static int coefs[3][512*16];
+    unsigned short *p_ant_ref = NULL, *p_ant = NULL;
+
+    assert( p_src && p_ref && p_dst && p_line_ref && p_line && p_line_cur );
+
+    for( int k = 0; k < 3; k++ )
+        PrecalcCoefs( coefs[k], dist[k] );
+    for( int f = 0; f < FRAMES; f++ )
+        fill( &p_src[f * i_stride * H], W, H, i_stride, f );
+
+    for( int f = 0; f < FRAMES; f++ )
+    {
+        unsigned char *p_frame = &p_src[f * i_stride * H];
+
+        ref_deNoise( p_frame, p_ref, p_line_ref, &p_ant_ref, W, H,
+                     i_stride, i_stride, coefs[0], coefs[1], coefs[2] );
+        deNoise( p_frame, p_dst, p_line, p_line_cur, &p_ant, W, H,
+                 i_stride, i_stride, coefs[0], coefs[1], coefs[2] );
+        assert( p_ant_ref != NULL && p_ant != NULL );
+
+        for( int y = 0; y < H; y++ )
+            if( memcmp( &p_ref[y * i_stride], &p_dst[y * i_stride], W ) )
+            {
+                fprintf( stderr, "%dx%d (%.1f %.1f %.1f) mismatch at "
+                         "frame %d line %d\n", W, H,
+                         dist[0], dist[1], dist[2], f, y );
+                abort();
+            }
+        assert( !memcmp( p_ant_ref, p_ant, W * H * sizeof(*p_ant) ) );
+    }
+
+    free( p_ant_ref );
+    free( p_ant );
+    free( p_line_cur );
+    free( p_line );
+    free( p_line_ref );
+    free( p_dst );
+    free( p_ref );
+    free( p_src );
+}
+
+int main( void )
+{
+    static const int sizes[][2] = {
+        { 1, 1 }, { 7, 3 }, { 8, 2 }, { 17, 9 }, { 33, 16 }, { 12, 17 }, { 176, 144 },
+        { 359, 287 },
+    };
+    static const double dists[][3] = {
+        { PARAM1_DEFAULT, PARAM1_DEFAULT, PARAM3_DEFAULT }, /* all */
+        { PARAM2_DEFAULT, PARAM2_DEFAULT, 0. }, /* spatial only */
+        { 0., 0., PARAM3_DEFAULT }, /* temporal only */
+        { 254., 254., 254. },
+    };
+
+    srand( 42 );
+
+    for( unsigned j = 0; j < ARRAY_SIZE(sizes); j++ )
+        for( unsigned k = 0; k < ARRAY_SIZE(dists); k++ )
+            test_size( sizes[j][0], sizes[j][1], dists[k] );
+    return 0;
+}
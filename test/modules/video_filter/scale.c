@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * scale.c: polyphase scaler tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../simd.h"
+#include "../modules/video_filter/scale.h"
+
+static const struct
+{
+    const char *psz_name;
+    scale_kernels_t kernels;
+    bool (*pf_usable)( void );
+} impls[] = {
+    { "C", { scale_h_C, scale_v_C }, NULL },
+#ifdef HAVE_SSE2_INTRINSICS
+    { "SSE2", { scale_h_SSE2, scale_v_SSE2 }, cpu_sse2 },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "AVX2", { scale_h_AVX2, scale_v_AVX2 }, cpu_avx2 },
+#endif
+#ifdef SCALE_NEON
+    { "NEON", { scale_h_NEON, scale_v_NEON }, cpu_neon },
+#endif
+};
+
+typedef struct
+{
+    unsigned i_width, i_height;
+    uint8_t *p_pixels;
+} plane_buf_t;
+
+static void plane_Init( plane_buf_t *p, unsigned i_width, unsigned i_height )
+{
+    p->i_width = i_width;
+    p->i_height = i_height;
+    p->p_pixels = malloc( i_width * i_height );
+    assert( p->p_pixels != NULL );
+}
+
+/* Both passes on a whole plane, the same way as ScaleSlice() */
+static void scale( const scale_kernels_t *k, plane_buf_t *p_dst,
+                   const plane_buf_t *p_src, int i_mode )
+{
+    scale_table_t h, v;
+
+    assert( scale_table_Init( &h, i_mode, p_src->i_width, p_dst->i_width ) == 0 );
+    assert( scale_table_Init( &v, i_mode, p_src->i_height, p_dst->i_height ) == 0 );
+
+    int16_t *p_tmp = malloc( p_src->i_height * h.i_size * sizeof(*p_tmp) );
+    uint8_t *p_pad = calloc( h.i_taps, 1 );
+    assert( p_tmp != NULL && p_pad != NULL );
+
+    for( unsigned y = 0; y < p_src->i_height; y++ )
+    {
+        const uint8_t *p_in = &p_src->p_pixels[y * p_src->i_width];
+        if( h.i_taps > p_src->i_width )
+        {
+            memcpy( p_pad, p_in, p_src->i_width );
+            p_in = p_pad;
+        }
+        k->pf_h( &p_tmp[y * h.i_size], p_in, &h );
+    }
+
+    for( unsigned y = 0; y < v.i_size; y++ )
+    {
+        const int16_t *pp_lines[v.i_taps];
+        int16_t pi_coefs[v.i_taps];
+
+        for( unsigned i = 0; i < v.i_taps; i++ )
+        {
+            unsigned i_row = __MIN( v.pi_pos[y] + i, p_src->i_height - 1 );
+            pp_lines[i] = &p_tmp[i_row * h.i_size];
+            pi_coefs[i] = SCALE_COEF(&v, y, i);
+        }
+        k->pf_v( &p_dst->p_pixels[y * p_dst->i_width], pp_lines, pi_coefs,
+                 v.i_taps, p_dst->i_width );
+    }
+
+    free( p_pad );
+    free( p_tmp );
+    scale_table_Clean( &h );
+    scale_table_Clean( &v );
+}
+
+static void check_table( int i_mode, unsigned i_src, unsigned i_dst )
+{
+    scale_table_t t;
+
+    assert( scale_table_Init( &t, i_mode, i_src, i_dst ) == 0 );
+    assert( t.i_size == i_dst );
+    assert( (t.i_taps & 3) == 0 );
+
+    for( unsigned x = 0; x < i_dst; x++ )
+    {
+        int i_sum = 0;
+
+        assert( t.pi_pos[x] >= 0 );
+        assert( t.i_taps > i_src || t.pi_pos[x] + t.i_taps <= i_src );
+        for( unsigned i = 0; i < t.i_taps; i++ )
+        {
+            i_sum += SCALE_COEF(&t, x, i);
+            /* no weight on samples outside of the input */
+            assert( t.pi_pos[x] + i < i_src || SCALE_COEF(&t, x, i) == 0 );
+        }
+        assert( i_sum == 1 << SCALE_COEF_BITS );
+    }
+    scale_table_Clean( &t );
+}
+
+/* Interleaved components are filtered like separate planes */
+static void check_packed( int i_mode, unsigned i_src, unsigned i_dst )
+{
+    scale_table_t t;
+    uint8_t in[4 * i_src], plane[i_src];
+    int16_t out[4 * i_dst], ref[i_dst];
+
+    assert( scale_table_Init( &t, i_mode, i_src, i_dst ) == 0 );
+    for( unsigned i = 0; i < 4 * i_src; i++ )
+        in[i] = rand();
+
+    scale_h_packed_C( out, in, &t );
+    for( unsigned c = 0; c < 4; c++ )
+    {
+        for( unsigned x = 0; x < i_src; x++ )
+            plane[x] = in[4 * x + c];
+        scale_h_C( ref, plane, &t );
+        for( unsigned x = 0; x < i_dst; x++ )
+            assert( out[4 * x + c] == ref[x] );
+    }
+    scale_table_Clean( &t );
+}
+
+static void test( int i_mode, unsigned i_src_width, unsigned i_src_height,
+                  unsigned i_dst_width, unsigned i_dst_height )
+{
+    plane_buf_t src, ref, dst;
+
+    check_table( i_mode, i_src_width, i_dst_width );
+    check_table( i_mode, i_src_height, i_dst_height );
+
+    plane_Init( &src, i_src_width, i_src_height );
+    plane_Init( &ref, i_dst_width, i_dst_height );
+    plane_Init( &dst, i_dst_width, i_dst_height );
+
+    /* A flat picture stays flat */
+    memset( src.p_pixels, 0xA5, i_src_width * i_src_height );
+    scale( &impls[0].kernels, &ref, &src, i_mode );
+    for( unsigned i = 0; i < i_dst_width * i_dst_height; i++ )
+        assert( ref.p_pixels[i] == 0xA5 );
+
+    /* Sharp edges make bicubic over- and undershoot */
+    for( unsigned i = 0; i < i_src_width * i_src_height; i++ )
+        src.p_pixels[i] = (rand() & 1) ? 255 : rand() & 3;
+    scale( &impls[0].kernels, &ref, &src, i_mode );
+
+    for( unsigned i = 1; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        scale( &impls[i].kernels, &dst, &src, i_mode );
+        if( memcmp( ref.p_pixels, dst.p_pixels, i_dst_width * i_dst_height ) )
+        {
+            fprintf( stderr, "%s: %ux%u -> %ux%u mode %d mismatch\n",
+                     impls[i].psz_name, i_src_width, i_src_height,
+                     i_dst_width, i_dst_height, i_mode );
+            abort();
+        }
+    }
+
+    free( src.p_pixels );
+    free( ref.p_pixels );
+    free( dst.p_pixels );
+}
+
+static void bench( int i_mode, unsigned i_src_width, unsigned i_src_height,
+                   unsigned i_dst_width, unsigned i_dst_height )
+{
+    plane_buf_t src, dst;
+
+    plane_Init( &src, i_src_width, i_src_height );
+    plane_Init( &dst, i_dst_width, i_dst_height );
+    for( unsigned i = 0; i < i_src_width * i_src_height; i++ )
+        src.p_pixels[i] = rand();
+
+    printf( "%ux%u -> %ux%u %s:", i_src_width, i_src_height,
+            i_dst_width, i_dst_height,
+            i_mode == SCALE_BICUBIC ? "bicubic" : "bilinear" );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(impls); i++ )
+    {
+        if( !cpu_usable( impls[i].pf_usable ) )
+            continue;
+
+        mtime_t start = mdate();
+        for( int k = 0; k < 10; k++ )
+            scale( &impls[i].kernels, &dst, &src, i_mode );
+
+        printf( " %s %4"PRId64" fps", impls[i].psz_name,
+                bench_rate( start, 10 ) );
+    }
+    printf( "\n" );
+
+    free( src.p_pixels );
+    free( dst.p_pixels );
+}
+
+int main( void )
+{
+    static const unsigned sizes[][4] = {
+        { 1, 1, 1, 1 }, { 1, 1, 7, 5 }, { 3, 2, 1, 1 }, { 5, 7, 3, 9 },
+        { 16, 16, 16, 16 }, { 17, 13, 71, 35 }, { 71, 35, 17, 13 },
+        { 100, 100, 9, 7 }, { 720, 576, 1024, 576 }, { 1920, 1080, 33, 31 },
+    };
+
+    srand( 42 );
+
+    if( test_bench )
+    {
+        bench( SCALE_BICUBIC, 1920, 1080, 1280, 720 );
+        bench( SCALE_BICUBIC, 1920, 1080, 640, 360 );
+        bench( SCALE_BILINEAR, 1280, 720, 1920, 1080 );
+        return 0;
+    }
+
+    for( unsigned j = 0; j < ARRAY_SIZE(sizes); j++ )
+    {
+        test( SCALE_BILINEAR, sizes[j][0], sizes[j][1],
+              sizes[j][2], sizes[j][3] );
+        test( SCALE_BICUBIC, sizes[j][0], sizes[j][1],
+              sizes[j][2], sizes[j][3] );
+    }
+
+    check_packed( SCALE_BILINEAR, 64, 37 );
+    check_packed( SCALE_BICUBIC, 37, 64 );
+    return 0;
+}
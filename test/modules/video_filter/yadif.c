@@ -0,0 +1,263 @@
+/*****************************************************************************
+ * yadif.c: Yadif line filters tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../simd.h"
+#include "../modules/video_filter/deinterlace/common.h"
+#include "../modules/video_filter/deinterlace/yadif.h"
+
+typedef void (*yadif_8bit)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                           int, int, int, int, int);
+typedef void (*yadif_16bit)(uint16_t *, uint16_t *, uint16_t *, uint16_t *,
+                            int, int, int, int, int);
+
+static const struct
+{
+    const char *psz_name;
+    unsigned i_pixel_size;
+    union
+    {
+        yadif_8bit pf_8bit;
+        yadif_16bit pf_16bit;
+    };
+    bool (*pf_usable)( void );
+} filters[] = {
+    { "C", 1, { .pf_8bit = yadif_filter_line_c }, NULL },
+#ifdef HAVE_YADIF_MMX
+    { "MMX", 1, { .pf_8bit = yadif_filter_line_mmx }, cpu_mmx },
+#endif
+#ifdef HAVE_YADIF_SSE2
+    { "SSE2", 1, { .pf_8bit = yadif_filter_line_sse2 }, cpu_sse2 },
+#endif
+#ifdef HAVE_YADIF_SSSE3
+    { "SSSE3", 1, { .pf_8bit = yadif_filter_line_ssse3 }, cpu_ssse3 },
+#endif
+#ifdef HAVE_YADIF_AVX2
+    { "AVX2", 1, { .pf_8bit = yadif_filter_line_avx2 }, cpu_avx2 },
+#endif
+    { "C", 2, { .pf_16bit = yadif_filter_line_c_16bit }, NULL },
+#ifdef HAVE_YADIF_SSE4_1
+    { "SSE4.1", 2, { .pf_16bit = yadif_filter_line_16bit_sse4_1 }, cpu_sse4_1 },
+#endif
+#ifdef HAVE_YADIF_AVX2
+    { "AVX2", 2, { .pf_16bit = yadif_filter_line_16bit_avx2 }, cpu_avx2 },
+#endif
+};
+
+/* Lines of padding above and below the pictures, and pixels after them */
+#define MARGIN 4
+#define PADDING 64
+
+typedef struct
+{
+    uint8_t *p_buffer;
+    uint8_t *p_pixels;
+    int i_pitch;
+} frame_t;
+
+static void frame_Init( frame_t *f, int i_width, int i_height,
+                        unsigned i_pixel_size )
+{
+    f->i_pitch = i_width * i_pixel_size + PADDING;
+    f->p_buffer = calloc( i_height + 2 * MARGIN, f->i_pitch );
+    assert( f->p_buffer != NULL );
+    f->p_pixels = f->p_buffer + MARGIN * f->i_pitch;
+}
+
+/* Synthetic interlaced frame: each field shows a noisy moving pattern at a
+ * different instant, so that there are both still and combed areas. */
+static void frame_Fill( frame_t *f, int i_width, int i_height,
+                        unsigned i_pixel_size, int i_depth, int i_frame )
+{
+    const int i_max = (1 << i_depth) - 1;
+
+    for( int y = 0; y < i_height; y++ )
+    {
+        const int t = 2 * i_frame + (y & 1);
+
+        for( int x = 0; x < i_width; x++ )
+        {
+            int v = (x * i_max) / i_width;
+            if( x > i_width / 2 && ((x + 8 * t) / 32 + y / 32) % 2 )
+                v = i_max - v;
+            v += (rand() % 9) - 4;
+            v = v < 0 ? 0 : v > i_max ? i_max : v;
+
+            if( i_pixel_size == 2 )
+                ((uint16_t *)&f->p_pixels[y * f->i_pitch])[x] = v;
+            else
+                f->p_pixels[y * f->i_pitch + x] = v;
+        }
+    }
+}
+
+/* Same loop as RenderYadif() */
+static void deinterlace( unsigned i, frame_t *dst, frame_t frames[3],
+                         int i_width, int i_height, int i_field, int parity )
+{
+    const unsigned i_pixel_size = filters[i].i_pixel_size;
+
+    for( int y = 1; y < i_height - 1; y++ )
+    {
+        if( (y % 2) == i_field )
+            continue;
+
+        const int i_pitch = frames[1].i_pitch;
+        int mode = (y >= 2 && y < i_height - 2) ? 0 : 2;
+        int prefs = y < i_height - 2 ? i_pitch : -i_pitch;
+        int mrefs = y - 1 ? -i_pitch : i_pitch;
+        uint8_t *d = &dst->p_pixels[y * dst->i_pitch];
+        uint8_t *prev = &frames[0].p_pixels[y * i_pitch];
+        uint8_t *cur = &frames[1].p_pixels[y * i_pitch];
+        uint8_t *next = &frames[2].p_pixels[y * i_pitch];
+
+        if( i_pixel_size == 2 )
+            filters[i].pf_16bit( (uint16_t *)d, (uint16_t *)prev,
+                                 (uint16_t *)cur, (uint16_t *)next, i_width,
+                                 prefs, mrefs, parity, mode );
+        else
+            filters[i].pf_8bit( d, prev, cur, next, i_width,
+                                prefs, mrefs, parity, mode );
+    }
+}
+
+static void test( unsigned i_pixel_size, int i_depth, int i_width,
+                  int i_height )
+{
+    frame_t frames[4], ref, dst;
+    unsigned i_ref = 0;
+
+    /* the C version comes first */
+    while( filters[i_ref].i_pixel_size != i_pixel_size )
+        i_ref++;
+
+    frame_Init( &ref, i_width, i_height, i_pixel_size );
+    frame_Init( &dst, i_width, i_height, i_pixel_size );
+    for( int k = 0; k < 4; k++ )
+    {
+        frame_Init( &frames[k], i_width, i_height, i_pixel_size );
+        frame_Fill( &frames[k], i_width, i_height, i_pixel_size, i_depth, k );
+    }
+
+    for( unsigned i = 0; i < ARRAY_SIZE(filters); i++ )
+    {
+        if( filters[i].i_pixel_size != i_pixel_size
+         || !cpu_usable( filters[i].pf_usable ) )
+            continue;
+
+        for( int k = 0; k < 2; k++ )
+            for( int parity = 0; parity < 2; parity++ )
+            {
+                const int i_field = 1 - parity;
+
+                deinterlace( i_ref, &ref, &frames[k], i_width, i_height,
+                             i_field, parity );
+                deinterlace( i, &dst, &frames[k], i_width, i_height,
+                             i_field, parity );
+
+                for( int y = 1; y < i_height - 1; y++ )
+                    if( (y % 2) != i_field
+                     && memcmp( &ref.p_pixels[y * ref.i_pitch],
+                                &dst.p_pixels[y * dst.i_pitch],
+                                i_width * i_pixel_size ) )
+                    {
+                        fprintf( stderr, "%s %d-bit: %dx%d mismatch at "
+                                 "line %d\n", filters[i].psz_name, i_depth,
+                                 i_width, i_height, y );
+                        abort();
+                    }
+            }
+    }
+
+    for( int k = 0; k < 4; k++ )
+        free( frames[k].p_buffer );
+    free( dst.p_buffer );
+    free( ref.p_buffer );
+}
+
+static void bench( unsigned i_pixel_size, int i_depth, int i_width,
+                   int i_height )
+{
+    frame_t frames[3], dst;
+
+    frame_Init( &dst, i_width, i_height, i_pixel_size );
+    for( int k = 0; k < 3; k++ )
+    {
+        frame_Init( &frames[k], i_width, i_height, i_pixel_size );
+        frame_Fill( &frames[k], i_width, i_height, i_pixel_size, i_depth, k );
+    }
+
+    printf( "%dx%d %d-bit:", i_width, i_height, i_depth );
+    for( unsigned i = 0; i < ARRAY_SIZE(filters); i++ )
+    {
+        if( filters[i].i_pixel_size != i_pixel_size
+         || !cpu_usable( filters[i].pf_usable ) )
+            continue;
+
+        mtime_t start = mdate();
+        for( int k = 0; k < 25; k++ )
+            deinterlace( i, &dst, frames, i_width, i_height,
+                         k % 2, 1 - k % 2 );
+
+        printf( " %s %4"PRId64" fields/s", filters[i].psz_name,
+                bench_rate( start, 25 ) );
+    }
+    printf( "\n" );
+
+    for( int k = 0; k < 3; k++ )
+        free( frames[k].p_buffer );
+    free( dst.p_buffer );
+}
+
+int main( void )
+{
+    static const int sizes[][2] = {
+        { 1, 3 }, { 5, 6 }, { 17, 9 }, { 33, 17 }, { 720, 576 },
+    };
+
+    srand( 42 );
+
+    if( test_bench )
+    {
+        bench( 1, 8, 1920, 1080 );
+        bench( 2, 10, 1920, 1080 );
+        return 0;
+    }
+
+    for( unsigned j = 0; j < ARRAY_SIZE(sizes); j++ )
+    {
+        test( 1, 8, sizes[j][0], sizes[j][1] );
+        test( 2, 10, sizes[j][0], sizes[j][1] );
+        test( 2, 16, sizes[j][0], sizes[j][1] );
+    }
+    return 0;
+}
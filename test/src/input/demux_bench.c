@@ -0,0 +1,188 @@
+/*****************************************************************************
+ * demux_bench.c: demuxer throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Usage: test_src_input_demux_bench [-d demux] [-n runs] file...
+ *
+ * Demuxes each file with all elementary streams selected and discards the
+ * output, then prints the throughput. With the TS demuxer (the default),
+ * the 188 bytes packets rate is printed too, e.g. to compare MPTS captures.
+ */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+struct es_out_sys_t
+{
+    unsigned i_es;
+    uint64_t i_blocks;
+};
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    (void) fmt;
+    /* Only used as a non-NULL handle */
+    return (es_out_id_t *)(uintptr_t)++out->p_sys->i_es;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *block )
+{
+    (void) id;
+    out->p_sys->i_blocks++;
+    block_Release( block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    (void) out;
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+            (void) va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int bench( libvlc_instance_t *p_vlc, const char *psz_demux,
+                  const char *psz_path )
+{
+    char *psz_url = vlc_path2uri( psz_path, NULL );
+    if( psz_url == NULL )
+        return -1;
+
+    vlc_object_t *obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+    stream_t *s = vlc_stream_NewURL( obj, psz_url );
+    free( psz_url );
+    if( s == NULL )
+    {
+        fprintf( stderr, "%s: cannot open\n", psz_path );
+        return -1;
+    }
+
+    struct es_out_sys_t sys = { 0, 0 };
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+        .p_sys = &sys,
+    };
+
+    mtime_t start = mdate();
+    demux_t *p_demux = demux_New( obj, psz_demux, psz_path, s, &out );
+    if( p_demux == NULL )
+    {
+        fprintf( stderr, "%s: cannot demux with %s\n", psz_path, psz_demux );
+        vlc_stream_Delete( s );
+        return -1;
+    }
+
+    while( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+
+    mtime_t elapsed = mdate() - start;
+    uint64_t i_bytes = vlc_stream_Tell( s );
+
+    demux_Delete( p_demux );
+    vlc_stream_Delete( s );
+
+    if( elapsed <= 0 )
+        elapsed = 1;
+
+    printf( "%s: %"PRIu64" bytes, %u ES, %"PRIu64" blocks in %"PRId64" us: "
+            "%.1f MB/s", psz_path, i_bytes, sys.i_es, sys.i_blocks, elapsed,
+            (double) i_bytes / elapsed );
+    if( !strcmp( psz_demux, "ts" ) )
+        printf( ", %.0f packets/s",
+                (double) (i_bytes / 188) * CLOCK_FREQ / elapsed );
+    printf( "\n" );
+    return 0;
+}
+
+int main( int argc, char *argv[] )
+{
+    const char *psz_demux = "ts";
+    unsigned i_runs = 1;
+    int c;
+
+    while( (c = getopt( argc, argv, "d:n:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'd':
+                psz_demux = optarg;
+                break;
+            case 'n':
+                i_runs = atoi( optarg );
+                break;
+            default:
+                return 1;
+        }
+    }
+
+    if( optind >= argc )
+    {
+        fprintf( stderr, "Usage: %s [-d demux] [-n runs] file...\n", argv[0] );
+        return 77; /* skip */
+    }
+
+    setenv( "VLC_PLUGIN_PATH", "../modules", 0 );
+
+    const char * const args[] = {
+        "--ignore-config",
+        "-I",
+        "dummy",
+        "--no-media-library",
+        "--vout=dummy",
+        "--aout=dummy",
+    };
+
+    libvlc_instance_t *p_vlc = libvlc_new( sizeof(args) / sizeof(args[0]),
+                                           args );
+    if( p_vlc == NULL )
+        return 1;
+
+    int ret = 0;
+    for( int i = optind; i < argc; i++ )
+        for( unsigned j = 0; j < i_runs; j++ )
+            if( bench( p_vlc, psz_demux, argv[i] ) )
+                ret = 1;
+
+    libvlc_release( p_vlc );
+    return ret;
+}
@@ -182,7 +182,7 @@ stream_close( struct reader *p_reader )
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, bool b_mmap )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -194,12 +194,13 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        "--file-mmap",
     };
 
     p_reader = calloc( 1, sizeof(struct reader) );
     assert( p_reader );
 
-    p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]), argv );
+    p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]) - !b_mmap, argv );
     assert( p_vlc != NULL );
 
     p_reader->u.s = vlc_stream_NewURL( p_vlc->p_libvlc_int, psz_url );
@@ -216,7 +217,7 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = b_mmap ? "stream (mmap)" : "stream";
     return p_reader;
 }
 
@@ -328,6 +329,10 @@ test( struct reader **pp_readers, unsigned int i_readers, const char *psz_md5 )
     while( i_offset < i_size && ( i_ret = READ_AT( i_offset, 4096 ) ) > 0 )
         i_offset += i_ret + 1;
 
+    /* Test reading interleaved regions, as some demuxers do */
+    for( unsigned i = 0; i < 256; i++ )
+        READ_AT( (i % 5) * (i_size / 5) + (i / 5) * 1000, 1000 );
+
     /* Test seek and peek */
     READ_AT( 0, 42 );
     READ_AT( i_size - 5, 43 );
@@ -374,17 +379,18 @@ main( void )
     char *psz_url;
     int i_tmp_fd;
 
-    log( "Test random file with libc, and stream\n" );
+    log( "Test random file with libc, stream, and mmap stream\n" );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
     fill_rand( i_tmp_fd, RAND_FILE_SIZE );
     assert( i_tmp_fd != -1 );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
+    assert( ( pp_readers[1] = stream_open( psz_url, false ) ) );
+    assert( ( pp_readers[2] = stream_open( psz_url, true ) ) );
 
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    test( pp_readers, 3, NULL );
+    for( unsigned int i = 0; i < 3; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
     free( psz_url );
 
@@ -393,7 +399,7 @@ main( void )
 
     log( "Test http url with stream\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, false ) ) )
     {
         log( "WARNING: can't test http url" );
         return 0;
@@ -0,0 +1,163 @@
+/*****************************************************************************
+ * fifo.c: block FIFO tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+static block_t *NewBlock( mtime_t i_dts, mtime_t i_pts, size_t i_size )
+{
+    block_t *p_block = block_Alloc( i_size );
+    assert( p_block != NULL );
+    p_block->i_dts = i_dts;
+    p_block->i_pts = i_pts;
+    return p_block;
+}
+
+static void test_duration( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    assert( p_fifo != NULL );
+
+    vlc_fifo_Lock( p_fifo );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+
+    /* A single timestamp does not make a span */
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_0 + 1000, VLC_TS_INVALID,
+                                              10 ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+
+    /* Blocks without timestamps are skipped */
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_INVALID, VLC_TS_INVALID,
+                                              20 ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+
+    /* PTS is used in the absence of DTS */
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_INVALID,
+                                              VLC_TS_0 + 41000, 30 ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 40000 );
+
+    /* Chains are accounted as a whole */
+    block_t *p_chain = NewBlock( VLC_TS_0 + 81000, VLC_TS_0 + 161000, 40 );
+    p_chain->p_next = NewBlock( VLC_TS_0 + 121000, VLC_TS_0 + 121000, 50 );
+    vlc_fifo_QueueUnlocked( p_fifo, p_chain );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 120000 );
+    assert( vlc_fifo_GetCount( p_fifo ) == 5 );
+    assert( vlc_fifo_GetBytes( p_fifo ) == 150 );
+
+    /* The span starts from the oldest remaining timestamp */
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 80000 );
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 80000 );
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 40000 );
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_IsEmpty( p_fifo ) );
+
+    /* Emptying the FIFO forgets the newest timestamp */
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_0, VLC_TS_INVALID, 1 ) );
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_0 + 500000,
+                                              VLC_TS_INVALID, 1 ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 500000 );
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
+    vlc_fifo_QueueUnlocked( p_fifo, NewBlock( VLC_TS_0 + 1000000,
+                                              VLC_TS_INVALID, 1 ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+    vlc_fifo_Unlock( p_fifo );
+
+    block_FifoRelease( p_fifo );
+}
+
+static void QueueTs( block_fifo_t *p_fifo, mtime_t i_ts, bool b_discontinuity )
+{
+    block_t *p_block = NewBlock( VLC_TS_0 + i_ts, VLC_TS_INVALID, 1 );
+    if( b_discontinuity )
+        p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    vlc_fifo_QueueUnlocked( p_fifo, p_block );
+}
+
+static void test_discontinuity( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    assert( p_fifo != NULL );
+
+    vlc_fifo_Lock( p_fifo );
+
+    /* A forward jump does not make the queue look deep */
+    QueueTs( p_fifo, 0, false );
+    QueueTs( p_fifo, 40000, false );
+    QueueTs( p_fifo, 80000, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 80000 );
+    QueueTs( p_fifo, 3600000000, true );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+    QueueTs( p_fifo, 3600040000, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 40000 );
+
+    /* Dequeuing up to the discontinuity keeps the span */
+    for( unsigned i = 0; i < 3; i++ )
+    {
+        block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+        assert( vlc_fifo_GetDuration( p_fifo ) == 40000 );
+    }
+    block_Release( vlc_fifo_DequeueUnlocked( p_fifo ) );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+    QueueTs( p_fifo, 3600100000, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 60000 );
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
+
+    /* A flagged backward jump restarts the span */
+    QueueTs( p_fifo, 10000000, false );
+    QueueTs( p_fifo, 10040000, false );
+    QueueTs( p_fifo, 0, true );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 0 );
+    QueueTs( p_fifo, 40000, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 40000 );
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
+
+    /* An unflagged backward jump neither empties nor shrinks the span */
+    QueueTs( p_fifo, 10000000, false );
+    QueueTs( p_fifo, 10100000, false );
+    QueueTs( p_fifo, 0, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 100000 );
+    QueueTs( p_fifo, 10150000, false );
+    assert( vlc_fifo_GetDuration( p_fifo ) == 150000 );
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
+
+    vlc_fifo_Unlock( p_fifo );
+    block_FifoRelease( p_fifo );
+}
+
+int main( void )
+{
+    test_duration();
+    test_discontinuity();
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ * filter_slices.c: test for the video filters slice threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define RUNS 20
+
+struct slice_job
+{
+    picture_t *p_pic;
+    atomic_uint i_active; /* concurrent calls of the callback */
+    unsigned i_max;
+};
+
+/* Adds the plane index plus one to every pixel of the slice */
+static void Slice( filter_t *p_filter, void *opaque, unsigned i_plane,
+                   unsigned i_start, unsigned i_end )
+{
+    struct slice_job *p_job = opaque;
+    plane_t *p = &p_job->p_pic->p[i_plane];
+
+    (void) p_filter;
+    assert( i_start < i_end );
+    assert( i_end <= (unsigned)p->i_visible_lines );
+    assert( (i_start & 1) == 0 );
+    assert( atomic_fetch_add( &p_job->i_active, 1 ) < p_job->i_max );
+
+    for( unsigned y = i_start; y < i_end; y++ )
+        for( int x = 0; x < p->i_visible_pitch; x++ )
+            p->p_pixels[y * p->i_pitch + x] += i_plane + 1;
+
+    atomic_fetch_sub( &p_job->i_active, 1 );
+}
+
+static void check( filter_t *p_filter, unsigned i_width, unsigned i_height,
+                   unsigned i_planes )
+{
+    picture_t *p_pic = picture_New( VLC_CODEC_I420, i_width, i_height, 1, 1 );
+    assert( p_pic != NULL );
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        memset( p_pic->p[i].p_pixels, 0,
+                p_pic->p[i].i_pitch * p_pic->p[i].i_lines );
+
+    /* at most filter_GetSliceThreads() calls run at once, even if other
+     * filters queue slices concurrently */
+    struct slice_job job = {
+        .p_pic = p_pic,
+        .i_max = filter_GetSliceThreads( p_filter ),
+    };
+    atomic_init( &job.i_active, 0 );
+    assert( job.i_max >= 1 );
+
+    for( unsigned k = 0; k < RUNS; k++ )
+        filter_ExecuteSlices( p_filter, Slice, &job, p_pic, i_planes );
+
+    /* every visible line must have been processed exactly once per run */
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+        const uint8_t expected = (unsigned)i < i_planes ? RUNS * (i + 1) : 0;
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                assert( p->p_pixels[y * p->i_pitch + x] == expected );
+    }
+    picture_Release( p_pic );
+}
+
+static void *Thread( void *data )
+{
+    filter_t *p_filter = data;
+
+    check( p_filter, 1920, 1080, 3 );
+    return NULL;
+}
+
+static void test_slices( const char *psz_threads )
+{
+    const char *args[test_defaults_nargs + 1];
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+    args[test_defaults_nargs] = psz_threads;
+
+    log( "Testing slices with %s\n", psz_threads );
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 1, args );
+    assert( p_vlc != NULL );
+
+    filter_t *p_filter = vlc_object_create( p_vlc->p_libvlc_int,
+                                            sizeof(*p_filter) );
+    assert( p_filter != NULL );
+
+    check( p_filter, 1, 1, 1 );
+    check( p_filter, 64, 3, 3 );
+    check( p_filter, 176, 144, 1 );
+    check( p_filter, 720, 576, 3 );
+    check( p_filter, 1920, 1081, 2 );
+
+    /* concurrent filters share the same threads */
+    vlc_thread_t th[3];
+    for( unsigned i = 0; i < 3; i++ )
+        assert( vlc_clone( &th[i], Thread, p_filter,
+                           VLC_THREAD_PRIORITY_LOW ) == 0 );
+    check( p_filter, 1280, 720, 3 );
+    for( unsigned i = 0; i < 3; i++ )
+        vlc_join( th[i], NULL );
+
+    vlc_object_release( p_filter );
+    libvlc_release( p_vlc );
+}
+
+int main( void )
+{
+    test_init();
+
+    test_slices( "--filter-threads=1" );
+    test_slices( "--filter-threads=4" );
+    test_slices( "--filter-threads=0" );
+    return 0;
+}